@@ -0,0 +1,318 @@
+// Copyright 2014 Steve Robinson
+//
+// This file is part of RLM Log Reader.
+//
+// RLM Log Reader is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// RLM Log Reader is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with RLM Log Reader.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "AnalysisProfile.h"
+#include "BufferedWriter.h"
+#include "Utilities.h"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+
+namespace
+{
+    // Both are constant initialized, so they're ready for allocations made before main()
+    std::atomic<int> countingProfiles(0);
+    std::atomic<uint64_t> allocations(0);
+
+
+    void writeJSONString(BufferedWriter& writer, const std::string& text)
+    {
+        writer.write('"');
+        for (char character : text)
+        {
+            if (character == '"' || character == '\\')
+            {
+                writer.write('\\');
+                writer.write(character);
+            }
+            else if (static_cast<unsigned char>(character) < 0x20)
+            {
+                char escaped[8];
+                snprintf(escaped, sizeof(escaped), "\\u%04x", character);
+                writer.write(escaped);
+            }
+            else
+            {
+                writer.write(character);
+            }
+        }
+        writer.write('"');
+    }
+
+
+    void writeSeconds(BufferedWriter& writer, std::chrono::nanoseconds time)
+    {
+        writer.writeFixed(std::chrono::duration<double>(time).count(), 6);
+    }
+}
+
+
+// Every allocation through new comes here, so it can be counted.  Each form of new and
+// delete is replaced, so none is paired with another's allocator, except the aligned ones,
+// which are left as they were.
+void* operator new(std::size_t size)
+{
+    if (countingProfiles.load(std::memory_order_relaxed) > 0)
+    {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void* memory = std::malloc(size == 0 ? 1 : size);
+    while (memory == nullptr)
+    {
+        std::new_handler handler = std::get_new_handler();
+        if (handler == nullptr)
+        {
+            throw std::bad_alloc();
+        }
+        handler();
+        memory = std::malloc(size == 0 ? 1 : size);
+    }
+    return memory;
+}
+
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    try
+    {
+        return operator new(size);
+    }
+    catch (std::bad_alloc&)
+    {
+        return nullptr;
+    }
+}
+
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    return operator new(size, std::nothrow);
+}
+
+
+void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
+
+
+void operator delete[](void* memory) noexcept
+{
+    std::free(memory);
+}
+
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+
+void operator delete[](void* memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+
+void operator delete(void* memory, const std::nothrow_t&) noexcept
+{
+    std::free(memory);
+}
+
+
+void operator delete[](void* memory, const std::nothrow_t&) noexcept
+{
+    std::free(memory);
+}
+
+
+AnalysisProfile::AnalysisProfile()
+{
+    m_enabled = false;
+}
+
+
+AnalysisProfile::~AnalysisProfile()
+{
+    if (m_enabled)
+    {
+        --countingProfiles;
+    }
+}
+
+
+void AnalysisProfile::enable()
+{
+    if (!m_enabled)
+    {
+        m_enabled = true;
+        ++countingProfiles;
+    }
+}
+
+
+const StageProfile& AnalysisProfile::stage(analysisStage stage) const
+{
+    return m_stages.at(stage);
+}
+
+
+const char* AnalysisProfile::stageName(analysisStage stage)
+{
+    static const char* names[StageCount] = {"load", "format", "tokenize", "normalize",
+                                            "extract", "concurrency", "duration", "publish"};
+    return names[stage];
+}
+
+
+void AnalysisProfile::addCounts(analysisStage stage, uint64_t lines, uint64_t events,
+                                uint64_t bytesRead, uint64_t bytesWritten)
+{
+    if (m_enabled)
+    {
+        StageProfile& stageProfile = m_stages.at(stage);
+        stageProfile.lines += lines;
+        stageProfile.events += events;
+        stageProfile.bytesRead += bytesRead;
+        stageProfile.bytesWritten += bytesWritten;
+    }
+}
+
+
+void AnalysisProfile::addTime(analysisStage stage, std::chrono::nanoseconds time)
+{
+    if (m_enabled)
+    {
+        StageProfile& stageProfile = m_stages.at(stage);
+        ++stageProfile.runs;
+        stageProfile.wallTime += time;
+        stageProfile.cpuTime += time;
+    }
+}
+
+
+void AnalysisProfile::writeJSON(const std::string& filePath, const std::string& logPath) const
+{
+    BufferedWriter writer(filePath);
+    writer.write("{\n    \"log\": ");
+    writeJSONString(writer, logPath);
+    writer.write(",\n    \"peakMemory\": ");
+    writer.writeNumber(peakMemoryUsage());
+    writer.write(",\n    \"stages\": {");
+    for (size_t stage=0; stage < StageCount; ++stage)
+    {
+        const StageProfile& stageProfile = m_stages.at(stage);
+        writer.write(stage == 0 ? "\n" : ",\n");
+        writer.write("        \"");
+        writer.write(stageName(static_cast<analysisStage>(stage)));
+        writer.write("\": {\"runs\": ");
+        writer.writeNumber(stageProfile.runs);
+        writer.write(", \"wallSeconds\": ");
+        writeSeconds(writer, stageProfile.wallTime);
+        writer.write(", \"cpuSeconds\": ");
+        writeSeconds(writer, stageProfile.cpuTime);
+        writer.write(", \"lines\": ");
+        writer.writeNumber(stageProfile.lines);
+        writer.write(", \"events\": ");
+        writer.writeNumber(stageProfile.events);
+        writer.write(", \"bytesRead\": ");
+        writer.writeNumber(stageProfile.bytesRead);
+        writer.write(", \"bytesWritten\": ");
+        writer.writeNumber(stageProfile.bytesWritten);
+        writer.write(", \"allocations\": ");
+        writer.writeNumber(stageProfile.allocations);
+        writer.write(", \"peakMemory\": ");
+        writer.writeNumber(stageProfile.peakMemory);
+        writer.write("}");
+    }
+    writer.write("\n    }\n}\n");
+    writer.close();
+}
+
+
+StageTimer::StageTimer(AnalysisProfile& profile, analysisStage stage)
+    : m_profile(profile),
+      m_stage(stage),
+      m_cpuStart(0),
+      m_allocationStart(0)
+{
+    if (m_profile.enabled())
+    {
+        m_wallStart = std::chrono::steady_clock::now();
+        m_cpuStart = processorTime();
+        m_allocationStart = allocationCount();
+    }
+}
+
+
+StageTimer::~StageTimer()
+{
+    if (m_profile.enabled())
+    {
+        StageProfile& stageProfile = m_profile.m_stages.at(m_stage);
+        ++stageProfile.runs;
+        stageProfile.wallTime += std::chrono::steady_clock::now() - m_wallStart;
+        stageProfile.cpuTime += processorTime() - m_cpuStart;
+        stageProfile.allocations += allocationCount() - m_allocationStart;
+        stageProfile.peakMemory = peakMemoryUsage();
+    }
+}
+
+
+std::chrono::nanoseconds processorTime()
+{
+#ifdef _WIN32
+    FILETIME creationTime, exitTime, kernelTime, userTime;
+    if (GetProcessTimes(GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime))
+    {
+        // In units of 100ns
+        uint64_t kernel = (static_cast<uint64_t>(kernelTime.dwHighDateTime) << 32) | kernelTime.dwLowDateTime;
+        uint64_t user = (static_cast<uint64_t>(userTime.dwHighDateTime) << 32) | userTime.dwLowDateTime;
+        return std::chrono::nanoseconds((kernel + user) * 100);
+    }
+#else
+    timespec time;
+    if (clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &time) == 0)
+    {
+        return std::chrono::seconds(time.tv_sec) + std::chrono::nanoseconds(time.tv_nsec);
+    }
+#endif
+    return std::chrono::nanoseconds(0);
+}
+
+
+uint64_t allocationCount()
+{
+    return allocations.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,121 @@
+// Copyright 2014 Steve Robinson
+//
+// This file is part of RLM Log Reader.
+//
+// RLM Log Reader is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// RLM Log Reader is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with RLM Log Reader.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+
+// Stages of an analysis, in the order they run.  Tokenize and normalize happen line by
+// line while extract parses the log, on as many threads as it uses, so their times are
+// part of extract's and are added up over the threads.
+enum analysisStage
+{
+    LoadStage,
+    FormatStage,
+    TokenizeStage,
+    NormalizeStage,
+    ExtractStage,
+    ConcurrencyStage,
+    DurationStage,
+    PublishStage,
+    StageCount
+};
+
+
+// Totals for one stage over every time it ran.  CPU time and allocations are the whole
+// process's while the stage ran, so they include every thread the stage used.  Tokenize
+// and normalize are timed a line at a time instead, so their CPU time is their wall time
+// and their allocations aren't counted.
+struct StageProfile
+{
+    size_t runs = 0;
+    std::chrono::nanoseconds wallTime{0};
+    std::chrono::nanoseconds cpuTime{0};
+    uint64_t lines = 0;
+    uint64_t events = 0;
+    uint64_t bytesRead = 0;
+    uint64_t bytesWritten = 0;
+    uint64_t allocations = 0;
+    uint64_t peakMemory = 0;        // Of the process, as of the end of the stage's last run
+};
+
+
+// What each stage of an analysis cost.  Nothing is measured until it's enabled, so until
+// then it costs a branch for each stage and each line.  Allocations are counted by every
+// thread while any profile is enabled.
+class AnalysisProfile
+{
+    public:
+        AnalysisProfile();
+        ~AnalysisProfile();
+        AnalysisProfile(const AnalysisProfile&) = delete;
+        AnalysisProfile& operator=(const AnalysisProfile&) = delete;
+
+        void enable();
+        bool enabled() const;
+        const StageProfile& stage(analysisStage stage) const;
+        static const char* stageName(analysisStage stage);
+
+        void addCounts(analysisStage stage, uint64_t lines, uint64_t events,
+                       uint64_t bytesRead = 0, uint64_t bytesWritten = 0);
+
+        // For the stages timed a line at a time
+        void addTime(analysisStage stage, std::chrono::nanoseconds time);
+
+        // Throws CannotOpenFileException
+        void writeJSON(const std::string& filePath, const std::string& logPath) const;
+    private:
+        friend class StageTimer;
+
+        bool m_enabled;
+        std::array<StageProfile, StageCount> m_stages;
+};
+
+
+// Measures a stage of an enabled profile from construction until destruction
+class StageTimer
+{
+    public:
+        StageTimer(AnalysisProfile& profile, analysisStage stage);
+        ~StageTimer();
+        StageTimer(const StageTimer&) = delete;
+        StageTimer& operator=(const StageTimer&) = delete;
+    private:
+        AnalysisProfile& m_profile;
+        analysisStage m_stage;
+        std::chrono::steady_clock::time_point m_wallStart;
+        std::chrono::nanoseconds m_cpuStart;
+        uint64_t m_allocationStart;
+};
+
+
+inline bool AnalysisProfile::enabled() const
+{
+    return m_enabled;
+}
+
+
+// CPU time used by every thread of the process so far
+std::chrono::nanoseconds processorTime();
+
+// Memory allocations made with new by the process while any profile was enabled
+uint64_t allocationCount();
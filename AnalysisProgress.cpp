@@ -0,0 +1,79 @@
+// Copyright 2014 Steve Robinson
+//
+// This file is part of RLM Log Reader.
+//
+// RLM Log Reader is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// RLM Log Reader is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with RLM Log Reader.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "AnalysisProgress.h"
+#include "Exceptions.h"
+
+
+AnalysisProgress::AnalysisProgress(std::chrono::milliseconds reportInterval)
+    : m_cancelled(false),
+      m_reportInterval(reportInterval)
+{
+}
+
+
+void AnalysisProgress::cancel()
+{
+    m_cancelled.store(true, std::memory_order_relaxed);
+}
+
+
+void AnalysisProgress::checkCancelled() const
+{
+    if (cancelled())
+    {
+        AnalysisCancelledException analysisCancelledException;
+        throw analysisCancelledException;
+    }
+}
+
+
+void AnalysisProgress::startStage(analysisStage stage, uint64_t totalBytes, uint64_t totalEvents)
+{
+    checkCancelled();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stage = StageProgress();
+    m_stage.stage = stage;
+    m_stage.totalBytes = totalBytes;
+    m_stage.totalEvents = totalEvents;
+    m_lastReport = std::chrono::steady_clock::now();
+    progressed(m_stage);
+}
+
+
+void AnalysisProgress::advance(uint64_t bytes, uint64_t events)
+{
+    checkCancelled();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stage.bytes += bytes;
+    m_stage.events += events;
+
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (now - m_lastReport >= m_reportInterval)
+    {
+        m_lastReport = now;
+        progressed(m_stage);
+    }
+}
+
+
+void AnalysisProgress::finishStage()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stage.finished = true;
+    progressed(m_stage);
+}
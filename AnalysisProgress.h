@@ -0,0 +1,77 @@
+// Copyright 2014 Steve Robinson
+//
+// This file is part of RLM Log Reader.
+//
+// RLM Log Reader is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// RLM Log Reader is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with RLM Log Reader.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include "AnalysisProfile.h"
+
+
+// How far a stage of an analysis has got.  The totals are 0 where they aren't known
+// up front, such as the bytes in a compressed log or the bytes a stage writes.
+struct StageProgress
+{
+    analysisStage stage = LoadStage;
+    uint64_t bytes = 0;
+    uint64_t totalBytes = 0;
+    uint64_t events = 0;
+    uint64_t totalEvents = 0;
+    bool finished = false;
+};
+
+
+// Follows an analysis as it runs, and lets it be cancelled.  LogData starts each stage,
+// advances it as it goes, possibly from several threads at once, and finishes it.
+// progressed() is called with the stage's totals so far, from whichever thread is
+// running, but never from two at once, and at most every reportInterval while a stage
+// is under way.  Once cancel() has been called, from any thread, the analysis throws
+// AnalysisCancelledException the next time it advances.
+class AnalysisProgress
+{
+    public:
+        AnalysisProgress(std::chrono::milliseconds reportInterval = std::chrono::milliseconds(50));
+        virtual ~AnalysisProgress() {}
+        AnalysisProgress(const AnalysisProgress&) = delete;
+        AnalysisProgress& operator=(const AnalysisProgress&) = delete;
+
+        void cancel();
+        bool cancelled() const;
+
+        void startStage(analysisStage stage, uint64_t totalBytes, uint64_t totalEvents);
+        void advance(uint64_t bytes, uint64_t events);
+        void finishStage();
+
+        // Throws AnalysisCancelledException once cancelled
+        void checkCancelled() const;
+    protected:
+        virtual void progressed(const StageProgress& progress) = 0;
+    private:
+        std::atomic<bool> m_cancelled;
+        std::chrono::milliseconds m_reportInterval;
+        std::mutex m_mutex;
+        StageProgress m_stage;
+        std::chrono::steady_clock::time_point m_lastReport;
+};
+
+
+inline bool AnalysisProgress::cancelled() const
+{
+    return m_cancelled.load(std::memory_order_relaxed);
+}
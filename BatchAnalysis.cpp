@@ -0,0 +1,350 @@
+// Copyright 2014 Steve Robinson
+//
+// This file is part of RLM Log Reader.
+//
+// RLM Log Reader is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// RLM Log Reader is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with RLM Log Reader.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "BatchAnalysis.h"
+#include "DecompressingReader.h"
+#include "Exceptions.h"
+#include "Utilities.h"
+#include "qdir.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <thread>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+
+namespace
+{
+    // Peak memory of a single-threaded analysis is about this many times the size of
+    // the log, counting the mapped log itself
+    const uint64_t MemoryPerLogByte = 6;
+
+    // Logs usually compress to about a tenth of their size
+    const uint64_t CompressionRatio = 10;
+
+    // A segmented analysis holds a segment's events along with what it carries between
+    // segments, which is about as much again
+    const uint64_t SegmentedMemory = SegmentSize * MemoryPerLogByte * 2;
+
+    bool isCompressed(const std::string& inputFilePath)
+    {
+        char magic[4] = {};
+        std::ifstream inputFile(inputFilePath.c_str(), std::ios::binary);
+        inputFile.read(magic, sizeof(magic));
+        return detectCompression(std::string_view(magic, inputFile.gcount())) != Uncompressed;
+    }
+
+    uint64_t physicalMemorySize()
+    {
+#ifdef _WIN32
+        MEMORYSTATUSEX memoryStatus;
+        memoryStatus.dwLength = sizeof(memoryStatus);
+        if (GlobalMemoryStatusEx(&memoryStatus))
+        {
+            return memoryStatus.ullTotalPhys;
+        }
+#else
+        long pages = sysconf(_SC_PHYS_PAGES);
+        long pageSize = sysconf(_SC_PAGE_SIZE);
+        if (pages > 0 && pageSize > 0)
+        {
+            return static_cast<uint64_t>(pages) * static_cast<uint64_t>(pageSize);
+        }
+#endif
+        // Assume a modest machine if the OS won't say
+        return uint64_t(4) << 30;
+    }
+}
+
+
+BatchAnalysis::BatchAnalysis(const std::vector<std::string>& inputPaths,
+                             const std::string& outputDirectory,
+                             const BatchOptions& options)
+{
+    m_outputDirectory = outputDirectory;
+    m_options = options;
+    m_memoryInUse = 0;
+
+    if (m_options.threadCount == 0)
+    {
+        m_options.threadCount = std::max<size_t>(1, std::thread::hardware_concurrency());
+    }
+    if (m_options.memoryBudget == 0)
+    {
+        m_options.memoryBudget = physicalMemorySize() / 2;
+    }
+
+    collectInputFiles(inputPaths);
+    if (!m_options.poolName.empty())
+    {
+        poolInputFiles();
+    }
+    setOutputDirectories();
+
+    m_fileThreads = std::max<size_t>(1, std::min(m_options.threadCount, m_results.size()));
+    m_threadsPerFile = std::max<size_t>(1, m_options.threadCount / m_fileThreads);
+}
+
+
+void BatchAnalysis::collectInputFiles(const std::vector<std::string>& inputPaths)
+{
+    for (const std::string& inputPath : inputPaths)
+    {
+        std::vector<std::string> fileList;
+        if (QDir(inputPath.c_str()).exists())
+        {
+            getFileListInDirectory(inputPath, fileList);
+        }
+        else
+        {
+            fileList.push_back(inputPath);
+        }
+
+        for (const std::string& filePath : fileList)
+        {
+            BatchResult result;
+            result.inputFilePath = filePath;
+            m_results.push_back(result);
+        }
+    }
+}
+
+
+void BatchAnalysis::poolInputFiles()
+{
+    for (const BatchResult& result : m_results)
+    {
+        m_poolFilePaths.push_back(result.inputFilePath);
+    }
+
+    BatchResult poolResult;
+    poolResult.inputFilePath = m_options.poolName;
+    m_results.assign(1, poolResult);
+}
+
+
+void BatchAnalysis::setOutputDirectories()
+{
+    // Logs from different servers often share a name, so number the repeats
+    std::map<std::string, size_t> timesUsed;
+    for (BatchResult& result : m_results)
+    {
+        if (!m_options.subdirectoryPerLog)
+        {
+            result.outputDirectory = m_outputDirectory;
+            continue;
+        }
+
+        std::string name = getFilenameFromFilepath(result.inputFilePath);
+        size_t used = ++timesUsed[name];
+        if (used > 1)
+        {
+            name.append("_" + toString(used));
+        }
+        result.outputDirectory = m_outputDirectory + "/" + name;
+    }
+}
+
+
+void BatchAnalysis::run()
+{
+    runInParallel(m_results.size(), m_fileThreads, [this](size_t file)
+    {
+        analyzeFile(file);
+    });
+}
+
+
+void BatchAnalysis::analyzeFile(const size_t file)
+{
+    BatchResult& result = m_results.at(file);
+    uint64_t memory = 0;
+    auto startTime = std::chrono::steady_clock::now();
+
+    try
+    {
+        analysisMode mode = FullAnalysis;
+        if (m_options.incremental)
+        {
+            mode = IncrementalAnalysis;
+        }
+        else if (m_options.cache)
+        {
+            mode = CachedAnalysis;
+        }
+
+        // Conflicts are found before the log is read, so a log that's skipped or fails
+        // costs next to nothing and doesn't hold up the memory budget of the rest
+        std::string conflictedFileList;
+        if (m_options.overwrite != OverwriteExisting)
+        {
+            if (m_poolFilePaths.empty())
+            {
+                LogData::findExistingFiles(result.inputFilePath, result.outputDirectory, conflictedFileList,
+                                           mode, m_options.outputs, m_options.period);
+            }
+            else
+            {
+                LogData::findExistingPoolFiles(m_options.poolName, result.outputDirectory, conflictedFileList,
+                                               m_options.outputs);
+            }
+        }
+
+        if (conflictedFileList.empty())
+        {
+            uint64_t estimate = 0;
+            if (m_poolFilePaths.empty())
+            {
+                estimate = estimateMemory(result.inputFilePath);
+            }
+            for (const std::string& poolFilePath : m_poolFilePaths)
+            {
+                estimate += estimateMemory(poolFilePath);
+            }
+
+            // A log that won't fit in the budget by itself is read a segment at a time,
+            // unless it has to be read whole anyway.  Its output files are the same.
+            if (mode == FullAnalysis && m_poolFilePaths.empty() && estimate > m_options.memoryBudget &&
+                !(m_options.outputs & ParquetOutputs) && !isCompressed(result.inputFilePath))
+            {
+                mode = SegmentedAnalysis;
+                estimate = SegmentedMemory;
+            }
+            reserveMemory(estimate);
+            memory = estimate;
+
+            if (!QDir().mkpath(result.outputDirectory.c_str()))
+            {
+                CannotFindDirException cannotFindDirException(result.outputDirectory);
+                throw cannotFindDirException;
+            }
+
+            std::unique_ptr<LogData> logDataPointer;
+            if (m_poolFilePaths.empty())
+            {
+                logDataPointer.reset(new LogData(result.inputFilePath, result.outputDirectory, m_threadsPerFile,
+                                                 mode, m_options.outputs, m_options.period));
+            }
+            else
+            {
+                logDataPointer.reset(new LogData(m_poolFilePaths, m_options.poolName, result.outputDirectory,
+                                                 m_threadsPerFile, m_options.outputs, m_options.period));
+            }
+            logDataPointer->publishResults(m_options.outputs);
+            result.succeeded = true;
+        }
+        else if (m_options.overwrite == SkipExisting)
+        {
+            result.succeeded = true;
+            result.skipped = true;
+        }
+        else
+        {
+            conflictedFileList.pop_back();
+            findReplaceAll("\n", " ", conflictedFileList);
+            result.errorMessage = "Output files already exist: " + conflictedFileList;
+        }
+    }
+    catch (std::exception& e)
+    {
+        result.errorMessage = e.what();
+    }
+    if (memory > 0)
+    {
+        releaseMemory(memory);
+    }
+
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+
+void BatchAnalysis::reserveMemory(const uint64_t bytes)
+{
+    std::unique_lock<std::mutex> lock(m_memoryMutex);
+    m_memoryReleased.wait(lock, [this, bytes]()
+    {
+        return m_memoryInUse == 0 || m_memoryInUse + bytes <= m_options.memoryBudget;
+    });
+    m_memoryInUse += bytes;
+}
+
+
+void BatchAnalysis::releaseMemory(const uint64_t bytes)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_memoryMutex);
+        m_memoryInUse -= bytes;
+    }
+    m_memoryReleased.notify_all();
+}
+
+
+uint64_t BatchAnalysis::estimateMemory(const std::string& inputFilePath)
+{
+    uint64_t logSize = getFileSize(inputFilePath);
+    if (isCompressed(inputFilePath))
+    {
+        logSize *= CompressionRatio;
+    }
+    return logSize * MemoryPerLogByte;
+}
+
+
+const std::vector<BatchResult>& BatchAnalysis::results() const
+{
+    return m_results;
+}
+
+
+size_t BatchAnalysis::failureCount() const
+{
+    return std::count_if(m_results.begin(), m_results.end(),
+                         [](const BatchResult& result) { return !result.succeeded; });
+}
+
+
+void BatchAnalysis::writeReport(const std::string& outputFilePath) const
+{
+    std::vector<std::vector<std::string>> report;
+    report.push_back({"Log File", "Output Directory", "Result", "Seconds", "Error"});
+
+    for (const BatchResult& result : m_results)
+    {
+        // Quote the error since messages can contain commas
+        std::string errorMessage = result.errorMessage;
+        findReplaceAll("\"", "\"\"", errorMessage);
+
+        std::vector<std::string> row;
+        row.push_back(result.inputFilePath);
+        row.push_back(result.outputDirectory);
+        row.push_back(result.skipped ? "Skipped" : (result.succeeded ? "OK" : "Failed"));
+        row.push_back(toString(result.seconds));
+        row.push_back("\"" + errorMessage + "\"");
+        report.push_back(row);
+    }
+
+    write2DVectorToFile(outputFilePath, report, ",");
+}
@@ -0,0 +1,106 @@
+// Copyright 2014 Steve Robinson
+//
+// This file is part of RLM Log Reader.
+//
+// RLM Log Reader is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// RLM Log Reader is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with RLM Log Reader.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "LogData.h"
+
+
+// What to do when a log's output files are already there
+enum overwritePolicy
+{
+    OverwriteExisting,
+    SkipExisting,
+    FailOnExisting
+};
+
+
+struct BatchOptions
+{
+    size_t threadCount = 0;                 // 0 uses every core
+    uint64_t memoryBudget = 0;              // Bytes the logs in flight may use, 0 is half of physical memory
+    unsigned int outputs = StandardOutputs; // outputFile flags
+    overwritePolicy overwrite = OverwriteExisting;
+    bool subdirectoryPerLog = true;         // Otherwise every log writes to the output directory
+    bool incremental = false;               // Carry on from each log's checkpoint, see IncrementalAnalysis
+    bool cache = false;                     // Keep each log's events in a cache, see CachedAnalysis
+    usagePeriod period = PerHour;           // For UsageByPeriodOutput
+    std::string poolName;                   // Analyze every log as one license pool of this name
+};
+
+
+struct BatchResult
+{
+    std::string inputFilePath;
+    std::string outputDirectory;
+    bool succeeded = false;
+    bool skipped = false;
+    std::string errorMessage;
+    double seconds = 0.0;
+};
+
+
+// Runs a LogData analysis for every log in a set of files and directories, several at
+// a time.  Each log's results go into their own subdirectory of the output directory.
+// A log that fails to parse is recorded in the results and the rest carry on.
+//
+// The threads are shared out between the logs, so a batch with fewer logs than threads
+// splits each log between several of them.
+//
+// A log isn't started while the estimated memory of the logs already in flight would
+// take it over the budget, so a few huge logs can't all be loaded at once.  A log
+// that's over the budget on its own is given a SegmentedAnalysis instead, or if it's
+// compressed or Parquet files are wanted, still runs, just by itself.
+//
+// With a pool name, the logs are instead analyzed together as the servers of one license
+// pool, giving a single result named after the pool in the output directory.
+class BatchAnalysis
+{
+    public:
+        BatchAnalysis(const std::vector<std::string>& inputPaths,
+                      const std::string& outputDirectory,
+                      const BatchOptions& options = BatchOptions());
+        void run();
+        const std::vector<BatchResult>& results() const;
+        size_t failureCount() const;
+        void writeReport(const std::string& outputFilePath) const;
+
+        static uint64_t estimateMemory(const std::string& inputFilePath);
+    private:
+        void collectInputFiles(const std::vector<std::string>& inputPaths);
+        void poolInputFiles();
+        void setOutputDirectories();
+        void analyzeFile(const size_t file);
+        void reserveMemory(const uint64_t bytes);
+        void releaseMemory(const uint64_t bytes);
+
+        std::string m_outputDirectory;
+        BatchOptions m_options;
+        size_t m_fileThreads;
+        size_t m_threadsPerFile;
+        std::vector<BatchResult> m_results;
+        std::vector<std::string> m_poolFilePaths;
+
+        std::mutex m_memoryMutex;
+        std::condition_variable m_memoryReleased;
+        uint64_t m_memoryInUse;
+};
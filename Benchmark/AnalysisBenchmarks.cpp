@@ -0,0 +1,227 @@
+// Copyright 2014 Steve Robinson
+//
+// This file is part of RLM Log Reader.
+//
+// RLM Log Reader is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// RLM Log Reader is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with RLM Log Reader.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "LogData.h"
+#include "LogGenerator.h"
+#include "MappedFile.h"
+#include "Tokenizer.h"
+#include "Utilities.h"
+#include "benchmark/benchmark.h"
+#include <array>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+// Times each stage of an analysis over whole logs.  Without --log=<path> a report log
+// and an ISV log of --log_size bytes (10M by default) are generated to run them on.
+//
+// Peak memory is the process's, so it includes the stages that ran before.  Pick out one
+// stage with --benchmark_filter to see its own.
+
+namespace
+{
+    void setCounters(benchmark::State& state, uint64_t logSize)
+    {
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * logSize));
+        state.counters["peakMemory"] = benchmark::Counter(static_cast<double>(peakMemoryUsage()),
+                                                          benchmark::Counter::kDefaults,
+                                                          benchmark::Counter::kIs1024);
+    }
+
+
+    // Mapping the log and finding its lines, as the analysis reads an uncompressed log
+    void BM_mapAndSplitLines(benchmark::State& state, const std::string& logPath)
+    {
+        size_t lineCount = 0;
+        for (auto _ : state)
+        {
+            MappedFile inputFile(logPath);
+            std::vector<std::string_view> lines;
+            splitIntoLines(inputFile.data(), lines);
+            lineCount = lines.size();
+        }
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * lineCount));
+        setCounters(state, getFileSize(logPath));
+    }
+
+
+    // Splitting every line of the mapped log into its fields, reusing the one vector of
+    // tokens as the parse does
+    void BM_tokenizeLines(benchmark::State& state, const std::string& logPath)
+    {
+        MappedFile inputFile(logPath);
+        std::vector<std::string_view> lines;
+        splitIntoLines(inputFile.data(), lines);
+        std::vector<std::string_view> tokens;
+        for (auto _ : state)
+        {
+            for (std::string_view line : lines)
+            {
+                tokenizeLine(line, ' ', tokens);
+                benchmark::DoNotOptimize(tokens.data());
+            }
+        }
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * lines.size()));
+        state.SetLabel(tokenizerKernelName());
+        setCounters(state, getFileSize(logPath));
+    }
+
+
+    // Everything the LogData constructor does, broken down into the seconds each stage
+    // took per run by the analysis's own profile
+    void BM_analyze(benchmark::State& state, const std::string& logPath, const std::string& outputDirectory)
+    {
+        std::array<double, StageCount> stageSeconds{};
+        for (auto _ : state)
+        {
+            LogData logData(logPath, outputDirectory, static_cast<size_t>(state.range(0)),
+                            FullAnalysis, StandardOutputs | ProfileOutput);
+            for (size_t stage=0; stage < StageCount; ++stage)
+            {
+                stageSeconds.at(stage) += std::chrono::duration<double>(
+                    logData.profile().stage(static_cast<analysisStage>(stage)).wallTime).count();
+            }
+        }
+
+        for (size_t stage=0; stage < PublishStage; ++stage)
+        {
+            state.counters[AnalysisProfile::stageName(static_cast<analysisStage>(stage))] =
+                benchmark::Counter(stageSeconds.at(stage), benchmark::Counter::kAvgIterations);
+        }
+        setCounters(state, getFileSize(logPath));
+    }
+
+
+    void BM_publishResults(benchmark::State& state,
+                           const std::string& logPath,
+                           const std::string& outputDirectory,
+                           unsigned int outputs)
+    {
+        LogData logData(logPath, outputDirectory);
+        for (auto _ : state)
+        {
+            logData.publishResults(outputs);
+        }
+        setCounters(state, getFileSize(logPath));
+    }
+
+
+    void registerStages(const std::string& logPath, const std::string& outputDirectory)
+    {
+        const std::string logName = getFilenameFromFilepath(logPath);
+        const struct
+        {
+            const char* name;
+            unsigned int outputs;
+            bool reportLogsOnly;
+        } publishedOutputs[] = {
+            {"Summary", SummaryOutput, false},
+            {"EventData", EventDataOutput, false},
+            {"UsageOverTime", UsageOverTimeOutput, false},
+            {"UsageDuration", UsageDurationOutput, true},
+            {"TotalDuration", TotalDurationOutput, true},
+            {"UsageByPeriod", UsageByPeriodOutput, true}
+        };
+
+        benchmark::RegisterBenchmark(("mapAndSplitLines/" + logName).c_str(), BM_mapAndSplitLines, logPath)
+            ->Unit(benchmark::kMillisecond)->UseRealTime();
+        benchmark::RegisterBenchmark(("tokenizeLines/" + logName).c_str(), BM_tokenizeLines, logPath)
+            ->Unit(benchmark::kMillisecond)->UseRealTime();
+
+        // One thread, and then every core
+        benchmark::RegisterBenchmark(("analyze/" + logName).c_str(), BM_analyze, logPath, outputDirectory)
+            ->ArgName("threads")->Arg(1)->Arg(0)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+        LogData logData(logPath, outputDirectory);
+        for (const auto& output : publishedOutputs)
+        {
+            if (!output.reportLogsOnly || logData.fileFormat() == ReportLog)
+            {
+                benchmark::RegisterBenchmark(("publishResults/" + logName + "/" + output.name).c_str(),
+                                             BM_publishResults, logPath, outputDirectory, output.outputs)
+                    ->Unit(benchmark::kMillisecond)->UseRealTime();
+            }
+        }
+    }
+}
+
+
+int main(int argc, char** argv)
+{
+    benchmark::Initialize(&argc, argv);
+
+    std::vector<std::string> logPaths;
+    uint64_t logSize = 10 << 20;
+    try
+    {
+        for (int argument=1; argument < argc; ++argument)
+        {
+            std::string_view option(argv[argument]);
+            if (option.substr(0, 6) == "--log=")
+            {
+                logPaths.push_back(std::string(option.substr(6)));
+            }
+            else if (option.substr(0, 11) == "--log_size=")
+            {
+                logSize = parseByteCount(std::string(option.substr(11)));
+            }
+            else
+            {
+                std::cerr << "Unknown argument " << option << "\n";
+                return 2;
+            }
+        }
+
+        // Results, and the logs when they're generated, go in a scratch directory
+        std::filesystem::path workDirectory = std::filesystem::temp_directory_path() / "RLMLogReaderBenchmark";
+        std::filesystem::create_directories(workDirectory);
+        if (logPaths.empty())
+        {
+            for (enum fileFormat format : {ReportLog, ISVLog})
+            {
+                LogSpec spec;
+                spec.format = format;
+                spec.size = logSize;
+                std::string logPath = (workDirectory / (format == ReportLog ? "SyntheticReport.log" : "SyntheticISV.log")).string();
+                generateLog(spec, logPath);
+                logPaths.push_back(logPath);
+            }
+        }
+
+        for (const std::string& logPath : logPaths)
+        {
+            registerStages(logPath, workDirectory.string());
+        }
+
+        benchmark::RunSpecifiedBenchmarks();
+        benchmark::Shutdown();
+
+        std::error_code error;
+        std::filesystem::remove_all(workDirectory, error);
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
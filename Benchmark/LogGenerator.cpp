@@ -0,0 +1,580 @@
+// Copyright 2014 Steve Robinson
+//
+// This file is part of RLM Log Reader.
+//
+// RLM Log Reader is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// RLM Log Reader is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with RLM Log Reader.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "LogGenerator.h"
+#include "BufferedWriter.h"
+#include "Exceptions.h"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <random>
+#include <vector>
+
+
+namespace
+{
+    const double SecondsPerDay = 24 * 60 * 60;
+
+    // Report logs note the date and time every half hour
+    const double TimestampInterval = 30 * 60;
+
+    // Only the engine comes from <random>, since its distributions give different
+    // numbers with different standard libraries
+    class RandomSource
+    {
+        public:
+            explicit RandomSource(uint64_t seed) : m_engine(seed) {}
+
+            double uniform()
+            {
+                return static_cast<double>(m_engine() >> 11) / static_cast<double>(uint64_t(1) << 53);
+            }
+
+            size_t below(size_t count)
+            {
+                return static_cast<size_t>(m_engine() % count);
+            }
+
+            double exponential(double mean)
+            {
+                return -mean * std::log(1.0 - uniform());
+            }
+        private:
+            std::mt19937_64 m_engine;
+    };
+
+
+    struct CheckOut
+    {
+        double checkInTime;
+        size_t product;
+        size_t user;
+        size_t host;
+        int count;
+        unsigned int handle;
+
+        bool operator>(const CheckOut& other) const
+        {
+            return checkInTime > other.checkInTime;
+        }
+    };
+
+
+    class LogGenerator
+    {
+        public:
+            LogGenerator(const LogSpec& spec, const std::string& filePath);
+            GeneratedLog generate();
+        private:
+            void advanceTo(double time);
+            void nextDay();
+            void startServer();
+            void shutDownServer();
+            void checkOut();
+            void checkIn();
+            void writeProducts();
+            void writeEventPrefix();
+            void writeDate(bool withYear);
+            void writeTime(bool withSeconds);
+            void writeUserAndHost(const CheckOut& checkOut, char separator);
+            void writeTokens(const CheckOut& checkOut);
+            void write(std::string_view text);
+            void writeNumber(long long number, int width = 0);
+            void writeHex(unsigned int number);
+            void endLine();
+
+            LogSpec m_spec;
+            BufferedWriter m_writer;
+            RandomSource m_random;
+            GeneratedLog m_log;
+
+            // Seconds since midnight before the first day
+            double m_time;
+            long long m_dayIndex;
+            long long m_timestampIndex;
+            int m_year;
+            int m_month;
+            int m_day;
+
+            std::priority_queue<CheckOut, std::vector<CheckOut>, std::greater<CheckOut>> m_checkOuts;
+            std::vector<int> m_licensesInUse;
+            unsigned int m_nextHandle;
+    };
+
+
+    LogGenerator::LogGenerator(const LogSpec& spec, const std::string& filePath)
+        : m_spec(spec),
+          m_writer(filePath, false, true),
+          m_random(spec.seed),
+          m_log{0, 0, 0, 0},
+          m_time(8 * 60 * 60),
+          m_dayIndex(0),
+          m_timestampIndex(static_cast<long long>(m_time / TimestampInterval)),
+          m_year(spec.startYear),
+          m_month(spec.startMonth),
+          m_day(spec.startDay),
+          m_licensesInUse(spec.productCount, 0),
+          m_nextHandle(0x41)
+    {
+    }
+
+
+    GeneratedLog LogGenerator::generate()
+    {
+        const double never = std::numeric_limits<double>::infinity();
+        double restartTime = (m_spec.daysBetweenRestarts > 0) ? m_time + m_spec.daysBetweenRestarts * SecondsPerDay : never;
+        double checkOutTime = m_time + m_random.exponential(m_spec.secondsBetweenCheckOuts);
+
+        startServer();
+        while (m_log.size < m_spec.size)
+        {
+            double checkInTime = m_checkOuts.empty() ? never : m_checkOuts.top().checkInTime;
+            if (restartTime <= checkInTime && restartTime <= checkOutTime)
+            {
+                advanceTo(restartTime);
+                shutDownServer();
+                advanceTo(restartTime + 60);
+                startServer();
+                restartTime += m_spec.daysBetweenRestarts * SecondsPerDay;
+                checkOutTime = std::max(checkOutTime, m_time);
+            }
+            else if (checkInTime <= checkOutTime)
+            {
+                advanceTo(checkInTime);
+                checkIn();
+            }
+            else
+            {
+                advanceTo(checkOutTime);
+                checkOut();
+                checkOutTime += m_random.exponential(m_spec.secondsBetweenCheckOuts);
+            }
+        }
+
+        m_writer.close();
+        return m_log;
+    }
+
+
+    // Moves the clock forward, writing the lines a server writes on its own as time passes
+    void LogGenerator::advanceTo(double time)
+    {
+        if (m_spec.format == ReportLog)
+        {
+            while ((m_timestampIndex + 1) * TimestampInterval <= time)
+            {
+                ++m_timestampIndex;
+                m_time = m_timestampIndex * TimestampInterval;
+                bool midnight = (m_time >= (m_dayIndex + 1) * SecondsPerDay);
+                if (midnight)
+                {
+                    nextDay();
+                }
+                writeDate(true);
+                write(" ");
+                writeTime(false);
+                endLine();
+
+                if (midnight)
+                {
+                    write("REREAD automatic midnight ");
+                    writeDate(false);
+                    write(" ");
+                    writeTime(true);
+                    endLine();
+                    writeProducts();
+                }
+            }
+        }
+
+        m_time = time;
+        while (m_time >= (m_dayIndex + 1) * SecondsPerDay)
+        {
+            nextDay();
+        }
+    }
+
+
+    void LogGenerator::nextDay()
+    {
+        static const int daysInMonth[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+        bool leapYear = (m_year % 4 == 0 && m_year % 100 != 0) || m_year % 400 == 0;
+
+        ++m_dayIndex;
+        ++m_day;
+        if (m_day > daysInMonth[m_month - 1] + ((m_month == 2 && leapYear) ? 1 : 0))
+        {
+            m_day = 1;
+            ++m_month;
+            if (m_month > 12)
+            {
+                m_month = 1;
+                ++m_year;
+                ++m_log.newYearCount;
+            }
+        }
+    }
+
+
+    void LogGenerator::startServer()
+    {
+        ++m_log.eventCount;
+        if (m_spec.format == ReportLog)
+        {
+            write("RLM Report Log Format 0, version 10.0, authenticated\n"
+                  "ISV: demo, RLM version 10.0 BL2\n"
+                  "Logfile format Copyright (C) 2006-2013 Reprise Software, Inc.\n"
+                  "For documentation on this format, email info@reprisesoftware.com\n"
+                  "You are encouraged to build tools to process this data.\n"
+                  "\n");
+            m_log.lineCount += 6;
+
+            write("START licenseserver ");
+            writeDate(true);
+            write(" ");
+            writeTime(true);
+            endLine();
+            write("LICENSE FILE license.lic");
+            endLine();
+            writeProducts();
+            writeDate(true);
+            write(" ");
+            writeTime(false);
+            endLine();
+        }
+        else
+        {
+            writeEventPrefix();
+            write("Server started on licenseserver (hostid: 6fc049e3e83d) for:");
+            endLine();
+            writeEventPrefix();
+            write("\t");
+            for (size_t product=0; product < m_spec.productCount; ++product)
+            {
+                write("product");
+                writeNumber(product);
+                write(" ");
+            }
+            endLine();
+            writeEventPrefix();
+            endLine();
+        }
+    }
+
+
+    void LogGenerator::shutDownServer()
+    {
+        ++m_log.eventCount;
+        if (m_spec.format == ReportLog)
+        {
+            write("SHUTDOWN webuser adminhost ");
+            writeDate(false);
+            write(" ");
+            writeTime(true);
+        }
+        else
+        {
+            writeEventPrefix();
+            write("Shutdown request by webuser@adminhost");
+        }
+        endLine();
+
+        // Everything checked out goes with the server
+        m_checkOuts = decltype(m_checkOuts)();
+        std::fill(m_licensesInUse.begin(), m_licensesInUse.end(), 0);
+    }
+
+
+    void LogGenerator::checkOut()
+    {
+        // Squaring favours the first few products, as a handful usually get most of the use
+        double popularity = m_random.uniform();
+        CheckOut checkOut;
+        checkOut.product = static_cast<size_t>(popularity * popularity * m_spec.productCount);
+        checkOut.user = m_random.below(m_spec.userCount);
+        checkOut.host = m_random.below(m_spec.hostCount);
+        checkOut.count = (m_random.uniform() < m_spec.tokenShare) ? 2 + static_cast<int>(m_random.below(15)) : 1;
+        checkOut.checkInTime = m_time + 1 + m_random.exponential(m_spec.minutesPerCheckOut * 60);
+
+        ++m_log.eventCount;
+        int& inUse = m_licensesInUse.at(checkOut.product);
+        bool denied = (inUse + checkOut.count > m_spec.licensesPerProduct);
+        if (m_spec.format == ReportLog)
+        {
+            write(denied ? "DENY product" : "OUT product");
+            writeNumber(checkOut.product);
+            write(denied ? " 2.1" : " 2.12 ");
+            if (!denied)
+            {
+                writeNumber(checkOut.product + 1);
+            }
+            writeUserAndHost(checkOut, ' ');
+            writeTokens(checkOut);
+            writeNumber(checkOut.count);
+            write(" ");
+            if (denied)
+            {
+                write("-22 1 ");
+                writeDate(false);
+                write(" ");
+                writeTime(false);
+                endLine();
+                return;
+            }
+            inUse += checkOut.count;
+            checkOut.handle = m_nextHandle++;
+            writeNumber(inUse);
+            write(" 0 ");
+            writeHex(checkOut.handle);
+            write(" ");
+            writeHex(checkOut.handle);
+            write(" 1a14 \"\" \"\" \"\" ");
+            writeDate(false);
+            write(" ");
+            writeTime(true);
+            endLine();
+        }
+        else
+        {
+            writeEventPrefix();
+            write(denied ? "DENIED: (1) product" : "OUT: product");
+            writeNumber(checkOut.product);
+            write(" v2.12 ");
+            write(denied ? "to " : "by ");
+            writeUserAndHost(checkOut, '@');
+            if (!denied && checkOut.count > 1)
+            {
+                write("ISV_Def Stuff (");
+                writeNumber(checkOut.count);
+                write(" licenses)");
+            }
+            endLine();
+            if (denied)
+            {
+                writeEventPrefix();
+                write("        All licenses in use");
+                endLine();
+                return;
+            }
+            inUse += checkOut.count;
+        }
+        m_checkOuts.push(checkOut);
+    }
+
+
+    void LogGenerator::checkIn()
+    {
+        CheckOut checkOut = m_checkOuts.top();
+        m_checkOuts.pop();
+
+        ++m_log.eventCount;
+        int& inUse = m_licensesInUse.at(checkOut.product);
+        inUse -= checkOut.count;
+        if (m_spec.format == ReportLog)
+        {
+            write("IN 1 product");
+            writeNumber(checkOut.product);
+            write(" 2.12");
+            writeUserAndHost(checkOut, ' ');
+            writeTokens(checkOut);
+            writeNumber(checkOut.count);
+            write(" ");
+            writeNumber(inUse);
+            write(" 0 ");
+            writeHex(checkOut.handle);
+            write(" ");
+            writeDate(false);
+            write(" ");
+            writeTime(true);
+        }
+        else
+        {
+            // Some checkins say why the license came back
+            static const char* reasons[] = {"", "", "", "(client exit) ", "(timed out) "};
+            writeEventPrefix();
+            write("IN: ");
+            write(reasons[m_random.below(5)]);
+            write("product");
+            writeNumber(checkOut.product);
+            write(" v2.12 by ");
+            writeUserAndHost(checkOut, '@');
+            if (checkOut.count > 1)
+            {
+                write("ISV_Def Stuff (");
+                writeNumber(checkOut.count);
+                write(" licenses)");
+            }
+        }
+        endLine();
+    }
+
+
+    void LogGenerator::writeProducts()
+    {
+        for (size_t product=0; product < m_spec.productCount; ++product)
+        {
+            write("PRODUCT product");
+            writeNumber(product);
+            write(" 3.12 ");
+            writeNumber(product + 1);
+            write(" ");
+            writeNumber(m_spec.licensesPerProduct);
+            write(" 0 ");
+            writeNumber(m_spec.licensesPerProduct);
+            write(" \"\" \"\" \"\" \"\" \"\" \"\" 0 0 0 0 0 0 0 0 0");
+            endLine();
+        }
+    }
+
+
+    // ISV logs start each line with the date and time, to the minute, and the ISV name
+    void LogGenerator::writeEventPrefix()
+    {
+        writeDate(false);
+        write(" ");
+        long long secondOfDay = static_cast<long long>(m_time - m_dayIndex * SecondsPerDay);
+        writeNumber(secondOfDay / 3600);
+        write(":");
+        writeNumber((secondOfDay / 60) % 60, 2);
+        write(" (demo) ");
+    }
+
+
+    void LogGenerator::writeDate(bool withYear)
+    {
+        writeNumber(m_month, 2);
+        write("/");
+        writeNumber(m_day, 2);
+        if (withYear)
+        {
+            write("/");
+            writeNumber(m_year);
+        }
+    }
+
+
+    void LogGenerator::writeTime(bool withSeconds)
+    {
+        long long secondOfDay = static_cast<long long>(m_time - m_dayIndex * SecondsPerDay);
+        writeNumber(secondOfDay / 3600, 2);
+        write(":");
+        writeNumber((secondOfDay / 60) % 60, 2);
+        if (withSeconds)
+        {
+            write(":");
+            writeNumber(secondOfDay % 60, 2);
+        }
+    }
+
+
+    void LogGenerator::writeUserAndHost(const CheckOut& checkOut, char separator)
+    {
+        if (separator == ' ')
+        {
+            write(" ");
+        }
+        write("user");
+        writeNumber(checkOut.user);
+        write(std::string_view(&separator, 1));
+        write("host");
+        writeNumber(checkOut.host);
+        write(" ");
+    }
+
+
+    // The project field of report log events, which names the license for tokens
+    void LogGenerator::writeTokens(const CheckOut& checkOut)
+    {
+        write((checkOut.count > 1) ? "\"ISV_Def Stuff\" " : "\"\" ");
+    }
+
+
+    void LogGenerator::write(std::string_view text)
+    {
+        m_writer.write(text);
+        m_log.size += text.size();
+    }
+
+
+    void LogGenerator::writeNumber(long long number, int width)
+    {
+        char digits[24];
+        std::to_chars_result result = std::to_chars(digits, digits + sizeof(digits), number);
+        for (int padding = width - static_cast<int>(result.ptr - digits); padding > 0; --padding)
+        {
+            write("0");
+        }
+        write(std::string_view(digits, result.ptr - digits));
+    }
+
+
+    void LogGenerator::writeHex(unsigned int number)
+    {
+        char digits[16];
+        std::to_chars_result result = std::to_chars(digits, digits + sizeof(digits), number, 16);
+        write(std::string_view(digits, result.ptr - digits));
+    }
+
+
+    void LogGenerator::endLine()
+    {
+        write("\n");
+        ++m_log.lineCount;
+    }
+}
+
+
+GeneratedLog generateLog(const LogSpec& spec, const std::string& filePath)
+{
+    LogGenerator generator(spec, filePath);
+    return generator.generate();
+}
+
+
+uint64_t parseByteCount(const std::string& value)
+{
+    uint64_t count = 0;
+    std::from_chars_result result = std::from_chars(value.data(), value.data() + value.size(), count);
+    std::string_view suffix(result.ptr, value.data() + value.size() - result.ptr);
+    if (result.ec != std::errc() || suffix.size() > 1)
+    {
+        CommandLineException commandLineException("'" + value + "' isn't a size like 500M");
+        throw commandLineException;
+    }
+
+    if (!suffix.empty())
+    {
+        int shift = 0;
+        switch (suffix.front())
+        {
+            case 'K': case 'k': shift = 10; break;
+            case 'M': case 'm': shift = 20; break;
+            case 'G': case 'g': shift = 30; break;
+            default:
+            {
+                CommandLineException commandLineException("'" + value + "' isn't a size like 500M");
+                throw commandLineException;
+            }
+        }
+        count <<= shift;
+    }
+    return count;
+}
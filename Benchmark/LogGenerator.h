@@ -0,0 +1,64 @@
+// Copyright 2014 Steve Robinson
+//
+// This file is part of RLM Log Reader.
+//
+// RLM Log Reader is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// RLM Log Reader is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with RLM Log Reader.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include "LogData.h"
+
+
+// Shape of a synthetic RLM log.  The same spec always produces the same log, byte for
+// byte, on every platform.  Checkouts arrive at random and are held for a random time,
+// both exponentially distributed, and a checkout that would take more licenses than
+// the product has left is denied instead.
+struct LogSpec
+{
+    enum fileFormat format = ReportLog;
+    uint64_t size = 10 << 20;               // Stops at the first event past this many bytes
+    size_t productCount = 8;                // A few products get most of the use
+    size_t userCount = 500;
+    size_t hostCount = 200;
+    int licensesPerProduct = 50;
+    double secondsBetweenCheckOuts = 20;    // On average.  Less means more churn.
+    double minutesPerCheckOut = 90;         // On average
+    double tokenShare = 0.1;                // Checkouts that take several licenses as tokens
+    double daysBetweenRestarts = 7;         // SHUTDOWN and START again, or 0 to never restart
+    int startYear = 2012;                   // Close enough to New Year for small logs
+    int startMonth = 12;                    // to pass it
+    int startDay = 28;
+    uint64_t seed = 1;
+};
+
+
+// What went into a generated log
+struct GeneratedLog
+{
+    uint64_t size;
+    size_t lineCount;
+    size_t eventCount;          // OUT, IN, DENY, START and SHUTDOWN
+    size_t newYearCount;
+};
+
+
+// Writes a log to filePath.  Throws CannotOpenFileException.
+GeneratedLog generateLog(const LogSpec& spec, const std::string& filePath);
+
+// Bytes from a count with an optional K, M or G suffix, like 20G.  Throws
+// CommandLineException.
+uint64_t parseByteCount(const std::string& value);
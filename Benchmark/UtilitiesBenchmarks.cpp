@@ -0,0 +1,117 @@
+// Copyright 2014 Steve Robinson
+//
+// This file is part of RLM Log Reader.
+//
+// RLM Log Reader is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// RLM Log Reader is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with RLM Log Reader.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "TimestampParser.h"
+#include "Tokenizer.h"
+#include "Utilities.h"
+#include "benchmark/benchmark.h"
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+
+// A day of checkouts: many events share a date, as they do in a real report log
+static std::vector<std::pair<std::string, std::string>> makeTimestamps()
+{
+    std::vector<std::pair<std::string, std::string>> timestamps;
+    for (int day=1; day <= 28; ++day)
+    {
+        std::string dateString = (day < 10 ? "02/0" : "02/") + std::to_string(day) + "/2014";
+        for (int minute=0; minute < 60; ++minute)
+        {
+            std::string timeString = "13:" + std::string(minute < 10 ? "0" : "") + std::to_string(minute) + ":27";
+            timestamps.emplace_back(dateString, timeString);
+        }
+    }
+    return timestamps;
+}
+
+
+static void BM_stringToTime(benchmark::State& state)
+{
+    const auto timestamps = makeTimestamps();
+    for (auto _ : state)
+    {
+        for (const auto& timestamp : timestamps)
+        {
+            benchmark::DoNotOptimize(stringToTime(timestamp.first, timestamp.second));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * timestamps.size());
+}
+BENCHMARK(BM_stringToTime);
+
+
+static void BM_TimestampParser(benchmark::State& state)
+{
+    const auto timestamps = makeTimestamps();
+    TimestampParser timestampParser;
+    for (auto _ : state)
+    {
+        for (const auto& timestamp : timestamps)
+        {
+            benchmark::DoNotOptimize(timestampParser.parse(timestamp.first, timestamp.second));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * timestamps.size());
+}
+BENCHMARK(BM_TimestampParser);
+
+
+static const std::string reportOutLine =
+    "OUT analytics 2.09 2 cecil win2008 \"\" 1 1 0 41 41 1a14 \"\" \"\" \"\" 05/11 15:17:14";
+
+
+static void BM_tokenizeString(benchmark::State& state)
+{
+    std::vector<std::string> tokens;
+    for (auto _ : state)
+    {
+        tokenizeString(" ", reportOutLine, tokens);
+        benchmark::DoNotOptimize(tokens.data());
+    }
+    state.SetBytesProcessed(state.iterations() * reportOutLine.size());
+}
+BENCHMARK(BM_tokenizeString);
+
+
+static void BM_tokenizeLineScalar(benchmark::State& state)
+{
+    std::vector<std::string_view> tokens;
+    for (auto _ : state)
+    {
+        tokenizeLineScalar(reportOutLine, ' ', tokens);
+        benchmark::DoNotOptimize(tokens.data());
+    }
+    state.SetBytesProcessed(state.iterations() * reportOutLine.size());
+}
+BENCHMARK(BM_tokenizeLineScalar);
+
+
+static void BM_tokenizeLine(benchmark::State& state)
+{
+    std::vector<std::string_view> tokens;
+    for (auto _ : state)
+    {
+        tokenizeLine(reportOutLine, ' ', tokens);
+        benchmark::DoNotOptimize(tokens.data());
+    }
+    state.SetBytesProcessed(state.iterations() * reportOutLine.size());
+    state.SetLabel(tokenizerKernelName());
+}
+BENCHMARK(BM_tokenizeLine);
@@ -0,0 +1,176 @@
+// Copyright 2014 Steve Robinson
+//
+// This file is part of RLM Log Reader.
+//
+// RLM Log Reader is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// RLM Log Reader is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with RLM Log Reader.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "Exceptions.h"
+#include "LogGenerator.h"
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+
+namespace
+{
+    const char* usageText =
+        "Usage: RLMLogGenerator [options] <log file>\n"
+        "\n"
+        "Writes a synthetic RLM log for benchmarking.  The same options always write the\n"
+        "same log.\n"
+        "\n"
+        "Options:\n"
+        "  --format <format>        report (default) or isv\n"
+        "  --size <bytes>           Size of the log, with an optional K, M or G suffix\n"
+        "                           (default 10M)\n"
+        "  --products <n>           Products served (default 8)\n"
+        "  --users <n>              Users checking out licenses (default 500)\n"
+        "  --hosts <n>              Hosts they check out from (default 200)\n"
+        "  --licenses <n>           Licenses of each product (default 50)\n"
+        "  --gap <seconds>          Average time between checkouts (default 20)\n"
+        "  --hold <minutes>         Average time a license is checked out (default 90)\n"
+        "  --tokens <share>         Share of checkouts that take several licenses as tokens\n"
+        "                           (default 0.1)\n"
+        "  --restart <days>         Days between server restarts, 0 for none (default 7)\n"
+        "  --start <MM/DD/YYYY>     First day of the log (default 12/28/2012)\n"
+        "  --seed <n>               Seed for the random events (default 1)\n";
+
+
+    double numberValue(const std::vector<std::string>& arguments, size_t& argument)
+    {
+        if (argument + 1 >= arguments.size())
+        {
+            CommandLineException commandLineException(arguments.at(argument) + " needs a value");
+            throw commandLineException;
+        }
+        const std::string& value = arguments.at(++argument);
+        char* end = nullptr;
+        double number = strtod(value.c_str(), &end);
+        if (value.empty() || *end != '\0' || number < 0)
+        {
+            CommandLineException commandLineException(arguments.at(argument - 1) + " '" + value + "' isn't a number");
+            throw commandLineException;
+        }
+        return number;
+    }
+
+
+    void parseGeneratorCommandLine(const std::vector<std::string>& arguments, LogSpec& spec, std::string& filePath)
+    {
+        for (size_t argument=0; argument < arguments.size(); ++argument)
+        {
+            const std::string& name = arguments.at(argument);
+            bool hasValue = (argument + 1 < arguments.size());
+            if (name == "--format" && hasValue)
+            {
+                const std::string& format = arguments.at(++argument);
+                if (format != "report" && format != "isv")
+                {
+                    CommandLineException commandLineException("unknown format '" + format + "'");
+                    throw commandLineException;
+                }
+                spec.format = (format == "report") ? ReportLog : ISVLog;
+            }
+            else if (name == "--size" && hasValue)
+                spec.size = parseByteCount(arguments.at(++argument));
+            else if (name == "--products")
+                spec.productCount = static_cast<size_t>(numberValue(arguments, argument));
+            else if (name == "--users")
+                spec.userCount = static_cast<size_t>(numberValue(arguments, argument));
+            else if (name == "--hosts")
+                spec.hostCount = static_cast<size_t>(numberValue(arguments, argument));
+            else if (name == "--licenses")
+                spec.licensesPerProduct = static_cast<int>(numberValue(arguments, argument));
+            else if (name == "--gap")
+                spec.secondsBetweenCheckOuts = numberValue(arguments, argument);
+            else if (name == "--hold")
+                spec.minutesPerCheckOut = numberValue(arguments, argument);
+            else if (name == "--tokens")
+                spec.tokenShare = numberValue(arguments, argument);
+            else if (name == "--restart")
+                spec.daysBetweenRestarts = numberValue(arguments, argument);
+            else if (name == "--seed")
+                spec.seed = static_cast<uint64_t>(numberValue(arguments, argument));
+            else if (name == "--start" && hasValue)
+            {
+                const std::string& date = arguments.at(++argument);
+                if (sscanf(date.c_str(), "%d/%d/%d", &spec.startMonth, &spec.startDay, &spec.startYear) != 3 ||
+                    spec.startMonth < 1 || spec.startMonth > 12 || spec.startDay < 1 || spec.startDay > 28)
+                {
+                    CommandLineException commandLineException("'" + date + "' isn't a date like 12/28/2012, "
+                                                              "on or before the 28th");
+                    throw commandLineException;
+                }
+            }
+            else if (!name.empty() && name.front() == '-')
+            {
+                CommandLineException commandLineException("unknown option or missing value, " + name);
+                throw commandLineException;
+            }
+            else if (filePath.empty())
+                filePath = name;
+            else
+            {
+                CommandLineException commandLineException("only one log file can be written");
+                throw commandLineException;
+            }
+        }
+
+        if (filePath.empty())
+        {
+            CommandLineException commandLineException("no log file given");
+            throw commandLineException;
+        }
+        if (spec.productCount == 0 || spec.userCount == 0 || spec.hostCount == 0 || spec.secondsBetweenCheckOuts <= 0)
+        {
+            CommandLineException commandLineException("products, users, hosts and the gap must be more than 0");
+            throw commandLineException;
+        }
+    }
+}
+
+
+int main(int argc, char* argv[])
+{
+    std::vector<std::string> arguments(argv + 1, argv + argc);
+    if (!arguments.empty() && (arguments.front() == "-h" || arguments.front() == "--help"))
+    {
+        std::cout << usageText;
+        return 0;
+    }
+
+    LogSpec spec;
+    std::string filePath;
+    try
+    {
+        parseGeneratorCommandLine(arguments, spec, filePath);
+        GeneratedLog log = generateLog(spec, filePath);
+        std::cout << filePath << ": " << log.size << " bytes, " << log.lineCount << " lines, "
+                  << log.eventCount << " events, " << log.newYearCount << " New Years\n";
+    }
+    catch (CommandLineException& e)
+    {
+        std::cerr << e.what() << "\n\n" << usageText;
+        return 2;
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,87 @@
+// Copyright 2014 Steve Robinson
+//
+// This file is part of RLM Log Reader.
+//
+// RLM Log Reader is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// RLM Log Reader is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with RLM Log Reader.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "BufferedWriter.h"
+#include "Exceptions.h"
+
+
+namespace
+{
+    const size_t BufferSize = 1 << 20;
+}
+
+
+BufferedWriter::BufferedWriter(const std::string& filePath, bool append, bool binary)
+    : m_filePath(filePath),
+      m_file(fopen(filePath.c_str(), binary ? (append ? "ab" : "wb") : (append ? "a" : "w"))),
+      m_buffer(BufferSize),
+      m_used(0),
+      m_failed(false)
+{
+    if (m_file == nullptr)
+    {
+        CannotOpenFileException cannotOpenFileException(filePath);
+        throw cannotOpenFileException;
+    }
+}
+
+
+BufferedWriter::~BufferedWriter()
+{
+    // Errors can't be reported from here, so callers that care call close()
+    if (m_file != nullptr)
+    {
+        flush();
+        fclose(m_file);
+    }
+}
+
+
+uint64_t BufferedWriter::position()
+{
+    flush();
+    fflush(m_file);
+#ifdef _WIN32
+    return static_cast<uint64_t>(_ftelli64(m_file));
+#else
+    return static_cast<uint64_t>(ftello(m_file));
+#endif
+}
+
+
+void BufferedWriter::close()
+{
+    flush();
+    m_failed |= (fclose(m_file) != 0);
+    m_file = nullptr;
+
+    if (m_failed)
+    {
+        CannotOpenFileException cannotOpenFileException(m_filePath);
+        throw cannotOpenFileException;
+    }
+}
+
+
+void BufferedWriter::flush()
+{
+    if (m_used > 0)
+    {
+        m_failed |= (fwrite(m_buffer.data(), 1, m_used, m_file) != m_used);
+        m_used = 0;
+    }
+}
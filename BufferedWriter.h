@@ -0,0 +1,116 @@
+// Copyright 2014 Steve Robinson
+//
+// This file is part of RLM Log Reader.
+//
+// RLM Log Reader is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// RLM Log Reader is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with RLM Log Reader.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+// Output file with a large buffer of its own.  Text is copied straight into the buffer
+// and numbers are formatted into it with std::to_chars, so writing big CSVs costs about
+// as much as the I/O.  Files are opened in text mode, like std::ofstream by default,
+// unless they're binary.
+class BufferedWriter
+{
+    public:
+        // Throws CannotOpenFileException.  When appending, writing starts at the end of the file.
+        explicit BufferedWriter(const std::string& filePath, bool append = false, bool binary = false);
+        ~BufferedWriter();
+        BufferedWriter(const BufferedWriter&) = delete;
+        BufferedWriter& operator=(const BufferedWriter&) = delete;
+
+        void write(std::string_view text);
+        void write(char character);
+        template <typename T>
+        void writeNumber(T number);
+        void writeFixed(double number, int precision);
+
+        // Where the next byte will go in the file
+        uint64_t position();
+
+        // Writes out whatever is buffered and closes the file.  Throws CannotOpenFileException
+        // if any of the writes failed.
+        void close();
+    private:
+        void flush();
+
+        std::string m_filePath;
+        FILE* m_file;
+        std::vector<char> m_buffer;
+        size_t m_used;
+        bool m_failed;
+};
+
+
+inline void BufferedWriter::write(std::string_view text)
+{
+    if (text.size() > m_buffer.size() - m_used)
+    {
+        flush();
+        if (text.size() > m_buffer.size())
+        {
+            m_failed |= (fwrite(text.data(), 1, text.size(), m_file) != text.size());
+            return;
+        }
+    }
+    memcpy(m_buffer.data() + m_used, text.data(), text.size());
+    m_used += text.size();
+}
+
+
+inline void BufferedWriter::write(char character)
+{
+    if (m_used == m_buffer.size())
+    {
+        flush();
+    }
+    m_buffer[m_used++] = character;
+}
+
+
+template <typename T>
+void BufferedWriter::writeNumber(T number)
+{
+    // Room for any 64-bit integer and its sign
+    const size_t longestNumber = 21;
+    if (m_buffer.size() - m_used < longestNumber)
+    {
+        flush();
+    }
+    std::to_chars_result result = std::to_chars(m_buffer.data() + m_used, m_buffer.data() + m_buffer.size(), number);
+    m_used = result.ptr - m_buffer.data();
+}
+
+
+inline void BufferedWriter::writeFixed(double number, int precision)
+{
+    // Room for the longest double in fixed notation
+    const size_t longestNumber = 400;
+    if (m_buffer.size() - m_used < longestNumber)
+    {
+        flush();
+    }
+    std::to_chars_result result = std::to_chars(m_buffer.data() + m_used, m_buffer.data() + m_buffer.size(),
+                                                number, std::chars_format::fixed, precision);
+    m_used = result.ptr - m_buffer.data();
+}
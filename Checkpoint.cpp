@@ -0,0 +1,422 @@
+// Copyright 2014 Steve Robinson
+//
+// This file is part of RLM Log Reader.
+//
+// RLM Log Reader is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// RLM Log Reader is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with RLM Log Reader.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "Checkpoint.h"
+#include "Exceptions.h"
+#include "UsageAggregator.h"
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+
+namespace
+{
+    // Bump when the layout changes, so old checkpoints are ignored instead of misread
+    const std::string CheckpointHeader = "RLM Log Reader checkpoint 3";
+
+    // Enough of the log to tell a rotated or rewritten file from the one that was read
+    const uint64_t TailHashBytes = 4096;
+
+
+    // Each field is a line of "name value".  Lists of numbers follow their length on the
+    // same line, and lists of strings put one string on each of the lines that follow,
+    // since strings from the log can hold any character but a line break.
+    bool readField(std::istream& stream, const std::string& name, std::string& value)
+    {
+        std::string line;
+        if (!std::getline(stream, line) || line.compare(0, name.size() + 1, name + " ") != 0)
+        {
+            return false;
+        }
+        value = line.substr(name.size() + 1);
+        return true;
+    }
+
+
+    template <typename T>
+    bool readNumber(std::istream& stream, const std::string& name, T& number)
+    {
+        std::string value;
+        if (!readField(stream, name, value))
+        {
+            return false;
+        }
+        std::istringstream values(value);
+        return static_cast<bool>(values >> number);
+    }
+
+
+    template <typename T>
+    bool readNumbers(std::istringstream& values, std::vector<T>& numbers)
+    {
+        size_t size;
+        if (!(values >> size))
+        {
+            return false;
+        }
+        numbers.resize(size);
+        for (T& number : numbers)
+        {
+            if (!(values >> number))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+
+    template <typename T>
+    bool readNumbers(std::istream& stream, const std::string& name, std::vector<T>& numbers)
+    {
+        std::string value;
+        if (!readField(stream, name, value))
+        {
+            return false;
+        }
+        std::istringstream values(value);
+        return readNumbers(values, numbers);
+    }
+
+
+    template <typename T>
+    bool readMatrix(std::istream& stream, const std::string& name, std::vector<std::vector<T>>& matrix)
+    {
+        size_t rows;
+        if (!readNumber(stream, name, rows))
+        {
+            return false;
+        }
+        matrix.resize(rows);
+        std::string line;
+        for (std::vector<T>& row : matrix)
+        {
+            if (!std::getline(stream, line))
+            {
+                return false;
+            }
+            std::istringstream values(line);
+            if (!readNumbers(values, row))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+
+    bool readStrings(std::istream& stream, const std::string& name, std::vector<std::string>& strings)
+    {
+        size_t size;
+        if (!readNumber(stream, name, size))
+        {
+            return false;
+        }
+        strings.resize(size);
+        for (std::string& string : strings)
+        {
+            if (!std::getline(stream, string))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+
+    bool readEvents(std::istream& stream, EventTable& events)
+    {
+        std::vector<std::string> texts;
+        if (!readStrings(stream, "texts", texts))
+        {
+            return false;
+        }
+        events = EventTable();
+        for (uint32_t id=0; id < texts.size(); ++id)
+        {
+            // The ids only line up if the strings were distinct, as they are when written
+            if (events.addText(texts.at(id)) != id)
+            {
+                return false;
+            }
+        }
+
+        size_t eventCount;
+        if (!readNumber(stream, "events", eventCount))
+        {
+            return false;
+        }
+        events.reserve(eventCount);
+
+        std::string line;
+        for (size_t event=0; event < eventCount; ++event)
+        {
+            if (!std::getline(stream, line))
+            {
+                return false;
+            }
+            std::istringstream values(line);
+            int type;
+            int64_t timestamp;
+            int count;
+            std::vector<uint32_t> textIds(7);
+            values >> type >> timestamp >> count;
+            for (uint32_t& id : textIds)
+            {
+                values >> id;
+            }
+            if (!values || type < OutEvent || type > ProductEvent)
+            {
+                return false;
+            }
+            for (uint32_t id : textIds)
+            {
+                if (id >= texts.size() && id != EventTable::NoText)
+                {
+                    return false;
+                }
+            }
+
+            size_t row = events.addEvent(static_cast<eventType>(type));
+            events.timestamp.at(row) = timestamp;
+            events.count.at(row) = count;
+            events.date.at(row) = textIds.at(0);
+            events.time.at(row) = textIds.at(1);
+            events.product.at(row) = textIds.at(2);
+            events.version.at(row) = textIds.at(3);
+            events.user.at(row) = textIds.at(4);
+            events.host.at(row) = textIds.at(5);
+            events.handle.at(row) = textIds.at(6);
+        }
+        return true;
+    }
+
+
+    template <typename T>
+    void writeNumbers(std::ostream& stream, const std::vector<T>& numbers)
+    {
+        stream << numbers.size();
+        for (const T& number : numbers)
+        {
+            stream << " " << number;
+        }
+        stream << "\n";
+    }
+
+
+    template <typename T>
+    void writeMatrix(std::ostream& stream, const std::string& name, const std::vector<std::vector<T>>& matrix)
+    {
+        stream << name << " " << matrix.size() << "\n";
+        for (const std::vector<T>& row : matrix)
+        {
+            writeNumbers(stream, row);
+        }
+    }
+
+
+    void writeStrings(std::ostream& stream, const std::string& name, const std::vector<std::string>& strings)
+    {
+        stream << name << " " << strings.size() << "\n";
+        for (const std::string& string : strings)
+        {
+            stream << string << "\n";
+        }
+    }
+
+
+    void writeEvents(std::ostream& stream, const EventTable& events)
+    {
+        stream << "texts " << events.textCount() << "\n";
+        for (uint32_t id=0; id < events.textCount(); ++id)
+        {
+            stream << events.text(id) << "\n";
+        }
+
+        stream << "events " << events.size() << "\n";
+        for (size_t row=0; row < events.size(); ++row)
+        {
+            stream << events.type.at(row) << " " << events.timestamp.at(row) << " " << events.count.at(row) << " "
+                   << events.date.at(row) << " " << events.time.at(row) << " "
+                   << events.product.at(row) << " " << events.version.at(row) << " "
+                   << events.user.at(row) << " " << events.host.at(row) << " "
+                   << events.handle.at(row) << "\n";
+        }
+    }
+
+
+    // The counts are all resized together as products are found, so anything else
+    // means the file was damaged
+    bool isConsistent(const Checkpoint& checkpoint)
+    {
+        size_t products = checkpoint.licenseCounts.size();
+        if (products > checkpoint.products.size() ||
+            checkpoint.uniqueLicenseCounts.size() != products ||
+            checkpoint.maxLicenseCounts.size() != products ||
+            checkpoint.rowLicenseCounts.size() != products ||
+            checkpoint.rowUniqueLicenseCounts.size() != products ||
+            checkpoint.rowMaxLicenseCounts.size() != products ||
+            checkpoint.licenseCountsByUserAndProduct.size() > checkpoint.users.size() ||
+            checkpoint.closedDurations.size() > checkpoint.users.size() ||
+            checkpoint.periodClock.size() != PeriodClockFields ||
+            checkpoint.periodUsage.size() != checkpoint.periodProducts.size())
+        {
+            return false;
+        }
+        for (const std::vector<size_t>& row : checkpoint.licenseCountsByUserAndProduct)
+        {
+            if (row.size() != products)
+            {
+                return false;
+            }
+        }
+        for (const std::vector<int64_t>& row : checkpoint.closedDurations)
+        {
+            if (row.size() > checkpoint.products.size())
+            {
+                return false;
+            }
+        }
+        for (const std::vector<int64_t>& row : checkpoint.periodUsage)
+        {
+            if (row.size() != PeriodUsageFields)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+
+bool readCheckpoint(const std::string& filePath, Checkpoint& checkpoint)
+{
+    std::ifstream myfile(filePath.c_str(), std::ios::binary);
+    std::string header;
+    if (!myfile.is_open() || !std::getline(myfile, header) || header != CheckpointHeader)
+    {
+        return false;
+    }
+
+    std::string end;
+    bool read = readNumber(myfile, "format", checkpoint.fileFormat) &&
+                readNumber(myfile, "outputs", checkpoint.outputs) &&
+                readNumber(myfile, "usagePeriod", checkpoint.usagePeriod) &&
+                readNumber(myfile, "offset", checkpoint.offset) &&
+                readNumber(myfile, "tailHash", checkpoint.tailHash) &&
+                readNumber(myfile, "lineCount", checkpoint.lineCount) &&
+                readField(myfile, "eventYear", checkpoint.eventYear) &&
+                readNumbers(myfile, "outputSizes", checkpoint.outputSizes) &&
+                readNumber(myfile, "finalDurationSize", checkpoint.finalDurationSize) &&
+                readNumber(myfile, "finalPeriodSize", checkpoint.finalPeriodSize) &&
+                readStrings(myfile, "products", checkpoint.products) &&
+                readStrings(myfile, "users", checkpoint.users) &&
+                readNumbers(myfile, "licenseCounts", checkpoint.licenseCounts) &&
+                readNumbers(myfile, "uniqueLicenseCounts", checkpoint.uniqueLicenseCounts) &&
+                readNumbers(myfile, "maxLicenseCounts", checkpoint.maxLicenseCounts) &&
+                readNumbers(myfile, "rowLicenseCounts", checkpoint.rowLicenseCounts) &&
+                readNumbers(myfile, "rowUniqueLicenseCounts", checkpoint.rowUniqueLicenseCounts) &&
+                readNumbers(myfile, "rowMaxLicenseCounts", checkpoint.rowMaxLicenseCounts) &&
+                readMatrix(myfile, "licenseCountsByUserAndProduct", checkpoint.licenseCountsByUserAndProduct) &&
+                readMatrix(myfile, "closedDurations", checkpoint.closedDurations) &&
+                readNumbers(myfile, "periodClock", checkpoint.periodClock) &&
+                readStrings(myfile, "periodProducts", checkpoint.periodProducts) &&
+                readMatrix(myfile, "periodUsage", checkpoint.periodUsage) &&
+                readEvents(myfile, checkpoint.events) &&
+                std::getline(myfile, end) && end == "end";
+
+    return read && isConsistent(checkpoint);
+}
+
+
+void writeCheckpoint(const std::string& filePath, const Checkpoint& checkpoint)
+{
+    // Written alongside and renamed over the old checkpoint, so a run that dies part way
+    // through leaves either the old checkpoint or the new one
+    std::string tempFilePath = filePath + ".tmp";
+    std::ofstream myfile(tempFilePath.c_str(), std::ios::binary);
+    if (!myfile.is_open())
+    {
+        CannotOpenFileException cannotOpenFileException(tempFilePath);
+        throw cannotOpenFileException;
+    }
+
+    myfile << CheckpointHeader << "\n";
+    myfile << "format " << checkpoint.fileFormat << "\n";
+    myfile << "outputs " << checkpoint.outputs << "\n";
+    myfile << "usagePeriod " << checkpoint.usagePeriod << "\n";
+    myfile << "offset " << checkpoint.offset << "\n";
+    myfile << "tailHash " << checkpoint.tailHash << "\n";
+    myfile << "lineCount " << checkpoint.lineCount << "\n";
+    myfile << "eventYear " << checkpoint.eventYear << "\n";
+    myfile << "outputSizes ";
+    writeNumbers(myfile, checkpoint.outputSizes);
+    myfile << "finalDurationSize " << checkpoint.finalDurationSize << "\n";
+    myfile << "finalPeriodSize " << checkpoint.finalPeriodSize << "\n";
+    writeStrings(myfile, "products", checkpoint.products);
+    writeStrings(myfile, "users", checkpoint.users);
+    myfile << "licenseCounts ";
+    writeNumbers(myfile, checkpoint.licenseCounts);
+    myfile << "uniqueLicenseCounts ";
+    writeNumbers(myfile, checkpoint.uniqueLicenseCounts);
+    myfile << "maxLicenseCounts ";
+    writeNumbers(myfile, checkpoint.maxLicenseCounts);
+    myfile << "rowLicenseCounts ";
+    writeNumbers(myfile, checkpoint.rowLicenseCounts);
+    myfile << "rowUniqueLicenseCounts ";
+    writeNumbers(myfile, checkpoint.rowUniqueLicenseCounts);
+    myfile << "rowMaxLicenseCounts ";
+    writeNumbers(myfile, checkpoint.rowMaxLicenseCounts);
+    writeMatrix(myfile, "licenseCountsByUserAndProduct", checkpoint.licenseCountsByUserAndProduct);
+    writeMatrix(myfile, "closedDurations", checkpoint.closedDurations);
+    myfile << "periodClock ";
+    writeNumbers(myfile, checkpoint.periodClock);
+    writeStrings(myfile, "periodProducts", checkpoint.periodProducts);
+    writeMatrix(myfile, "periodUsage", checkpoint.periodUsage);
+    writeEvents(myfile, checkpoint.events);
+    myfile << "end\n";
+    myfile.close();
+
+    if (myfile.fail())
+    {
+        CannotOpenFileException cannotOpenFileException(tempFilePath);
+        throw cannotOpenFileException;
+    }
+
+    std::error_code error;
+    std::filesystem::rename(tempFilePath, filePath, error);
+    if (error)
+    {
+        CannotOpenFileException cannotOpenFileException(filePath);
+        throw cannotOpenFileException;
+    }
+}
+
+
+uint64_t hashLogTail(std::string_view data, uint64_t offset)
+{
+    // FNV-1a, which unlike std::hash gives the same answer from one build to the next
+    uint64_t start = offset > TailHashBytes ? offset - TailHashBytes : 0;
+    uint64_t hash = 14695981039346656037ull;
+    for (uint64_t position=start; position < offset; ++position)
+    {
+        hash ^= static_cast<unsigned char>(data[position]);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
@@ -0,0 +1,69 @@
+// Copyright 2014 Steve Robinson
+//
+// This file is part of RLM Log Reader.
+//
+// RLM Log Reader is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// RLM Log Reader is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with RLM Log Reader.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "EventTable.h"
+
+
+// Everything an incremental analysis needs to carry on reading a log where the previous
+// run stopped.  Events are only carried while some output still depends on them: the
+// starts, shutdowns and denials listed in the summary, and the checkouts from the
+// oldest one that's still open onward, along with their checkins.
+struct Checkpoint
+{
+    int fileFormat = 0;
+    unsigned int outputs = 0;               // outputFile flags the previous run published
+    int usagePeriod = 0;
+    uint64_t offset = 0;                    // Bytes of the log read, always up to a line break
+    uint64_t tailHash = 0;                  // Hash of the bytes before offset, to spot a replaced log
+    size_t lineCount = 0;
+    std::string eventYear;
+
+    std::vector<uint64_t> outputSizes;      // Size of each output file when it was written
+    uint64_t finalDurationSize = 0;         // Bytes of the usage duration file no later event can change
+    uint64_t finalPeriodSize = 0;           // Likewise for the usage by period file
+
+    std::vector<std::string> products;
+    std::vector<std::string> users;
+    std::vector<size_t> licenseCounts;
+    std::vector<size_t> uniqueLicenseCounts;
+    std::vector<int> maxLicenseCounts;
+    std::vector<size_t> rowLicenseCounts;  // The counts as of the last usage over time row
+    std::vector<size_t> rowUniqueLicenseCounts;
+    std::vector<int> rowMaxLicenseCounts;
+    std::vector<std::vector<size_t>> licenseCountsByUserAndProduct;
+    std::vector<std::vector<int64_t>> closedDurations;  // Nanoseconds by user and product
+    std::vector<int64_t> periodClock;       // UsageAggregator state as of the last event
+    std::vector<std::string> periodProducts;
+    std::vector<std::vector<int64_t>> periodUsage;
+
+    EventTable events;
+};
+
+
+// Returns false, leaving checkpoint in an unspecified state, if the file is missing,
+// from another version or damaged
+bool readCheckpoint(const std::string& filePath, Checkpoint& checkpoint);
+void writeCheckpoint(const std::string& filePath, const Checkpoint& checkpoint);
+
+// Hash of the last few kilobytes of data before offset
+uint64_t hashLogTail(std::string_view data, uint64_t offset);
@@ -0,0 +1,344 @@
+// Copyright 2014 Steve Robinson
+//
+// This file is part of RLM Log Reader.
+//
+// RLM Log Reader is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// RLM Log Reader is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with RLM Log Reader.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "CommandLine.h"
+#include "Exceptions.h"
+#include "Utilities.h"
+#include "date/date.h"
+#include <algorithm>
+#include <cstdlib>
+#include <sstream>
+
+
+namespace
+{
+    const std::string& optionValue(const std::vector<std::string>& arguments, size_t& argument)
+    {
+        if (argument + 1 >= arguments.size())
+        {
+            CommandLineException commandLineException(arguments.at(argument) + " needs a value");
+            throw commandLineException;
+        }
+        ++argument;
+        return arguments.at(argument);
+    }
+
+
+    size_t numberValue(const std::vector<std::string>& arguments, size_t& argument, const std::string& description)
+    {
+        const std::string& value = optionValue(arguments, argument);
+        if (value.empty() || value.find_first_not_of("0123456789") != std::string::npos)
+        {
+            CommandLineException commandLineException(description + " '" + value + "' isn't a number");
+            throw commandLineException;
+        }
+        return strtoul(value.c_str(), nullptr, 10);
+    }
+
+
+    // Times are given as the logs write them, MM/DD/YYYY HH:MM[:SS]
+    int64_t parseTime(const std::string& value)
+    {
+        std::string dateTime = value;
+        if (std::count(value.begin(), value.end(), ':') == 1)
+        {
+            dateTime.append(":00");
+        }
+
+        std::istringstream stream(dateTime);
+        date::sys_seconds time;
+        stream >> date::parse("%m/%d/%Y %T", time);
+        if (stream.fail())
+        {
+            CommandLineException commandLineException("'" + value + "' isn't a time like 03/31/2013 14:05");
+            throw commandLineException;
+        }
+        return time.time_since_epoch().count();
+    }
+
+
+    unsigned int parseOutputs(const std::string& outputList)
+    {
+        std::vector<std::string> names;
+        tokenizeString(",", outputList, names);
+
+        unsigned int outputs = 0;
+        for (const std::string& name : names)
+        {
+            if (name == "summary")
+                outputs |= SummaryOutput;
+            else if (name == "events")
+                outputs |= EventDataOutput;
+            else if (name == "usage")
+                outputs |= UsageOverTimeOutput;
+            else if (name == "usage-changes")
+                outputs |= UsageOverTimeOutput | SparseUsageOverTime;
+            else if (name == "duration")
+                outputs |= UsageDurationOutput;
+            else if (name == "total")
+                outputs |= TotalDurationOutput;
+            else if (name == "period")
+                outputs |= UsageByPeriodOutput;
+            else if (name == "parquet")
+                outputs |= ParquetOutputs;
+            else if (name == "profile")
+                outputs |= ProfileOutput;
+            else if (name == "all")
+                outputs |= AllOutputs;
+            else
+            {
+                CommandLineException commandLineException("unknown output '" + name + "'");
+                throw commandLineException;
+            }
+        }
+
+        if (outputs == 0)
+        {
+            CommandLineException commandLineException("no outputs selected");
+            throw commandLineException;
+        }
+        return outputs;
+    }
+}
+
+
+void parseCommandLine(const std::vector<std::string>& arguments, CommandLineOptions& options)
+{
+    for (size_t argument=0; argument < arguments.size(); ++argument)
+    {
+        const std::string& name = arguments.at(argument);
+
+        if (name == "-h" || name == "--help")
+        {
+            options.help = true;
+            return;
+        }
+        else if (name == "-o" || name == "--output")
+        {
+            options.outputDirectory = optionValue(arguments, argument);
+        }
+        else if (name == "--overwrite")
+        {
+            const std::string& policy = optionValue(arguments, argument);
+            if (policy == "overwrite")
+                options.overwrite = OverwriteExisting;
+            else if (policy == "skip")
+                options.overwrite = SkipExisting;
+            else if (policy == "fail")
+                options.overwrite = FailOnExisting;
+            else
+            {
+                CommandLineException commandLineException("unknown overwrite policy '" + policy + "'");
+                throw commandLineException;
+            }
+        }
+        else if (name == "--outputs")
+        {
+            options.outputs = parseOutputs(optionValue(arguments, argument));
+        }
+        else if (name == "--period")
+        {
+            const std::string& period = optionValue(arguments, argument);
+            if (period == "minute")
+                options.period = PerMinute;
+            else if (period == "hour")
+                options.period = PerHour;
+            else if (period == "day")
+                options.period = PerDay;
+            else if (period == "week")
+                options.period = PerWeek;
+            else
+            {
+                CommandLineException commandLineException("unknown period '" + period + "'");
+                throw commandLineException;
+            }
+        }
+        else if (name == "-j" || name == "--threads")
+        {
+            options.threadCount = numberValue(arguments, argument, "thread count");
+        }
+        else if (name == "--incremental")
+        {
+            options.incremental = true;
+        }
+        else if (name == "--cache")
+        {
+            options.cache = true;
+        }
+        else if (name == "--pool")
+        {
+            options.poolName = optionValue(arguments, argument);
+        }
+        else if (name == "--at")
+        {
+            options.queryFrom = parseTime(optionValue(arguments, argument));
+            options.queryRange = false;
+            options.query = true;
+        }
+        else if (name == "--between")
+        {
+            std::vector<std::string> times;
+            const std::string& range = optionValue(arguments, argument);
+            tokenizeString(",", range, times);
+            if (times.size() != 2)
+            {
+                CommandLineException commandLineException("--between takes two times separated by a comma");
+                throw commandLineException;
+            }
+            options.queryFrom = parseTime(times.at(0));
+            options.queryTo = parseTime(times.at(1));
+            if (options.queryFrom > options.queryTo)
+            {
+                CommandLineException commandLineException("'" + range + "' ends before it starts");
+                throw commandLineException;
+            }
+            options.queryRange = true;
+            options.query = true;
+        }
+        else if (name == "--product")
+        {
+            options.queryProduct = optionValue(arguments, argument);
+        }
+        else if (name == "--follow")
+        {
+            options.follow = true;
+        }
+        else if (name == "--flush-interval")
+        {
+            options.flushInterval = numberValue(arguments, argument, "flush interval");
+        }
+        else if (name == "--report")
+        {
+            options.reportPath = optionValue(arguments, argument);
+        }
+        else if (name.size() > 1 && name.at(0) == '-')
+        {
+            CommandLineException commandLineException("unknown option '" + name + "'");
+            throw commandLineException;
+        }
+        else
+        {
+            options.inputPaths.push_back(name);
+        }
+    }
+
+    if (options.inputPaths.empty())
+    {
+        CommandLineException commandLineException("no log files given");
+        throw commandLineException;
+    }
+    // Queries only need somewhere to write when they keep a cache
+    if (options.outputDirectory.empty() && (!options.query || options.cache))
+    {
+        CommandLineException commandLineException("no output directory given");
+        throw commandLineException;
+    }
+    if (options.follow && options.inputPaths.size() != 1)
+    {
+        CommandLineException commandLineException("--follow takes a single log file");
+        throw commandLineException;
+    }
+    if (options.cache && (options.incremental || options.follow))
+    {
+        CommandLineException commandLineException("--cache can't be used with --incremental or --follow");
+        throw commandLineException;
+    }
+    if (options.query && (options.incremental || options.follow))
+    {
+        CommandLineException commandLineException("--at and --between can't be used with --incremental or --follow");
+        throw commandLineException;
+    }
+    if (!options.queryProduct.empty() && !options.query)
+    {
+        CommandLineException commandLineException("--product needs --at or --between");
+        throw commandLineException;
+    }
+    if (!options.poolName.empty() && (options.incremental || options.cache || options.follow))
+    {
+        CommandLineException commandLineException("--pool can't be used with --incremental, --cache or --follow");
+        throw commandLineException;
+    }
+    if ((options.incremental || options.follow) && (options.outputs & ParquetOutputs))
+    {
+        CommandLineException commandLineException("parquet can't be used with --incremental or --follow");
+        throw commandLineException;
+    }
+}
+
+
+std::string commandLineUsage(const std::string& programName)
+{
+    return "Usage: " + programName + " [options] -o <output directory> <log file or directory>...\n"
+        "       " + programName + " --at <time> | --between <time>,<time> [options] <log file or directory>...\n"
+        "\n"
+        "Analyzes RLM report and ISV logs without the GUI.  A single log file writes its\n"
+        "results into the output directory.  Several logs, or a directory of them, write\n"
+        "each log's results into a subdirectory named after it.  Logs compressed with gzip\n"
+        "or zstd are read as they are.\n"
+        "\n"
+        "Options:\n"
+        "  -o, --output <dir>       Directory for the results, which must exist\n"
+        "  --overwrite <policy>     When results already exist: overwrite, skip or fail (default)\n"
+        "  --outputs <list>         Comma-separated results to write: summary, usage, duration,\n"
+        "                           total, period, events or all (default: summary,usage,\n"
+        "                           duration,total).  usage-changes writes the usage over time\n"
+        "                           as a line for each product that changed, instead of every\n"
+        "                           product.  period sums up the usage of report logs by period.\n"
+        "                           parquet writes the events and, for report logs, the\n"
+        "                           checkout durations as Parquet tables, which are written\n"
+        "                           whole, so not with --incremental or --follow.\n"
+        "                           profile writes the time and memory each stage of the\n"
+        "                           analysis took as JSON, which isn't included in all.\n"
+        "  --period <length>        Period for the period output: minute, hour (default), day\n"
+        "                           or week\n"
+        "  -j, --threads <n>        Threads to use, 0 for every core (default)\n"
+        "  --incremental            Only read what was added to each log since the last\n"
+        "                           --incremental run, and add to its results.  When a log\n"
+        "                           is replaced it's read again from the start, so pair\n"
+        "                           this with --overwrite overwrite for rotated logs.\n"
+        "  --cache                  Keep each log's events in a cache beside its results, and\n"
+        "                           read them from there instead of the log while the log\n"
+        "                           is unchanged\n"
+        "  --pool <name>            Analyze the report logs as the servers of one license pool,\n"
+        "                           writing a single result named after the pool into the\n"
+        "                           output directory\n"
+        "  --follow                 Keep watching a single log, printing its license usage\n"
+        "                           as lines are added, until interrupted.  Results are\n"
+        "                           kept up to date as with --incremental.\n"
+        "  --flush-interval <s>     Seconds between writing results while following (default 60)\n"
+        "  --at <time>              Print the licenses of each product in use at a time, given\n"
+        "                           as MM/DD/YYYY HH:MM[:SS], instead of writing any results\n"
+        "  --between <from>,<to>    Likewise, print the most and the average licenses in use\n"
+        "                           between two times.  Only report logs give the year of\n"
+        "                           each event, so ISV logs fail either query.\n"
+        "  --product <name>         Only query this product\n"
+        "  --report <file>          Also write the per-log results and timings as CSV\n"
+        "  -h, --help               Show this help\n"
+        "\n"
+        "Each log's result is printed as a tab-separated line:\n"
+        "  OK|SKIPPED|FAILED  seconds  log file  output directory  error\n"
+        "\n"
+        "Queries print a tab-separated line for each product of each log:\n"
+        "  log file  product  in use            (--at)\n"
+        "  log file  product  peak  average     (--between)\n"
+        "  log file  FAILED   error             (a log that can't be queried)\n"
+        "\n"
+        "While following, each change in usage is printed as a tab-separated line:\n"
+        "  last event time  product in use/total (unique users)...  denials\n"
+        "\n"
+        "Exit codes: 0 success, 1 at least one log failed, 2 invalid command line\n";
+}
@@ -0,0 +1,63 @@
+// Copyright 2014 Steve Robinson
+//
+// This file is part of RLM Log Reader.
+//
+// RLM Log Reader is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// RLM Log Reader is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with RLM Log Reader.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "BatchAnalysis.h"
+
+
+enum exitCode
+{
+    ExitSuccess = 0,
+    ExitLogFailed = 1,      // At least one log couldn't be analyzed or published
+    ExitBadArguments = 2
+};
+
+
+struct CommandLineOptions
+{
+    std::vector<std::string> inputPaths;
+    std::string outputDirectory;
+    overwritePolicy overwrite = FailOnExisting;
+    unsigned int outputs = StandardOutputs;
+    usagePeriod period = PerHour;
+    size_t threadCount = 0;
+    std::string reportPath;
+    bool incremental = false;
+    bool cache = false;
+    std::string poolName;
+    // Querying the usage instead of publishing results, at queryFrom, or between it and
+    // queryTo for a range, in seconds since the epoch like the event timestamps
+    bool query = false;
+    bool queryRange = false;
+    int64_t queryFrom = 0;
+    int64_t queryTo = 0;
+    std::string queryProduct;   // Every product when empty
+    bool follow = false;
+    size_t flushInterval = 60;  // Seconds between writing the results while following
+    bool help = false;
+};
+
+
+// Reads the arguments that follow the program name.  Throws CommandLineException
+// describing the first problem found.
+void parseCommandLine(const std::vector<std::string>& arguments, CommandLineOptions& options);
+
+std::string commandLineUsage(const std::string& programName);
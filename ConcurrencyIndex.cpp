@@ -0,0 +1,105 @@
+// Copyright 2014 Steve Robinson
+//
+// This file is part of RLM Log Reader.
+//
+// RLM Log Reader is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// RLM Log Reader is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with RLM Log Reader.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "ConcurrencyIndex.h"
+
+#include <algorithm>
+#include <cassert>
+
+
+ConcurrencyIndex::ConcurrencyIndex(int64_t initialUsage, const std::vector<UsageStep>& steps)
+    : m_initialUsage(initialUsage),
+      m_stepCount(steps.size())
+{
+    m_times.reserve(m_stepCount);
+    m_area.reserve(m_stepCount);
+    m_peaks.resize(2 * m_stepCount);
+    for (size_t step=0; step < m_stepCount; ++step)
+    {
+        int64_t time = steps.at(step).time;
+        int64_t area = 0;
+        if (step > 0)
+        {
+            time = std::max(time, m_times.back());
+            area = m_area.back() + m_peaks.at(m_stepCount + step - 1) * (time - m_times.back());
+        }
+        m_times.push_back(time);
+        m_area.push_back(area);
+        m_peaks.at(m_stepCount + step) = steps.at(step).inUse;
+    }
+    for (size_t node=m_stepCount; node-- > 1;)
+    {
+        m_peaks.at(node) = std::max(m_peaks.at(2 * node), m_peaks.at(2 * node + 1));
+    }
+}
+
+
+int64_t ConcurrencyIndex::usageAt(int64_t time) const
+{
+    size_t after = std::upper_bound(m_times.begin(), m_times.end(), time) - m_times.begin();
+    return after == 0 ? m_initialUsage : m_peaks.at(m_stepCount + after - 1);
+}
+
+
+int64_t ConcurrencyIndex::peak(int64_t from, int64_t to) const
+{
+    assert(from <= to);
+
+    // The usage at from, and after every step from then on up to to
+    int64_t peakUsage = usageAt(from);
+    size_t first = std::lower_bound(m_times.begin(), m_times.end(), from) - m_times.begin();
+    size_t end = std::upper_bound(m_times.begin(), m_times.end(), to) - m_times.begin();
+    for (size_t left = first + m_stepCount, right = end + m_stepCount; left < right; left /= 2, right /= 2)
+    {
+        if (left % 2 == 1)
+        {
+            peakUsage = std::max(peakUsage, m_peaks.at(left++));
+        }
+        if (right % 2 == 1)
+        {
+            peakUsage = std::max(peakUsage, m_peaks.at(--right));
+        }
+    }
+    return peakUsage;
+}
+
+
+double ConcurrencyIndex::average(int64_t from, int64_t to) const
+{
+    assert(from <= to);
+    if (from == to)
+    {
+        return static_cast<double>(usageAt(from));
+    }
+    return static_cast<double>(integral(to) - integral(from)) / static_cast<double>(to - from);
+}
+
+
+int64_t ConcurrencyIndex::integral(int64_t time) const
+{
+    // Measured from the first step, so it's negative before then
+    if (m_stepCount == 0)
+    {
+        return m_initialUsage * time;
+    }
+    size_t after = std::upper_bound(m_times.begin(), m_times.end(), time) - m_times.begin();
+    if (after == 0)
+    {
+        return m_initialUsage * (time - m_times.front());
+    }
+    return m_area.at(after - 1) + m_peaks.at(m_stepCount + after - 1) * (time - m_times.at(after - 1));
+}
@@ -0,0 +1,60 @@
+// Copyright 2014 Steve Robinson
+//
+// This file is part of RLM Log Reader.
+//
+// RLM Log Reader is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// RLM Log Reader is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with RLM Log Reader.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+// A change in the licenses of a product in use, at a time in seconds since the epoch
+struct UsageStep
+{
+    int64_t time;
+    int64_t inUse;
+};
+
+
+// The licenses of one product in use over time, indexed so the usage at any moment,
+// and the peak and time-weighted average over any span of time, are each found in
+// logarithmic time.  The usage is a step function: before the first step it's the
+// initial usage, and after each step it stays as that step left it.  Steps logged in
+// the same second all count towards the peak, though only the last one lasts.
+class ConcurrencyIndex
+{
+    public:
+        // Steps are in the order they were logged.  A time before the one before it
+        // counts as that one, as it does when usage is summed up by period.
+        ConcurrencyIndex(int64_t initialUsage, const std::vector<UsageStep>& steps);
+
+        int64_t usageAt(int64_t time) const;
+        // Both include usage at from and to.  from must not be after to.
+        int64_t peak(int64_t from, int64_t to) const;
+        double average(int64_t from, int64_t to) const;
+    private:
+        int64_t integral(int64_t time) const;
+
+        int64_t m_initialUsage;
+        std::vector<int64_t> m_times;
+        // Licenses in use integrated from the first step to each step
+        std::vector<int64_t> m_area;
+        // Binary tree of the usage after each step, leaves from m_stepCount on, where each
+        // node holds the larger of its children
+        size_t m_stepCount;
+        std::vector<int64_t> m_peaks;
+};
@@ -0,0 +1,277 @@
+// Copyright 2014 Steve Robinson
+//
+// This file is part of RLM Log Reader.
+//
+// RLM Log Reader is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// RLM Log Reader is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with RLM Log Reader.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "DecompressingReader.h"
+#include "Exceptions.h"
+
+#include <algorithm>
+#include <climits>
+#include <memory>
+#include <zlib.h>
+#include <zstd.h>
+
+
+namespace
+{
+    const unsigned char GzipMagic[] = {0x1f, 0x8b};
+    const unsigned char ZstdMagic[] = {0x28, 0xb5, 0x2f, 0xfd};
+
+    template <size_t length>
+    bool startsWith(std::string_view data, const unsigned char (&magic)[length])
+    {
+        return data.size() >= length && std::equal(magic, magic + length, data.begin(),
+            [](unsigned char magicByte, char dataByte) { return magicByte == static_cast<unsigned char>(dataByte); });
+    }
+}
+
+
+compressionFormat detectCompression(std::string_view data)
+{
+    if (startsWith(data, GzipMagic))
+    {
+        return GzipCompressed;
+    }
+    if (startsWith(data, ZstdMagic))
+    {
+        return ZstdCompressed;
+    }
+    return Uncompressed;
+}
+
+
+DecompressingReader::DecompressingReader(std::string_view compressed,
+                                         compressionFormat format,
+                                         size_t bufferSize)
+    : m_compressed(compressed),
+      m_format(format),
+      m_bufferSize(bufferSize),
+      m_bufferedBytes(0),
+      m_finished(false),
+      m_stopping(false)
+{
+    m_thread = std::thread(&DecompressingReader::decompress, this);
+}
+
+
+DecompressingReader::~DecompressingReader()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_changed.notify_all();
+    m_thread.join();
+}
+
+
+bool DecompressingReader::read(std::string& block)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_changed.wait(lock, [this]() { return !m_blocks.empty() || m_finished; });
+
+    if (m_blocks.empty())
+    {
+        if (m_error)
+        {
+            std::rethrow_exception(m_error);
+        }
+        return false;
+    }
+
+    block.swap(m_blocks.front());
+    m_blocks.pop_front();
+    m_bufferedBytes -= block.size();
+    lock.unlock();
+    m_changed.notify_all();
+    return true;
+}
+
+
+void DecompressingReader::decompress()
+{
+    try
+    {
+        if (m_format == GzipCompressed)
+        {
+            inflateGzip();
+        }
+        else
+        {
+            decompressZstd();
+        }
+    }
+    catch (...)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_error = std::current_exception();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_finished = true;
+    }
+    m_changed.notify_all();
+}
+
+
+void DecompressingReader::inflateGzip()
+{
+    z_stream stream = {};
+    if (inflateInit2(&stream, 16 + MAX_WBITS) != Z_OK)
+    {
+        DecompressionException decompressionException("out of memory");
+        throw decompressionException;
+    }
+    std::unique_ptr<z_stream, int (*)(z_stream*)> streamEnd(&stream, inflateEnd);
+
+    std::string block(BlockSize, '\0');
+    size_t filled = 0;
+    size_t position = 0;
+    bool memberEnded = false;
+    bool blockFilled = false;
+    while (true)
+    {
+        // zlib counts in 32 bits, so larger logs are fed to it a piece at a time
+        if (stream.avail_in == 0 && position < m_compressed.size())
+        {
+            size_t pieceSize = std::min<size_t>(m_compressed.size() - position, UINT_MAX);
+            stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(m_compressed.data() + position));
+            stream.avail_in = static_cast<uInt>(pieceSize);
+            position += pieceSize;
+        }
+        // A full block may have left more output waiting even once the input's used up
+        if (stream.avail_in == 0 && !blockFilled)
+        {
+            break;
+        }
+
+        stream.next_out = reinterpret_cast<Bytef*>(&block.at(filled));
+        stream.avail_out = static_cast<uInt>(block.size() - filled);
+        int result = inflate(&stream, Z_NO_FLUSH);
+        filled = block.size() - stream.avail_out;
+        memberEnded = (result == Z_STREAM_END);
+        blockFilled = (filled == block.size());
+        if (result != Z_OK && result != Z_STREAM_END && result != Z_BUF_ERROR)
+        {
+            DecompressionException decompressionException(stream.msg != nullptr ? stream.msg : "damaged gzip data");
+            throw decompressionException;
+        }
+
+        if (blockFilled)
+        {
+            if (!pushBlock(block))
+            {
+                return;
+            }
+            block.assign(BlockSize, '\0');
+            filled = 0;
+        }
+
+        if (memberEnded)
+        {
+            // Another member may follow, but anything else after the end is ignored,
+            // as gzip itself does
+            std::string_view rest = m_compressed.substr(position - stream.avail_in);
+            if (detectCompression(rest) != GzipCompressed)
+            {
+                break;
+            }
+            inflateReset(&stream);
+        }
+    }
+
+    if (!memberEnded)
+    {
+        DecompressionException decompressionException("the gzip data ends part way through");
+        throw decompressionException;
+    }
+    block.resize(filled);
+    pushBlock(block);
+}
+
+
+void DecompressingReader::decompressZstd()
+{
+    std::unique_ptr<ZSTD_DStream, size_t (*)(ZSTD_DStream*)> stream(ZSTD_createDStream(), ZSTD_freeDStream);
+    if (!stream)
+    {
+        DecompressionException decompressionException("out of memory");
+        throw decompressionException;
+    }
+
+    std::string block(BlockSize, '\0');
+    size_t filled = 0;
+    ZSTD_inBuffer input = {m_compressed.data(), m_compressed.size(), 0};
+    size_t result = 0;
+    while (true)
+    {
+        ZSTD_outBuffer output = {&block.at(filled), block.size() - filled, 0};
+        result = ZSTD_decompressStream(stream.get(), &output, &input);
+        if (ZSTD_isError(result))
+        {
+            DecompressionException decompressionException(ZSTD_getErrorName(result));
+            throw decompressionException;
+        }
+        filled += output.pos;
+
+        if (filled == block.size())
+        {
+            if (!pushBlock(block))
+            {
+                return;
+            }
+            block.assign(BlockSize, '\0');
+            filled = 0;
+        }
+        else if (input.pos == input.size)
+        {
+            // The output wasn't filled, so everything decompressed so far is out
+            break;
+        }
+    }
+
+    // Otherwise the last frame isn't finished
+    if (result != 0)
+    {
+        DecompressionException decompressionException("the zstd data ends part way through");
+        throw decompressionException;
+    }
+    block.resize(filled);
+    pushBlock(block);
+}
+
+
+bool DecompressingReader::pushBlock(std::string& block)
+{
+    if (block.empty())
+    {
+        return true;
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_changed.wait(lock, [this]() { return m_bufferedBytes < m_bufferSize || m_stopping; });
+    if (m_stopping)
+    {
+        return false;
+    }
+
+    m_bufferedBytes += block.size();
+    m_blocks.push_back(std::move(block));
+    lock.unlock();
+    m_changed.notify_all();
+    return true;
+}
@@ -0,0 +1,79 @@
+// Copyright 2014 Steve Robinson
+//
+// This file is part of RLM Log Reader.
+//
+// RLM Log Reader is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// RLM Log Reader is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with RLM Log Reader.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+
+enum compressionFormat
+{
+    Uncompressed,
+    GzipCompressed,
+    ZstdCompressed
+};
+
+// Looks at the magic bytes at the start of data, not the file name
+compressionFormat detectCompression(std::string_view data);
+
+
+// Decompresses a gzip or zstd log on a thread of its own, handing it out a block at a
+// time, so the blocks can be parsed while the ones after them are still being
+// decompressed.  At most bufferSize bytes are held ahead of the reader, so memory
+// stays bounded however large the log.  Concatenated gzip members and zstd frames are
+// read as one stream, as the command-line tools do.
+class DecompressingReader
+{
+    public:
+        static constexpr size_t BlockSize = 1 << 20;
+
+        // compressed must stay valid until the reader is destroyed
+        DecompressingReader(std::string_view compressed,
+                            compressionFormat format,
+                            size_t bufferSize = 16 * BlockSize);
+        ~DecompressingReader();
+        DecompressingReader(const DecompressingReader&) = delete;
+        DecompressingReader& operator=(const DecompressingReader&) = delete;
+
+        // Replaces block with the next one.  Returns false at the end of the log, or
+        // throws DecompressionException where the compressed data is damaged.
+        bool read(std::string& block);
+    private:
+        void decompress();
+        void inflateGzip();
+        void decompressZstd();
+        bool pushBlock(std::string& block);
+
+        std::string_view m_compressed;
+        compressionFormat m_format;
+        size_t m_bufferSize;
+
+        std::mutex m_mutex;
+        std::condition_variable m_changed;
+        std::deque<std::string> m_blocks;
+        size_t m_bufferedBytes;
+        bool m_finished;
+        bool m_stopping;
+        std::exception_ptr m_error;
+        std::thread m_thread;
+};
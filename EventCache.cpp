@@ -0,0 +1,367 @@
+// Copyright 2014 Steve Robinson
+//
+// This file is part of RLM Log Reader.
+//
+// RLM Log Reader is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// RLM Log Reader is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with RLM Log Reader.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "EventCache.h"
+#include "BufferedWriter.h"
+#include "Exceptions.h"
+#include "MappedFile.h"
+
+#include <cstring>
+#include <filesystem>
+#include <vector>
+
+
+namespace
+{
+    const char CacheHeader[8] = {'R', 'L', 'M', 'E', 'V', 'T', '1', '\n'};
+    const uint64_t ByteOrderMark = 0x0102030405060708ull;
+    const size_t Alignment = 8;
+
+
+    // Hash of a whole log.  Four lanes of 64-bit words keep it running at about the
+    // speed memory can be read, and unlike std::hash it's the same from one build to
+    // the next.
+    uint64_t hashContents(std::string_view contents)
+    {
+        const uint64_t offsetBasis = 14695981039346656037ull;
+        const uint64_t prime = 1099511628211ull;
+        const size_t laneCount = 4;
+        uint64_t lanes[laneCount] = {offsetBasis, offsetBasis + 1, offsetBasis + 2, offsetBasis + 3};
+
+        size_t position = 0;
+        for (; position + laneCount * sizeof(uint64_t) <= contents.size(); position += laneCount * sizeof(uint64_t))
+        {
+            for (size_t lane = 0; lane < laneCount; ++lane)
+            {
+                uint64_t word;
+                memcpy(&word, contents.data() + position + lane * sizeof(uint64_t), sizeof(word));
+                uint64_t mixed = (lanes[lane] ^ word) * prime;
+                lanes[lane] = (mixed << 31) | (mixed >> 33);
+            }
+        }
+
+        uint64_t hash = offsetBasis;
+        for (uint64_t lane : lanes)
+        {
+            hash = (hash ^ lane) * prime;
+        }
+        for (; position < contents.size(); ++position)
+        {
+            hash = (hash ^ static_cast<unsigned char>(contents[position])) * prime;
+        }
+        return hash;
+    }
+
+
+    class CacheWriter
+    {
+        public:
+            explicit CacheWriter(const std::string& filePath)
+                : m_writer(filePath, false, true),
+                  m_offset(0)
+            {
+            }
+
+            void number(uint64_t value)
+            {
+                bytes(&value, sizeof(value));
+            }
+
+            void text(std::string_view value)
+            {
+                number(value.size());
+                bytes(value.data(), value.size());
+                pad();
+            }
+
+            template <typename T>
+            void column(const std::vector<T>& values)
+            {
+                bytes(values.data(), values.size() * sizeof(T));
+                pad();
+            }
+
+            void bytes(const void* data, size_t size)
+            {
+                m_writer.write(std::string_view(static_cast<const char*>(data), size));
+                m_offset += size;
+            }
+
+            void pad()
+            {
+                while (m_offset % Alignment != 0)
+                {
+                    m_writer.write('\0');
+                    ++m_offset;
+                }
+            }
+
+            void close()
+            {
+                m_writer.close();
+            }
+        private:
+            BufferedWriter m_writer;
+            uint64_t m_offset;
+    };
+
+
+    // Every read checks it stays within the file, so a damaged cache is turned down
+    // rather than read past its end
+    class CacheReader
+    {
+        public:
+            explicit CacheReader(std::string_view data)
+                : m_data(data),
+                  m_offset(0)
+            {
+            }
+
+            bool number(uint64_t& value)
+            {
+                return bytes(&value, sizeof(value));
+            }
+
+            bool text(std::string& value)
+            {
+                uint64_t size;
+                if (!number(size) || size > m_data.size() - m_offset)
+                {
+                    return false;
+                }
+                value.assign(m_data.data() + m_offset, size);
+                m_offset += size;
+                return pad();
+            }
+
+            template <typename T>
+            bool column(std::vector<T>& values, uint64_t count)
+            {
+                if (count > (m_data.size() - m_offset) / sizeof(T))
+                {
+                    return false;
+                }
+                values.resize(count);
+                return bytes(values.data(), count * sizeof(T)) && pad();
+            }
+
+            bool bytes(void* data, size_t size)
+            {
+                if (size > m_data.size() - m_offset)
+                {
+                    return false;
+                }
+                memcpy(data, m_data.data() + m_offset, size);
+                m_offset += size;
+                return true;
+            }
+
+            bool pad()
+            {
+                m_offset += (Alignment - m_offset % Alignment) % Alignment;
+                return m_offset <= m_data.size();
+            }
+
+            bool atEnd() const
+            {
+                return m_offset == m_data.size();
+            }
+        private:
+            std::string_view m_data;
+            uint64_t m_offset;
+    };
+
+
+    bool validTextIds(const std::vector<uint32_t>& column, size_t textCount)
+    {
+        for (uint32_t id : column)
+        {
+            if (id >= textCount && id != EventTable::NoText)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+
+LogIdentity identifyLog(const std::string& filePath, std::string_view contents)
+{
+    LogIdentity log;
+    std::error_code error;
+    log.path = std::filesystem::absolute(filePath, error).string();
+    log.size = contents.size();
+    log.modified = std::filesystem::last_write_time(filePath, error).time_since_epoch().count();
+    log.contentHash = hashContents(contents);
+    return log;
+}
+
+
+bool readEventCache(const std::string& filePath,
+                    const LogIdentity& log,
+                    CachedLog& cachedLog,
+                    EventTable& events)
+{
+    std::error_code error;
+    if (!std::filesystem::exists(filePath, error))
+    {
+        return false;
+    }
+    MappedFile file(filePath);
+    CacheReader reader(file.data());
+
+    // The log is checked before anything else is read
+    char header[sizeof(CacheHeader)];
+    uint64_t byteOrderMark, size, modified, contentHash;
+    std::string path;
+    if (!reader.bytes(header, sizeof(header)) ||
+        memcmp(header, CacheHeader, sizeof(header)) != 0 ||
+        !reader.number(byteOrderMark) || byteOrderMark != ByteOrderMark ||
+        !reader.number(size) || size != log.size ||
+        !reader.number(modified) || static_cast<int64_t>(modified) != log.modified ||
+        !reader.number(contentHash) || contentHash != log.contentHash ||
+        !reader.text(path) || path != log.path)
+    {
+        return false;
+    }
+
+    uint64_t fileFormat, lineCount, eventCount, textCount;
+    if (!reader.number(fileFormat) || !reader.number(lineCount) ||
+        !reader.text(cachedLog.eventYear) ||
+        !reader.number(eventCount) || !reader.number(textCount) || textCount == 0)
+    {
+        return false;
+    }
+    cachedLog.fileFormat = static_cast<int>(fileFormat);
+    cachedLog.lineCount = lineCount;
+
+    // Text is stored end to end, with where each one starts.  The table already has
+    // the empty string as id 0, and the rest have to get the same ids they had before.
+    std::vector<uint64_t> textOffsets;
+    std::vector<char> textData;
+    if (!reader.column(textOffsets, textCount + 1) ||
+        !reader.column(textData, textOffsets.back()))
+    {
+        return false;
+    }
+    for (uint64_t id = 1; id < textCount; ++id)
+    {
+        if (textOffsets.at(id) > textOffsets.at(id + 1) || textOffsets.at(id + 1) > textData.size())
+        {
+            return false;
+        }
+        std::string_view text(textData.data() + textOffsets.at(id), textOffsets.at(id + 1) - textOffsets.at(id));
+        if (events.addText(text) != id)
+        {
+            return false;
+        }
+    }
+
+    std::vector<uint8_t> types;
+    if (!reader.column(types, eventCount) ||
+        !reader.column(events.timestamp, eventCount) ||
+        !reader.column(events.date, eventCount) ||
+        !reader.column(events.time, eventCount) ||
+        !reader.column(events.product, eventCount) ||
+        !reader.column(events.version, eventCount) ||
+        !reader.column(events.user, eventCount) ||
+        !reader.column(events.host, eventCount) ||
+        !reader.column(events.count, eventCount) ||
+        !reader.column(events.handle, eventCount) ||
+        !reader.atEnd())
+    {
+        return false;
+    }
+
+    events.type.resize(eventCount);
+    for (size_t row = 0; row < eventCount; ++row)
+    {
+        if (types.at(row) > ProductEvent)
+        {
+            return false;
+        }
+        events.type.at(row) = static_cast<eventType>(types.at(row));
+    }
+
+    return validTextIds(events.date, textCount) &&
+           validTextIds(events.time, textCount) &&
+           validTextIds(events.product, textCount) &&
+           validTextIds(events.version, textCount) &&
+           validTextIds(events.user, textCount) &&
+           validTextIds(events.host, textCount) &&
+           validTextIds(events.handle, textCount);
+}
+
+
+void writeEventCache(const std::string& filePath,
+                     const LogIdentity& log,
+                     const CachedLog& cachedLog,
+                     const EventTable& events)
+{
+    // Written alongside and renamed over the old cache, so a run that dies part way
+    // through never leaves half a cache behind
+    std::string tempFilePath = filePath + ".tmp";
+    {
+        CacheWriter writer(tempFilePath);
+        writer.bytes(CacheHeader, sizeof(CacheHeader));
+        writer.number(ByteOrderMark);
+        writer.number(log.size);
+        writer.number(static_cast<uint64_t>(log.modified));
+        writer.number(log.contentHash);
+        writer.text(log.path);
+
+        writer.number(static_cast<uint64_t>(cachedLog.fileFormat));
+        writer.number(cachedLog.lineCount);
+        writer.text(cachedLog.eventYear);
+        writer.number(events.size());
+        writer.number(events.textCount());
+
+        std::vector<uint64_t> textOffsets(1, 0);
+        for (uint32_t id = 0; id < events.textCount(); ++id)
+        {
+            textOffsets.push_back(textOffsets.back() + events.text(id).size());
+        }
+        writer.column(textOffsets);
+        for (uint32_t id = 0; id < events.textCount(); ++id)
+        {
+            writer.bytes(events.text(id).data(), events.text(id).size());
+        }
+        writer.pad();
+
+        std::vector<uint8_t> types(events.type.begin(), events.type.end());
+        writer.column(types);
+        writer.column(events.timestamp);
+        writer.column(events.date);
+        writer.column(events.time);
+        writer.column(events.product);
+        writer.column(events.version);
+        writer.column(events.user);
+        writer.column(events.host);
+        writer.column(events.count);
+        writer.column(events.handle);
+        writer.close();
+    }
+
+    std::error_code error;
+    std::filesystem::rename(tempFilePath, filePath, error);
+    if (error)
+    {
+        CannotOpenFileException cannotOpenFileException(filePath);
+        throw cannotOpenFileException;
+    }
+}
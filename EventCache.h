@@ -0,0 +1,60 @@
+// Copyright 2014 Steve Robinson
+//
+// This file is part of RLM Log Reader.
+//
+// RLM Log Reader is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// RLM Log Reader is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with RLM Log Reader.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include "EventTable.h"
+
+
+// What a log was when its events were cached.  The cache is only used again for the
+// same path while the size, modification time and contents all still match.
+struct LogIdentity
+{
+    std::string path;           // Absolute
+    uint64_t size = 0;
+    int64_t modified = 0;       // Ticks of the file system clock
+    uint64_t contentHash = 0;
+};
+
+
+// What the rest of the analysis needs from reading the log, besides the events
+struct CachedLog
+{
+    int fileFormat = 0;
+    std::string eventYear;      // Year in effect at the end of the log
+    size_t lineCount = 0;
+};
+
+
+// contents is the whole log, as mapped from filePath
+LogIdentity identifyLog(const std::string& filePath, std::string_view contents);
+
+// The cache holds the event table's columns and text in the machine's own layout, each
+// an aligned block that's read from a mapping of the file with a single copy.  Returns
+// false, leaving cachedLog and events in an unspecified state, if the cache is missing,
+// from another version, damaged or for anything other than log.
+bool readEventCache(const std::string& filePath,
+                    const LogIdentity& log,
+                    CachedLog& cachedLog,
+                    EventTable& events);
+void writeEventCache(const std::string& filePath,
+                     const LogIdentity& log,
+                     const CachedLog& cachedLog,
+                     const EventTable& events);
@@ -0,0 +1,154 @@
+// Copyright 2014 Steve Robinson
+//
+// This file is part of RLM Log Reader.
+//
+// RLM Log Reader is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// RLM Log Reader is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with RLM Log Reader.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "EventTable.h"
+#include <algorithm>
+#include <iterator>
+
+
+const char* eventTypeName(eventType type)
+{
+    switch (type)
+    {
+        case OutEvent:
+            return "OUT";
+        case InEvent:
+            return "IN";
+        case DenyEvent:
+            return "DENY";
+        case StartEvent:
+            return "START";
+        case ShutdownEvent:
+            return "SHUTDOWN";
+        case ProductEvent:
+            return "PRODUCT";
+    }
+    return "";
+}
+
+
+EventTable::EventTable()
+{
+    // Id 0 is always the empty string, which keeps unset fields printable
+    addText("");
+}
+
+
+size_t EventTable::size() const
+{
+    return type.size();
+}
+
+
+void EventTable::reserve(size_t events)
+{
+    type.reserve(events);
+    timestamp.reserve(events);
+    date.reserve(events);
+    time.reserve(events);
+    product.reserve(events);
+    version.reserve(events);
+    user.reserve(events);
+    host.reserve(events);
+    count.reserve(events);
+    handle.reserve(events);
+}
+
+
+size_t EventTable::addEvent(eventType newType)
+{
+    type.push_back(newType);
+    timestamp.push_back(0);
+    date.push_back(0);
+    time.push_back(0);
+    product.push_back(0);
+    version.push_back(0);
+    user.push_back(0);
+    host.push_back(0);
+    count.push_back(0);
+    handle.push_back(NoText);
+
+    return type.size()-1;
+}
+
+
+void EventTable::append(const EventTable& other)
+{
+    // Adding the other table's text in id order keeps every string's id in first-seen order
+    std::vector<uint32_t> textIds(other.textCount());
+    for (uint32_t id=0; id < textIds.size(); ++id)
+    {
+        textIds.at(id) = addText(other.text(id));
+    }
+    auto translate = [&textIds](uint32_t id)
+    {
+        return id == NoText ? NoText : textIds[id];
+    };
+    auto appendText = [&translate](std::vector<uint32_t>& column, const std::vector<uint32_t>& otherColumn)
+    {
+        std::transform(otherColumn.begin(), otherColumn.end(), std::back_inserter(column), translate);
+    };
+
+    type.insert(type.end(), other.type.begin(), other.type.end());
+    timestamp.insert(timestamp.end(), other.timestamp.begin(), other.timestamp.end());
+    appendText(date, other.date);
+    appendText(time, other.time);
+    appendText(product, other.product);
+    appendText(version, other.version);
+    appendText(user, other.user);
+    appendText(host, other.host);
+    count.insert(count.end(), other.count.begin(), other.count.end());
+    appendText(handle, other.handle);
+}
+
+
+void EventTable::appendEvent(const EventTable& other, size_t row)
+{
+    auto copyText = [this, &other](uint32_t id)
+    {
+        return id == NoText ? NoText : addText(other.text(id));
+    };
+
+    size_t newRow = addEvent(other.type.at(row));
+    timestamp.at(newRow) = other.timestamp.at(row);
+    date.at(newRow) = copyText(other.date.at(row));
+    time.at(newRow) = copyText(other.time.at(row));
+    product.at(newRow) = copyText(other.product.at(row));
+    version.at(newRow) = copyText(other.version.at(row));
+    user.at(newRow) = copyText(other.user.at(row));
+    host.at(newRow) = copyText(other.host.at(row));
+    count.at(newRow) = other.count.at(row);
+    handle.at(newRow) = copyText(other.handle.at(row));
+}
+
+
+uint32_t EventTable::addText(std::string_view text)
+{
+    return m_text.add(text);
+}
+
+
+const std::string& EventTable::text(uint32_t id) const
+{
+    return m_text.at(id);
+}
+
+
+size_t EventTable::textCount() const
+{
+    return m_text.size();
+}
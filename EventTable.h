@@ -0,0 +1,75 @@
+// Copyright 2014 Steve Robinson
+//
+// This file is part of RLM Log Reader.
+//
+// RLM Log Reader is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// RLM Log Reader is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with RLM Log Reader.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "StringTable.h"
+
+
+enum eventType
+{
+    OutEvent,
+    InEvent,
+    DenyEvent,
+    StartEvent,
+    ShutdownEvent,
+    ProductEvent
+};
+
+const char* eventTypeName(eventType type);
+
+
+// Struct-of-arrays store for the events extracted from a log.  Each event is one
+// row across all of the columns.  Text fields are kept once in a dictionary and the
+// columns hold their ids, so analysis runs over contiguous integers.
+class EventTable
+{
+    public:
+        static constexpr uint32_t NoText = UINT32_MAX;
+
+        EventTable();
+        size_t size() const;
+        void reserve(size_t events);
+        size_t addEvent(eventType type);
+
+        // Appends every event of other, translating its text ids into this table's
+        void append(const EventTable& other);
+
+        // Appends a single event of other, copying the text it uses
+        void appendEvent(const EventTable& other, size_t row);
+
+        uint32_t addText(std::string_view text);
+        const std::string& text(uint32_t id) const;
+        size_t textCount() const;
+
+        std::vector<eventType> type;
+        std::vector<int64_t> timestamp; // Seconds since the epoch, report logs only
+        std::vector<uint32_t> date;
+        std::vector<uint32_t> time;
+        std::vector<uint32_t> product;  // Server name for START events
+        std::vector<uint32_t> version;
+        std::vector<uint32_t> user;
+        std::vector<uint32_t> host;
+        std::vector<int> count;
+        std::vector<uint32_t> handle;
+    private:
+        StringTable m_text;
+};
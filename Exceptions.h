@@ -142,6 +142,23 @@ private:
 };
 
 
+class DecompressionException: public std::exception
+{
+public:
+    DecompressionException(const std::string& reason)
+    {
+        m_error = "Unable to decompress the log: " + reason;
+    }
+    ~DecompressionException() throw() {}
+    virtual const char* what() const throw()
+    {
+        return m_error.c_str();
+    }
+private:
+    std::string m_error;
+};
+
+
 class InvalidIndexException: public std::exception
 {
 public:
@@ -157,3 +174,122 @@ public:
 private:
     std::string m_error;
 };
+
+
+class CommandLineException: public std::exception
+{
+public:
+    CommandLineException(std::string problem)
+    {
+        m_error = "Invalid command line: " + problem;
+    }
+    ~CommandLineException() throw() {}
+    virtual const char* what() const throw()
+    {
+        return m_error.c_str();
+    }
+private:
+    std::string m_error;
+};
+
+
+class IncrementalOutputsException: public std::exception
+{
+public:
+    IncrementalOutputsException()
+    {
+        m_error = "An incremental or segmented analysis can only publish the outputs it was started with";
+    }
+    ~IncrementalOutputsException() throw() {}
+    virtual const char* what() const throw()
+    {
+        return m_error.c_str();
+    }
+private:
+    std::string m_error;
+};
+
+
+class UnknownProductException: public std::exception
+{
+public:
+    UnknownProductException(const std::string& product)
+    {
+        m_error = "No product '" + product + "' in the log";
+    }
+    ~UnknownProductException() throw() {}
+    virtual const char* what() const throw()
+    {
+        return m_error.c_str();
+    }
+private:
+    std::string m_error;
+};
+
+
+class QueryFormatException: public std::exception
+{
+public:
+    QueryFormatException()
+    {
+        m_error = "Only report logs give the year of each event, so usage can't be looked up by time in this log";
+    }
+    ~QueryFormatException() throw() {}
+    virtual const char* what() const throw()
+    {
+        return m_error.c_str();
+    }
+private:
+    std::string m_error;
+};
+
+
+class PoolFormatException: public std::exception
+{
+public:
+    PoolFormatException(const std::string& filePath)
+    {
+        m_error = "Only report logs can be pooled, and this isn't one: " + filePath;
+    }
+    ~PoolFormatException() throw() {}
+    virtual const char* what() const throw()
+    {
+        return m_error.c_str();
+    }
+private:
+    std::string m_error;
+};
+
+
+class IncrementalParquetException: public std::exception
+{
+public:
+    IncrementalParquetException()
+    {
+        m_error = "Parquet files are written whole, so an incremental or segmented analysis can't publish them";
+    }
+    ~IncrementalParquetException() throw() {}
+    virtual const char* what() const throw()
+    {
+        return m_error.c_str();
+    }
+private:
+    std::string m_error;
+};
+
+
+class AnalysisCancelledException: public std::exception
+{
+public:
+    AnalysisCancelledException()
+    {
+        m_error = "The analysis was cancelled";
+    }
+    ~AnalysisCancelledException() throw() {}
+    virtual const char* what() const throw()
+    {
+        return m_error.c_str();
+    }
+private:
+    std::string m_error;
+};
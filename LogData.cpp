@@ -15,7 +15,11 @@
 // You should have received a copy of the GNU General Public License
 // along with RLM Log Reader.  If not, see <http://www.gnu.org/licenses/>.
 
+#include "BufferedWriter.h"
+#include "EventCache.h"
 #include "Exceptions.h"
+#include "ParquetWriter.h"
+#include "Tokenizer.h"
 #include "Utilities.h"
 
 #include <iostream>
@@ -25,354 +29,1371 @@
 #include <vector>
 #include <algorithm>
 #include <assert.h>
+#include <filesystem>
 #include <map>
+#include <queue>
+#include <thread>
+#include <unordered_map>
 #include "LogData.h"
 
 
-LogData::LogData(const std::string& inputFilePath, const std::string& outputDirectory)
+LogData::LogData(const std::string& inputFilePath,
+                 const std::string& outputDirectory,
+                 size_t threadCount,
+                 analysisMode mode,
+                 const unsigned int outputs,
+                 usagePeriod period,
+                 AnalysisProgress* progress)
+    : m_usagePeriod(period),
+      m_periodBaseline(period),
+      m_periodState(period)
 {
-    m_inputFilePath = inputFilePath;
+    initialize(outputDirectory, threadCount, mode, outputs, progress);
+    nameOutputs(inputFilePath);
+    getEventIndices();
+    if (m_analysisMode == IncrementalAnalysis)
+    {
+        resumeFromCheckpoint();
+    }
+
+    if (m_analysisMode == CachedAnalysis)
+    {
+        extractCachedEvents();
+    }
+    else
+    {
+        extractEvents();
+    }
+    prepareOutputs(m_outputs);
+}
+
+
+LogData::LogData(const std::vector<std::string>& inputFilePaths,
+                 const std::string& poolName,
+                 const std::string& outputDirectory,
+                 size_t threadCount,
+                 const unsigned int outputs,
+                 usagePeriod period,
+                 AnalysisProgress* progress)
+    : m_usagePeriod(period),
+      m_periodBaseline(period),
+      m_periodState(period)
+{
+    initialize(outputDirectory, threadCount, FullAnalysis, outputs, progress);
+    namePoolOutputs(poolName);
+
+    // The summary lists every log in the pool
+    for (const std::string& inputFilePath : inputFilePaths)
+    {
+        m_inputFilePath.append(m_inputFilePath.empty() ? "" : "\n");
+        m_inputFilePath.append(inputFilePath);
+    }
+
+    getEventIndices();
+    extractPooledEvents(inputFilePaths);
+    prepareOutputs(m_outputs);
+}
+
+
+LogData::LogData(usagePeriod period)
+    : m_usagePeriod(period),
+      m_periodBaseline(period),
+      m_periodState(period)
+{
+}
+
+
+void LogData::findExistingFiles(const std::string& inputFilePath,
+                                const std::string& outputDirectory,
+                                std::string& conflictedFileList,
+                                analysisMode mode,
+                                const unsigned int outputs,
+                                usagePeriod period)
+{
+    LogData logData(period);
+    logData.initialize(outputDirectory, 1, mode, outputs, nullptr);
+    logData.nameOutputs(inputFilePath);
+
+    // A resumed analysis adds to the files its last run wrote
+    Checkpoint checkpoint;
+    if (mode == IncrementalAnalysis &&
+        readCheckpoint(logData.m_checkpointPath, checkpoint) &&
+        logData.checkpointMatches(checkpoint))
+    {
+        return;
+    }
+    logData.checkForExistingFiles(conflictedFileList, outputs);
+}
+
+
+void LogData::findExistingPoolFiles(const std::string& poolName,
+                                    const std::string& outputDirectory,
+                                    std::string& conflictedFileList,
+                                    const unsigned int outputs)
+{
+    LogData logData(PerHour);
+    logData.initialize(outputDirectory, 1, FullAnalysis, outputs, nullptr);
+    logData.namePoolOutputs(poolName);
+    logData.checkForExistingFiles(conflictedFileList, outputs);
+}
+
+
+void LogData::initialize(const std::string& outputDirectory,
+                         size_t threadCount,
+                         analysisMode mode,
+                         const unsigned int outputs,
+                         AnalysisProgress* progress)
+{
+    m_threadCount = threadCount;
+    m_analysisMode = mode;
+    m_outputs = outputs;
     m_outputDirectory = outputDirectory;
+    m_endTimeRow = 0;
+    m_resumed = false;
+    m_startOffset = 0;
+    m_endOffset = 0;
+    m_lineCount = 0;
+    m_firstNewRow = 0;
+    m_previousProductCount = 0;
+    m_firstOpenCheckOut = 0;
+    m_finalDurationSize = 0;
+    m_finalPeriodSize = 0;
+    m_fromCache = false;
+    m_compression = Uncompressed;
+    m_concurrentRows = 0;
+    m_durationCurrent = false;
+    m_progress = progress;
+    if (outputs & ProfileOutput)
+    {
+        m_profile.enable();
+    }
+
+    if (readsInParts() && (m_outputs & ParquetOutputs))
+    {
+        IncrementalParquetException incrementalParquetException;
+        throw incrementalParquetException;
+    }
+}
+
+
+void LogData::nameOutputs(const std::string& inputFilePath)
+{
+    m_inputFilePath = inputFilePath;
     m_inputFileName = getFilenameFromFilepath(m_inputFilePath);
 
-    loadDataFromFile(m_inputFilePath, m_rawData);
+    // Lines are views into the mapped file, so nothing is copied until tokenizing.
+    // Compressed logs are decompressed a block at a time as they're parsed instead.
+    openInputFile(m_inputFilePath);
+    if (m_compression != Uncompressed)
+    {
+        // Results for log.gz are named after the log inside it
+        m_inputFileName = getFilenameFromFilepath(m_inputFileName);
+    }
 
     findFileFormat();
     setOutputPaths();
-    parseDataInto2DVector(m_rawData, m_allData);
-    extractEvents();
-    getConcurrentUsage();
+    if (m_analysisMode == IncrementalAnalysis)
+    {
+        m_checkpointPath = m_outputDirectory + "/" + m_inputFileName + "_Checkpoint.txt";
+    }
+}
 
-    if (m_fileFormat == ReportLog)
+
+void LogData::namePoolOutputs(const std::string& poolName)
+{
+    m_inputFileName = poolName;
+    m_fileFormat = ReportLog;
+    setOutputPaths();
+}
+
+
+void LogData::openInputFile(const std::string& inputFilePath)
+{
+    StageTimer stageTimer(m_profile, LoadStage);
+    if (m_progress)
     {
-        getUsageDuration();
+        m_progress->startStage(LoadStage, 0, 0);
+    }
+    m_inputFile.open(inputFilePath);
+    m_compression = detectCompression(m_inputFile.data());
+    m_profile.addCounts(LoadStage, 0, 0, m_inputFile.size());
+    if (m_progress)
+    {
+        m_progress->advance(m_inputFile.size(), 0);
+        m_progress->finishStage();
     }
 }
 
 
 void LogData::findFileFormat()
 {
+    StageTimer stageTimer(m_profile, FormatStage);
     m_fileFormat = Invalid;
-    size_t found;
-
-    // Don't search the whole file when the identifying markers are near the beginning
-    size_t linesToSearch = 20;
-    if (m_rawData.size() < linesToSearch)
+    if (m_compression == Uncompressed)
+    {
+        if (findFileFormatInLines(m_inputFile.data()))
+        {
+            return;
+        }
+    }
+    else
     {
-        linesToSearch = m_rawData.size();
+        // Only as much of the log is decompressed as it takes to find the format
+        DecompressingReader reader(m_inputFile.data(), m_compression, DecompressingReader::BlockSize);
+        std::string lines;
+        std::string block;
+        bool more = true;
+        while (more)
+        {
+            more = reader.read(block);
+            if (more)
+            {
+                lines.append(block);
+            }
+            size_t end = more ? lines.rfind('\n') + 1 : lines.size();
+            if (findFileFormatInLines(std::string_view(lines).substr(0, end)))
+            {
+                return;
+            }
+            lines.erase(0, end);
+        }
     }
 
-    for (size_t line=0; line<m_rawData.size(); ++line)
+    InvalidFileFormatException invalidFileFormatException;
+    throw invalidFileFormatException;
+}
+
+
+bool LogData::findFileFormatInLines(std::string_view data)
+{
+    size_t found;
+    size_t position = 0;
+    std::string_view line;
+
+    while (getNextLine(data, position, line))
     {
-        found = m_rawData.at(line).find("RLM Report Log Format");
+        found = line.find("RLM Report Log Format");
         if (found!=std::string::npos)
         {
             m_fileFormat = ReportLog;
-            return;
+            return true;
         }
         // Looking for the ISV log format, which is of this form:
         //   MM/YY HH:MM (isv)
-        found = m_rawData.at(line).find("/");
+        found = line.find("/");
         if (found!=std::string::npos)
         {
-            found = m_rawData.at(line).find(":");
+            found = line.find(":");
             if (found!=std::string::npos)
             {
-                found = m_rawData.at(line).find("(");
+                found = line.find("(");
                 if (found!=std::string::npos)
                 {
-                    found = m_rawData.at(line).find(")");
+                    found = line.find(")");
                     if (found!=std::string::npos)
                     {
                         // RLM itself has a log file that matches the form of the ISV log file, except instead
                         // of each line containing '(isv)', each line contains '(rlm)'.
                         // This log file doesn't have usage data in it, so it's not supported.
-                        found = m_rawData.at(line).find("(rlm)");
+                        found = line.find("(rlm)");
                         if (found==std::string::npos)
                         {
                             m_fileFormat = ISVLog;
-                            return;
+                            return true;
                         }
                     }
                 }
             }
         }
     }
-
-    InvalidFileFormatException invalidFileFormatException;
-    throw invalidFileFormatException;
+    return false;
 }
 
-size_t LogData::fileFormat()
+size_t LogData::fileFormat() const
 {
     return m_fileFormat;
 }
 
 
-void LogData::extractEvents()
+const AnalysisProfile& LogData::profile() const
 {
-    getEventIndices();
-
-    if (m_fileFormat == ISVLog)
-    {
-        standardizeLogFormatting();
-    }
-
-    std::string productName;
-    std::string userName;
-    size_t eventRow;
-
-    for (size_t row=0; row<m_allData.size(); ++row)
-    {
-        // Check for existence of date, and if so update the year
-        if (m_allData.at(row).size() == 2)
-        {
-            std::vector<std::string> tempVector;
-            tokenizeString("/", m_allData.at(row).at(0), tempVector);
-            if (tempVector.size() == 3)
-            {
-                m_eventYear = tempVector.at(2);
-            }
-        }
-
-        if (m_allData.at(row).size() > m_eventIndex)
-        {
-            if (m_allData.at(row).at(m_eventIndex) == "OUT")
-            {
-                loadEventIntoVector(m_allData.at(row), row, m_OUTindices);
+    return m_profile;
+}
 
-                eventRow = m_eventData.size()-1;
-                productName = m_eventData.at(eventRow).at(IndexProduct);
-                getUniqueItems(productName, m_uniqueProducts);
-                userName = m_eventData.at(eventRow).at(IndexUser);
-                getUniqueItems(userName, m_uniqueUsers);
 
-                eventRow = m_eventData.size()-1;
-                addYearToDate();
-                m_endTimeRow = eventRow;
-            }
-            else if (m_allData.at(row).at(m_eventIndex) == "IN")
-            {
-                loadEventIntoVector(m_allData.at(row), row, m_INindices);
+bool LogData::resumed() const
+{
+    return m_resumed;
+}
 
-                eventRow = m_eventData.size()-1;
-                productName = m_eventData.at(m_eventData.size()-1).at(IndexProduct);
-                getUniqueItems(productName, m_uniqueProducts);
-                userName = m_eventData.at(eventRow).at(IndexUser);
-                getUniqueItems(userName, m_uniqueUsers);
 
-                eventRow = m_eventData.size()-1;
-                addYearToDate();
-                m_endTimeRow = eventRow;
-            }
-            else if (m_allData.at(row).at(m_eventIndex) == "DENY")
-            {
-                loadEventIntoVector(m_allData.at(row), row, m_DENYindices);
+bool LogData::fromCache() const
+{
+    return m_fromCache;
+}
 
-                eventRow = m_eventData.size()-1;
-                productName = m_eventData.at(eventRow).at(IndexProduct);
-                addYearToDate();
-                m_denialEvents.push_back(m_eventData.at(eventRow));
-                m_endTimeRow = eventRow;
-            }
-            else if (m_allData.at(row).at(m_eventIndex) == "START")
-            {
-                loadEventIntoVector(m_allData.at(row), row, m_STARTindices);
-                eventRow = m_eventData.size()-1;
-                m_serverName = m_eventData.at(eventRow).at(3);
-                m_startEvents.push_back(m_eventData.at(eventRow));
 
-                if (m_fileFormat == ReportLog)
-                {
-                    
-                    std::vector<std::string> tempVector;
-                    tokenizeString("/", m_allData.at(row).at(RepSTARTIndexDate), tempVector);
-                    m_eventYear =  tempVector.at(2);
-                    m_endTimeRow = eventRow;
-                }
-            }
-            else if (m_allData.at(row).at(m_eventIndex) == "SHUTDOWN")
-            {
-                loadEventIntoVector(m_allData.at(row), row, m_SHUTindices);
+bool LogData::update()
+{
+    assert(m_analysisMode == IncrementalAnalysis);
 
-                eventRow = m_eventData.size()-1;
-                addYearToDate();
-                m_shutdownEvents.push_back(m_eventData.at(eventRow));
-                m_endTimeRow = eventRow;
-            }
-            else if (m_allData.at(row).at(m_eventIndex) == "PRODUCT")
-            {
-                loadEventIntoVector(m_allData.at(row), row, m_PRODUCTindices);
-                eventRow = m_eventData.size()-1;
-                productName = m_eventData.at(eventRow).at(1);
-                getUniqueItems(productName, m_uniqueProducts);
-            }
-        }
+    // The log must still start with what was read last time, rather than having been
+    // replaced by a new one
+    uint64_t tailHash = hashLogTail(m_inputFile.data(), m_endOffset);
+    openInputFile(m_inputFilePath);
+    if (m_inputFile.size() < m_endOffset || hashLogTail(m_inputFile.data(), m_endOffset) != tailHash)
+    {
+        return false;
     }
+
+    m_startOffset = m_endOffset;
+    extractEvents();
+    prepareOutputs(m_outputs);
+    return true;
 }
 
 
-void LogData::addYearToDate()
+void LogData::currentUsage(std::vector<ProductUsage>& usage)
 {
-    if (m_fileFormat == ReportLog)
+    getConcurrentUsage();
+    usage.clear();
+    for (size_t product=0; product < m_licenseCountNumbers.size(); ++product)
     {
-        size_t eventRow = m_eventData.size()-1;
-        std::string currentDate = m_eventData.at(eventRow).at(IndexDate);
-
-        // If a log event occurs within the first minute after midnight, it is logged before
-        // the string that provides the new year.  This code checks for events on Jan 1 at 00:00
-        // and increments the year.
-        if (currentDate == "01/01")
-        {
-            std::vector<std::string> timeVector;
-            tokenizeString(":", m_eventData.at(eventRow).at(IndexTime), timeVector);
-            if (timeVector.at(0) == "00" && timeVector.at(1) == "00")
-            {
-                int eventYearNumber = atoi(m_eventYear.c_str());
-                ++eventYearNumber;
-                m_eventYear = toString(eventYearNumber);
-            }
-        }
-
-        (m_eventData.at(eventRow).at(IndexDate)).append("/" + m_eventYear);
+        ProductUsage productUsage;
+        productUsage.product = m_uniqueProducts.at(product);
+        productUsage.licensesInUse = static_cast<int>(m_licenseCountNumbers.at(product));
+        productUsage.uniqueUsers = m_uniqueLicenseCountsByProduct.at(product);
+        productUsage.totalLicenses = m_maxLicenseCountsByProduct.at(product);
+        usage.push_back(productUsage);
     }
 }
 
 
-void LogData::getEventIndices()
+int64_t LogData::usageAt(const std::string& product, int64_t time)
 {
-    if (m_fileFormat == ReportLog)
-    {
-        m_eventIndex = 0;
-
-        m_OUTindices.push_back(m_eventIndex);
-        m_OUTindices.push_back(RepOUTIndexDate);
-        m_OUTindices.push_back(RepOUTIndexTime);
-        m_OUTindices.push_back(RepOUTIndexProduct);
-        m_OUTindices.push_back(RepOUTIndexVersion);
-        m_OUTindices.push_back(RepOUTIndexUser);
-        m_OUTindices.push_back(RepOUTIndexHost);
-        m_OUTindices.push_back(RepOUTIndexCount);
-        m_OUTindices.push_back(RepOUTIndexHandle);
-
-        m_INindices.push_back(m_eventIndex);
-        m_INindices.push_back(RepINIndexDate);
-        m_INindices.push_back(RepINIndexTime);
-        m_INindices.push_back(RepINIndexProduct);
-        m_INindices.push_back(RepINIndexVersion);
-        m_INindices.push_back(RepINIndexUser);
-        m_INindices.push_back(RepINIndexHost);
-        m_INindices.push_back(RepINIndexCount);
-        m_INindices.push_back(RepINIndexHandle);
+    return concurrencyIndex(product).usageAt(time);
+}
 
-        m_DENYindices.push_back(m_eventIndex);
-        m_DENYindices.push_back(RepDENYIndexDate);
-        m_DENYindices.push_back(RepDENYIndexTime);
-        m_DENYindices.push_back(RepDENYIndexProduct);
-        m_DENYindices.push_back(RepDENYIndexVersion);
-        m_DENYindices.push_back(RepDENYIndexUser);
-        m_DENYindices.push_back(RepDENYIndexHost);
-        m_DENYindices.push_back(RepDENYIndexCount);
 
-        m_STARTindices.push_back(m_eventIndex);
-        m_STARTindices.push_back(RepSTARTIndexDate);
-        m_STARTindices.push_back(RepSTARTIndexTime);
-        m_STARTindices.push_back(RepSTARTIndexServer);
+int64_t LogData::peakUsage(const std::string& product, int64_t from, int64_t to)
+{
+    return concurrencyIndex(product).peak(from, to);
+}
 
-        m_SHUTindices.push_back(m_eventIndex);
-        m_SHUTindices.push_back(RepSHUTIndexDate);
-        m_SHUTindices.push_back(RepSHUTIndexTime);
 
-        m_PRODUCTindices.push_back(m_eventIndex);
-        m_PRODUCTindices.push_back(RepPRODUCTIndexProduct);
-        m_PRODUCTindices.push_back(RepPRODUCTIndexVersion);
-        m_PRODUCTindices.push_back(RepPRODUCTIndexCount);
-    }
+double LogData::averageUsage(const std::string& product, int64_t from, int64_t to)
+{
+    return concurrencyIndex(product).average(from, to);
+}
 
-    else if (m_fileFormat == ISVLog)
-    {
-        // Count and Handle data is not available in isv log files
-        m_eventIndex = 3;
 
-        m_OUTindices.push_back(m_eventIndex);
-        m_OUTindices.push_back(isvOUTIndexDate);
-        m_OUTindices.push_back(isvOUTIndexTime);
-        m_OUTindices.push_back(isvOUTIndexProduct);
-        m_OUTindices.push_back(isvOUTIndexVersion);
-        m_OUTindices.push_back(isvOUTIndexUser);
-        m_OUTindices.push_back(isvOUTIndexHost);
-        m_OUTindices.push_back(isvOUTTokenCount);
+size_t LogData::denialCount() const
+{
+    return m_denialEvents.size();
+}
 
-        m_INindices.push_back(m_eventIndex);
-        m_INindices.push_back(isvINIndexDate);
-        m_INindices.push_back(isvINIndexTime);
-        m_INindices.push_back(isvINIndexProduct);
-        m_INindices.push_back(isvINIndexVersion);
-        m_INindices.push_back(isvINIndexUser);
-        m_INindices.push_back(isvINIndexHost);
-        m_INindices.push_back(isvINTokenCount);
 
-        m_DENYindices.push_back(m_eventIndex);
-        m_DENYindices.push_back(isvDENYIndexDate);
-        m_DENYindices.push_back(isvDENYIndexTime);
-        m_DENYindices.push_back(isvDENYIndexProduct);
-        m_DENYindices.push_back(isvDENYIndexVersion);
-        m_DENYindices.push_back(isvDENYIndexUser);
-        m_DENYindices.push_back(isvDENYIndexHost);
+std::string LogData::lastEventTime() const
+{
+    if (m_eventData.size() == 0)
+    {
+        return "";
+    }
+    return m_eventData.text(m_eventData.date.at(m_endTimeRow)) + " " +
+           m_eventData.text(m_eventData.time.at(m_endTimeRow));
+}
 
-        m_STARTindices.push_back(m_eventIndex);
-        m_STARTindices.push_back(isvSTARTIndexDate);
-        m_STARTindices.push_back(isvSTARTIndexTime);
-        m_STARTindices.push_back(isvSTARTIndexServer);
 
-        m_SHUTindices.push_back(m_eventIndex);
-        m_SHUTindices.push_back(isvSHUTIndexDate);
-        m_SHUTindices.push_back(isvSHUTIndexTime);
+void LogData::resumeFromCheckpoint()
+{
+    Checkpoint checkpoint;
+    if (readCheckpoint(m_checkpointPath, checkpoint) && checkpointMatches(checkpoint))
+    {
+        restoreCheckpoint(checkpoint);
     }
 }
 
 
-void LogData::standardizeLogFormatting()
+void LogData::restoreCheckpoint(Checkpoint& checkpoint)
 {
-    size_t i = 0;
-    int licenseUsageCount = 0;
+    // Start from nothing, since this also trims the state down after publishing
+    m_uniqueProducts = StringTable();
+    m_uniqueUsers = StringTable();
+    m_productIndices.clear();
+    m_userIndices.clear();
+    m_denialEvents.clear();
+    m_shutdownEvents.clear();
+    m_startEvents.clear();
+    m_usageRows.clear();
+    m_usageChanges.clear();
+    m_concurrencyIndices.clear();
+    m_endTimeRow = 0;
+
+    m_resumed = true;
+    m_startOffset = checkpoint.offset;
+    m_endOffset = checkpoint.offset;
+    m_lineCount = checkpoint.lineCount;
+    m_eventYear = checkpoint.eventYear;
+    m_finalDurationSize = checkpoint.finalDurationSize;
+    m_finalPeriodSize = checkpoint.finalPeriodSize;
+    m_previousProductCount = checkpoint.products.size();
+
+    for (const std::string& product : checkpoint.products)
+    {
+        m_uniqueProducts.add(product);
+    }
+    for (const std::string& user : checkpoint.users)
+    {
+        m_uniqueUsers.add(user);
+    }
 
-    for (size_t row=0; row<m_allData.size(); ++row)
+    m_licenseCountNumbers = checkpoint.licenseCounts;
+    m_uniqueLicenseCountsByProduct = checkpoint.uniqueLicenseCounts;
+    m_maxLicenseCountsByProduct = checkpoint.maxLicenseCounts;
+    m_licenseCountByProductAndUser = checkpoint.licenseCountsByUserAndProduct;
+    m_rowUsage.clear();
+    m_changedProducts.clear();
+    for (size_t product=0; product < checkpoint.rowLicenseCounts.size(); ++product)
     {
-        if (m_allData.at(row).size() > m_eventIndex)
+        m_rowUsage.push_back({checkpoint.rowLicenseCounts.at(product),
+                              checkpoint.rowUniqueLicenseCounts.at(product),
+                              checkpoint.rowMaxLicenseCounts.at(product)});
+        m_changedProducts.push_back(product);
+    }
+    m_usageBaseline = m_rowUsage;
+    m_periodBaseline.restore(checkpoint);
+    m_carriedDuration.clear();
+    for (const std::vector<int64_t>& durations : checkpoint.closedDurations)
+    {
+        m_carriedDuration.push_back(std::vector<std::chrono::nanoseconds>());
+        for (int64_t duration : durations)
         {
-            if (m_allData.at(row).at(m_eventIndex) == "OUT:")
-            {   
-                reformatEventName(row, "OUT");
-                reformatProductVersion(row, isvOUTIndexVersion, m_allData.at(row));
-                reformatUserHost(row, m_OUTindices);
-                reformatToken(m_allData.at(row));
-            }
-            else if (m_allData.at(row).at(m_eventIndex) == "IN:")
-            {
-                removeInDetails(row, m_allData.at(row));
-                checkForUnhandledINDetails(row); // call after the "remove" function
-
-                reformatEventName(row, "IN");
-                reformatProductVersion(row, isvINIndexVersion, m_allData.at(row));
-                reformatUserHost(row, m_INindices);
-                reformatToken(m_allData.at(row));
-            }
-            else if (m_allData.at(row).at(m_eventIndex) == "DENIED:")
-            {
-                removeNoGood(row, m_allData.at(row));
-                reformatEventName(row, "DENY");
-                reformatProductVersion(row, isvDENYIndexVersion, m_allData.at(row));
-                reformatUserHost(row, m_DENYindices);
-            }
-            else if (m_allData.at(row).at(m_eventIndex) == "Server")
-            {
-                reformatEventName(row, "START");
-            }
-            else if (m_allData.at(row).at(m_eventIndex) == "Shutdown")
-            {
-                reformatEventName(row, "SHUTDOWN");
-            }
+            m_carriedDuration.back().push_back(std::chrono::nanoseconds{duration});
+        }
+    }
+
+    // The carried events are registered again to list them in the summary and find the
+    // end time, but they're already counted in the usage
+    m_eventData = std::move(checkpoint.events);
+    for (size_t row=0; row < m_eventData.size(); ++row)
+    {
+        registerEvent(row);
+    }
+    m_firstNewRow = m_eventData.size();
+    m_concurrentRows = m_eventData.size();
+    m_durationCurrent = false;
+}
+
+
+bool LogData::checkpointMatches(const Checkpoint& checkpoint)
+{
+    std::string_view data = m_inputFile.data();
+    // Profiling doesn't change the results, so it can be turned on or off between runs
+    if (checkpoint.fileFormat != m_fileFormat ||
+        checkpoint.outputs != (m_outputs & ~ProfileOutput) ||
+        checkpoint.usagePeriod != m_usagePeriod ||
+        checkpoint.offset > data.size() ||
+        checkpoint.tailHash != hashLogTail(data, checkpoint.offset) ||
+        checkpoint.outputSizes.size() != m_outputPaths.size())
+    {
+        return false;
+    }
+
+    // Output files are added to, so they have to be just as the last run left them
+    for (size_t file=0; file < m_outputPaths.size(); ++file)
+    {
+        if (publishes(m_outputs, file) &&
+            (!fileExists(m_outputPaths.at(file)) ||
+             getFileSize(m_outputPaths.at(file)) != checkpoint.outputSizes.at(file)))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+void LogData::saveCheckpoint(Checkpoint& checkpoint)
+{
+    // The next run carries on from the usage and the durations, whatever's published
+    getConcurrentUsage();
+    getUsageDuration();
+
+    checkpoint.fileFormat = m_fileFormat;
+    checkpoint.outputs = m_outputs & ~ProfileOutput;
+    checkpoint.usagePeriod = m_usagePeriod;
+    checkpoint.offset = m_endOffset;
+    checkpoint.tailHash = hashLogTail(m_inputFile.data(), m_endOffset);
+    checkpoint.lineCount = m_lineCount;
+    checkpoint.eventYear = m_eventYear;
+    for (size_t file=0; file < m_outputPaths.size(); ++file)
+    {
+        checkpoint.outputSizes.push_back(publishes(m_outputs, file) ? getFileSize(m_outputPaths.at(file)) : 0);
+    }
+    checkpoint.finalDurationSize = m_finalDurationSize;
+    checkpoint.finalPeriodSize = m_finalPeriodSize;
+
+    for (size_t product=0; product < m_uniqueProducts.size(); ++product)
+    {
+        checkpoint.products.push_back(m_uniqueProducts.at(product));
+    }
+    for (size_t user=0; user < m_uniqueUsers.size(); ++user)
+    {
+        checkpoint.users.push_back(m_uniqueUsers.at(user));
+    }
+
+    checkpoint.licenseCounts = m_licenseCountNumbers;
+    checkpoint.uniqueLicenseCounts = m_uniqueLicenseCountsByProduct;
+    checkpoint.maxLicenseCounts = m_maxLicenseCountsByProduct;
+    checkpoint.licenseCountsByUserAndProduct = m_licenseCountByProductAndUser;
+    for (const UsageCounts& usage : m_rowUsage)
+    {
+        checkpoint.rowLicenseCounts.push_back(usage.inUse);
+        checkpoint.rowUniqueLicenseCounts.push_back(usage.uniqueUsers);
+        checkpoint.rowMaxLicenseCounts.push_back(usage.totalLicenses);
+    }
+    for (const std::vector<std::chrono::nanoseconds>& durations : m_closedDuration)
+    {
+        checkpoint.closedDurations.push_back(std::vector<int64_t>());
+        for (std::chrono::nanoseconds duration : durations)
+        {
+            checkpoint.closedDurations.back().push_back(duration.count());
+        }
+    }
+
+    m_periodState.save(checkpoint);
+
+    // Carry the events the outputs still depend on, in the order they were logged
+    std::vector<size_t> rows = m_startEvents;
+    rows.insert(rows.end(), m_shutdownEvents.begin(), m_shutdownEvents.end());
+    rows.insert(rows.end(), m_denialEvents.begin(), m_denialEvents.end());
+    for (size_t checkOut=m_firstOpenCheckOut; checkOut < m_checkOutRows.size(); ++checkOut)
+    {
+        rows.push_back(m_checkOutRows.at(checkOut));
+        if (m_checkInRows.at(checkOut) != -1)
+        {
+            rows.push_back(m_checkInRows.at(checkOut));
+        }
+    }
+    if (m_eventData.size() > 0)
+    {
+        rows.push_back(m_endTimeRow);
+    }
+    std::sort(rows.begin(), rows.end());
+    rows.erase(std::unique(rows.begin(), rows.end()), rows.end());
+
+    for (size_t row : rows)
+    {
+        checkpoint.events.appendEvent(m_eventData, row);
+    }
+
+    // A segmented analysis only carries on within the one run
+    if (m_analysisMode == IncrementalAnalysis)
+    {
+        writeCheckpoint(m_checkpointPath, checkpoint);
+    }
+}
+
+
+void LogData::extractEvents()
+{
+    StageTimer stageTimer(m_profile, ExtractStage);
+    size_t firstEvent = m_eventData.size();
+    readEvents(m_eventData);
+    registerEvents(firstEvent);
+}
+
+
+void LogData::registerEvents(const size_t firstEvent)
+{
+    // Enough for the summary.  Usage and durations are left until they're needed.
+    for (size_t eventRow=firstEvent; eventRow < m_eventData.size(); ++eventRow)
+    {
+        registerEvent(eventRow);
+    }
+    m_durationCurrent = false;
+}
+
+
+void LogData::prepareOutputs(const unsigned int outputs)
+{
+    // The sparse usage over time file is written as the usage is worked out, so that's
+    // left to publishResults()
+    if ((outputs & (UsageOverTimeOutput | UsageByPeriodOutput)) && !streamsUsage(outputs))
+    {
+        getConcurrentUsage();
+    }
+    if (outputs & (UsageDurationOutput | TotalDurationOutput | DurationParquetOutput))
+    {
+        getUsageDuration();
+    }
+}
+
+
+bool LogData::streamsUsage(const unsigned int outputs) const
+{
+    return (outputs & UsageOverTimeOutput) && (outputs & SparseUsageOverTime) &&
+           m_concurrentRows < m_eventData.size();
+}
+
+
+void LogData::getConcurrentUsage(BufferedWriter* usageChangesWriter)
+{
+    // Only the rows read since it last ran, since each row carries on from the one before
+    size_t firstEvent = m_concurrentRows;
+    if (firstEvent == m_eventData.size())
+    {
+        return;
+    }
+
+    // Written out while publishing, the events count towards the publishing stage
+    StageTimer stageTimer(m_profile, ConcurrencyStage);
+    bool ownStage = m_progress && !usageChangesWriter;
+    if (ownStage)
+    {
+        m_progress->startStage(ConcurrencyStage, 0, m_eventData.size() - firstEvent);
+    }
+    m_concurrencyIndices.clear();
+    for (size_t eventRow=firstEvent; eventRow < m_eventData.size(); ++eventRow)
+    {
+        size_t firstUsageRow = m_usageRows.size();
+        updateConcurrentUsage(eventRow);
+        if (usageChangesWriter)
+        {
+            writeUsageRows(*usageChangesWriter, firstUsageRow, m_usageRows.size());
+        }
+        if (m_progress && (eventRow - firstEvent + 1) % ProgressInterval == 0)
+        {
+            m_progress->advance(0, ProgressInterval);
+        }
+    }
+    m_concurrentRows = m_eventData.size();
+    m_profile.addCounts(ConcurrencyStage, 0, m_eventData.size() - firstEvent);
+    if (m_progress)
+    {
+        m_progress->advance(0, (m_eventData.size() - firstEvent) % ProgressInterval);
+    }
+    if (ownStage)
+    {
+        m_progress->finishStage();
+    }
+}
+
+
+void LogData::readEvents(EventTable& table)
+{
+    // The file is cut into newline-aligned chunks which are tokenized, reformatted and
+    // projected into their own event tables in parallel.  The year is the only state
+    // carried from line to line, so each chunk tracks it relative to the year it starts
+    // in, and the chunks' years are resolved in file order between the two parallel
+    // passes.  The chunk tables are then appended to table in order, so the results
+    // don't depend on how the file was split.
+    size_t threadCount = threadsToUse();
+
+    std::string_view data = m_inputFile.data();
+    m_endOffset = data.size();
+    if (m_compression != Uncompressed)
+    {
+        // Compressed logs aren't still being written, so all of what's new is read.  A
+        // log that's grown has had another gzip member or zstd frame added to it.  How
+        // much there is to parse isn't known until it's been decompressed.
+        if (m_progress)
+        {
+            m_progress->startStage(ExtractStage, 0, 0);
+        }
+        readCompressedEvents(data.substr(m_startOffset), threadCount, table);
+        if (m_progress)
+        {
+            m_progress->finishStage();
+        }
+        return;
+    }
+    if (m_analysisMode == IncrementalAnalysis)
+    {
+        // Only read whole lines, since the last one may still be being written
+        size_t lastLineBreak = data.rfind('\n');
+        m_endOffset = (lastLineBreak == std::string_view::npos) ? 0 : lastLineBreak + 1;
+        m_endOffset = std::max(m_endOffset, m_startOffset);
+    }
+    else if (m_analysisMode == SegmentedAnalysis && data.size() - m_startOffset > SegmentSize)
+    {
+        // Up to the end of the last line that starts in the segment
+        size_t lineBreak = data.find('\n', m_startOffset + SegmentSize - 1);
+        m_endOffset = (lineBreak == std::string_view::npos) ? data.size() : lineBreak + 1;
+    }
+    bool endOfLog = (m_analysisMode != IncrementalAnalysis && m_endOffset == data.size());
+    data = data.substr(m_startOffset, m_endOffset - m_startOffset);
+    if (m_progress)
+    {
+        m_progress->startStage(ExtractStage, data.size(), 0);
+    }
+
+    size_t chunkSize = (data.size() + threadCount - 1) / threadCount;
+    if (m_threadCount == 0)
+    {
+        // Threads aren't worth starting for small files unless they were asked for
+        chunkSize = std::max(chunkSize, MinChunkSize);
+    }
+    chunkSize = std::max<size_t>(1, std::min(chunkSize, MaxChunkSize));
+
+    std::vector<std::string_view> chunkData;
+    splitIntoChunks(data, chunkSize, chunkData);
+
+    size_t firstRow = m_lineCount;
+    readChunks(chunkData, endOfLog, threadCount, firstRow, table);
+    m_lineCount = firstRow;
+    if (m_analysisMode == SegmentedAnalysis)
+    {
+        // The events are copied out of the segment, so the mapped pages aren't needed
+        m_inputFile.release(m_endOffset);
+    }
+    if (m_progress)
+    {
+        m_progress->finishStage();
+    }
+}
+
+
+size_t LogData::threadsToUse() const
+{
+    if (m_threadCount == 0)
+    {
+        return std::max<size_t>(1, std::thread::hardware_concurrency());
+    }
+    return m_threadCount;
+}
+
+
+void LogData::readCompressedEvents(std::string_view compressed, size_t threadCount, EventTable& table)
+{
+    // The log is decompressed on a thread of its own while what's been decompressed so
+    // far is parsed, a batch of a chunk per thread at a time.  Each batch ends at a line
+    // break, and the rest of the last line is carried over to the next batch.
+    size_t firstRow = m_lineCount;
+    if (compressed.empty())
+    {
+        return;
+    }
+
+    const size_t batchSize = threadCount * StreamChunkSize;
+    DecompressingReader reader(compressed, m_compression, 2 * batchSize);
+    std::string batch;
+    std::string block;
+    std::vector<std::string_view> chunkData;
+    bool more = true;
+    while (more)
+    {
+        more = reader.read(block);
+        if (more)
+        {
+            batch.append(block);
+            if (batch.size() < batchSize)
+            {
+                continue;
+            }
+        }
+
+        size_t end = more ? batch.rfind('\n') + 1 : batch.size();
+        if (more && end == 0)
+        {
+            continue;
+        }
+        splitIntoChunks(std::string_view(batch).substr(0, end), StreamChunkSize, chunkData);
+        readChunks(chunkData, !more, threadCount, firstRow, table);
+        batch.erase(0, end);
+    }
+    m_lineCount = firstRow;
+}
+
+
+void LogData::readChunks(const std::vector<std::string_view>& chunkData,
+                         bool endOfLog,
+                         size_t threadCount,
+                         size_t& firstRow,
+                         EventTable& table)
+{
+    // Chunks are handled a batch at a time, so only one batch of parsed lines is in memory
+    std::vector<LogChunk> chunks(std::min(threadCount, chunkData.size()));
+
+    for (size_t batchStart=0; batchStart < chunkData.size(); batchStart += chunks.size())
+    {
+        size_t batchSize = std::min(chunks.size(), chunkData.size() - batchStart);
+        for (size_t chunk=0; chunk < batchSize; ++chunk)
+        {
+            chunks.at(chunk).data = chunkData.at(batchStart + chunk);
+            chunks.at(chunk).last = (endOfLog && batchStart + chunk == chunkData.size() - 1);
+        }
+
+        runInParallel(batchSize, threadCount, [this, &chunks](size_t chunk)
+        {
+            // Line numbers aren't known yet, they're sorted out below if this fails
+            try
+            {
+                parseChunk(chunks.at(chunk), 0);
+            }
+            catch (...)
+            {
+                chunks.at(chunk).error = std::current_exception();
+            }
+        });
+
+        for (size_t chunk=0; chunk < batchSize; ++chunk)
+        {
+            if (chunks.at(chunk).error)
+            {
+                // Parse the first chunk that failed again now that its first line number is
+                // known, so the error reports the same line as reading the file in one go
+                parseChunk(chunks.at(chunk), firstRow);
+                std::rethrow_exception(chunks.at(chunk).error);
+            }
+            firstRow += chunks.at(chunk).lineCount;
+            m_profile.addTime(TokenizeStage, chunks.at(chunk).tokenizeTime);
+            m_profile.addCounts(TokenizeStage, chunks.at(chunk).lineCount, 0, chunks.at(chunk).data.size());
+            if (m_fileFormat == ISVLog)
+            {
+                m_profile.addTime(NormalizeStage, chunks.at(chunk).normalizeTime);
+                m_profile.addCounts(NormalizeStage, chunks.at(chunk).lineCount, 0);
+            }
+
+            chunks.at(chunk).startYear = m_eventYear;
+            m_eventYear = resolveYear(chunks.at(chunk).endYear, m_eventYear);
+        }
+
+        runInParallel(batchSize, threadCount, [this, &chunks](size_t chunk)
+        {
+            loadChunk(chunks.at(chunk));
+        });
+
+        for (size_t chunk=0; chunk < batchSize; ++chunk)
+        {
+            table.append(chunks.at(chunk).table);
+            m_profile.addCounts(ExtractStage, chunks.at(chunk).lineCount, chunks.at(chunk).table.size(),
+                                chunks.at(chunk).data.size());
+        }
+    }
+}
+
+
+void LogData::extractCachedEvents()
+{
+    // The log still has to be read once to check it's the one that was cached, but
+    // that's a small part of the cost of parsing it
+    std::string cachePath = m_outputDirectory + "/" + m_inputFileName + "_Events.cache";
+    LogIdentity log;
+    CachedLog cachedLog;
+    EventTable events;
+    bool cached;
+    {
+        StageTimer stageTimer(m_profile, ExtractStage);
+        log = identifyLog(m_inputFilePath, m_inputFile.data());
+        cached = readEventCache(cachePath, log, cachedLog, events) && cachedLog.fileFormat == m_fileFormat;
+        if (cached)
+        {
+            m_fromCache = true;
+            m_eventData = std::move(events);
+            m_eventYear = cachedLog.eventYear;
+            m_lineCount = cachedLog.lineCount;
+            m_endOffset = m_inputFile.size();
+            m_profile.addCounts(ExtractStage, 0, m_eventData.size(), getFileSize(cachePath));
+            registerEvents(0);
+        }
+    }
+    if (cached)
+    {
+        return;
+    }
+
+    extractEvents();
+    cachedLog.fileFormat = m_fileFormat;
+    cachedLog.eventYear = m_eventYear;
+    cachedLog.lineCount = m_lineCount;
+    writeEventCache(cachePath, log, cachedLog, m_eventData);
+}
+
+
+void LogData::extractPooledEvents(const std::vector<std::string>& inputFilePaths)
+{
+    // Each log is read into a table of its own, as it would be on its own
+    std::vector<EventTable> serverTables(inputFilePaths.size());
+    for (size_t server=0; server < inputFilePaths.size(); ++server)
+    {
+        openInputFile(inputFilePaths.at(server));
+        findFileFormat();
+        if (m_fileFormat != ReportLog)
+        {
+            PoolFormatException poolFormatException(inputFilePaths.at(server));
+            throw poolFormatException;
+        }
+        m_eventYear.clear();
+        m_lineCount = 0;
+        StageTimer stageTimer(m_profile, ExtractStage);
+        readEvents(serverTables.at(server));
+    }
+    m_inputFile.close();
+    m_serverUsage.resize(inputFilePaths.size());
+
+    // Then the tables are merged in time order, taking the earliest next event of any log
+    // off a heap.  Ties go to the log listed first.  PRODUCT events have no time, so they
+    // count as the time of the event before them, as do any events logged out of order.
+    struct NextEvent
+    {
+        int64_t time;
+        size_t server;
+        size_t row;
+    };
+    auto later = [](const NextEvent& first, const NextEvent& second)
+    {
+        return first.time != second.time ? first.time > second.time : first.server > second.server;
+    };
+    std::priority_queue<NextEvent, std::vector<NextEvent>, decltype(later)> nextEvents(later);
+    auto pushEvent = [&serverTables, &nextEvents](size_t server, size_t row, int64_t lastTime)
+    {
+        if (row < serverTables.at(server).size())
+        {
+            nextEvents.push({std::max(lastTime, serverTables.at(server).timestamp.at(row)), server, row});
+        }
+    };
+    for (size_t server=0; server < serverTables.size(); ++server)
+    {
+        pushEvent(server, 0, INT64_MIN);
+    }
+
+    StageTimer stageTimer(m_profile, ExtractStage);
+    if (m_progress)
+    {
+        size_t eventCount = 0;
+        for (const EventTable& serverTable : serverTables)
+        {
+            eventCount += serverTable.size();
+        }
+        m_progress->startStage(ExtractStage, 0, eventCount);
+    }
+    std::vector<std::string> serverNames;
+    while (!nextEvents.empty())
+    {
+        NextEvent next = nextEvents.top();
+        nextEvents.pop();
+
+        size_t eventRow = m_eventData.size();
+        m_eventData.appendEvent(serverTables.at(next.server), next.row);
+        m_eventServers.push_back(next.server);
+        registerEvent(eventRow);
+        if (m_eventData.type.at(eventRow) == StartEvent &&
+            std::find(serverNames.begin(), serverNames.end(), m_serverName) == serverNames.end())
+        {
+            serverNames.push_back(m_serverName);
+        }
+
+        pushEvent(next.server, next.row + 1, next.time);
+        if (m_progress && m_eventData.size() % ProgressInterval == 0)
+        {
+            m_progress->advance(0, ProgressInterval);
+        }
+    }
+    if (m_progress)
+    {
+        m_progress->advance(0, m_eventData.size() % ProgressInterval);
+        m_progress->finishStage();
+    }
+
+    m_serverName.clear();
+    for (const std::string& serverName : serverNames)
+    {
+        m_serverName.append(m_serverName.empty() ? "" : ", ");
+        m_serverName.append(serverName);
+    }
+}
+
+
+void LogData::parseChunk(LogChunk& chunk, const size_t firstRow)
+{
+    chunk.lineCount = 0;
+    chunk.events.clear();
+    chunk.endYear = ChunkYear();
+    chunk.error = nullptr;
+    chunk.tokenizeTime = std::chrono::nanoseconds(0);
+    chunk.normalizeTime = std::chrono::nanoseconds(0);
+
+    std::vector<std::string_view> allDataRow;
+    size_t position = 0;
+    std::string_view line;
+    const bool profiling = m_profile.enabled();
+    std::chrono::steady_clock::time_point lineStart;
+    std::chrono::steady_clock::time_point tokenized;
+    size_t reportedPosition = 0;
+
+    // Every chunk but the last ends with a line break, which doesn't start another line
+    while ((chunk.last || position < chunk.data.size()) && getNextLine(chunk.data, position, line))
+    {
+        size_t row = firstRow + chunk.lineCount;
+        ++chunk.lineCount;
+        if (m_progress && chunk.lineCount % ProgressInterval == 0)
+        {
+            size_t parsed = std::min(position, chunk.data.size());
+            m_progress->advance(parsed - reportedPosition, 0);
+            reportedPosition = parsed;
+        }
+
+        if (profiling)
+        {
+            lineStart = std::chrono::steady_clock::now();
+        }
+        tokenizeLine(line, ' ', allDataRow);
+        if (profiling)
+        {
+            tokenized = std::chrono::steady_clock::now();
+            chunk.tokenizeTime += tokenized - lineStart;
+        }
+
+        if (m_fileFormat == ISVLog)
+        {
+            standardizeLogFormatting(row, allDataRow);
+            if (profiling)
+            {
+                chunk.normalizeTime += std::chrono::steady_clock::now() - tokenized;
+            }
+        }
+
+        parseEvent(row, allDataRow, chunk);
+    }
+    if (m_progress)
+    {
+        m_progress->advance(std::min(position, chunk.data.size()) - reportedPosition, 0);
+    }
+}
+
+
+void LogData::parseEvent(const size_t row,
+                         const std::vector<std::string_view>& allDataRow,
+                         LogChunk& chunk)
+{
+    // Check for existence of date, and if so update the year
+    if (allDataRow.size() == 2)
+    {
+        std::vector<std::string_view> tempVector;
+        tokenizeLine(allDataRow.at(0), '/', tempVector);
+        if (tempVector.size() == 3)
+        {
+            chunk.endYear = ChunkYear{true, tempVector.at(2), 0};
+        }
+    }
+
+    if (allDataRow.size() <= m_eventIndex)
+    {
+        return;
+    }
+
+    eventType type;
+    const std::vector<size_t>* indices;
+    std::string_view eventName = allDataRow.at(m_eventIndex);
+    if (eventName == "OUT")
+    {
+        type = OutEvent;
+        indices = &m_OUTindices;
+    }
+    else if (eventName == "IN")
+    {
+        type = InEvent;
+        indices = &m_INindices;
+    }
+    else if (eventName == "DENY")
+    {
+        type = DenyEvent;
+        indices = &m_DENYindices;
+    }
+    else if (eventName == "START")
+    {
+        type = StartEvent;
+        indices = &m_STARTindices;
+    }
+    else if (eventName == "SHUTDOWN")
+    {
+        type = ShutdownEvent;
+        indices = &m_SHUTindices;
+    }
+    else if (eventName == "PRODUCT")
+    {
+        type = ProductEvent;
+        indices = &m_PRODUCTindices;
+    }
+    else
+    {
+        return;
+    }
+
+    if (allDataRow.size() < indices->size())
+    {
+        EventDataException eventDataException(row+1);
+        throw eventDataException;
+    }
+
+    ParsedEvent event;
+    event.type = type;
+    event.fieldCount = indices->size();
+    for (size_t col=0; col < indices->size(); ++col)
+    {
+        event.fields.at(col) = allDataRow.at(indices->at(col));
+    }
+
+    if (m_fileFormat == ReportLog && type == StartEvent)
+    {
+        std::vector<std::string_view> tempVector;
+        tokenizeLine(event.fields.at(IndexDate), '/', tempVector);
+        chunk.endYear = ChunkYear{true, tempVector.at(2), 0};
+    }
+    else if (m_fileFormat == ReportLog && type != ProductEvent)
+    {
+        // If a log event occurs within the first minute after midnight, it is logged before
+        // the string that provides the new year.  This code checks for events on Jan 1 at 00:00
+        // and increments the year.
+        if (event.fields.at(IndexDate) == "01/01")
+        {
+            std::vector<std::string_view> timeVector;
+            tokenizeLine(event.fields.at(IndexTime), ':', timeVector);
+            if (timeVector.at(0) == "00" && timeVector.at(1) == "00")
+            {
+                ++chunk.endYear.increments;
+            }
+        }
+        event.year = chunk.endYear;
+    }
+
+    chunk.events.push_back(event);
+}
+
+
+void LogData::loadChunk(LogChunk& chunk)
+{
+    chunk.table = EventTable();
+    chunk.table.reserve(chunk.events.size());
+    TimestampParser timestampParser;
+
+    // Consecutive events nearly always share a year, so only resolve it when it changes
+    ChunkYear lastYear{false, std::string_view(), -1};
+    std::string year;
+
+    for (const ParsedEvent& event : chunk.events)
+    {
+        if (event.year.known != lastYear.known || event.year.year != lastYear.year ||
+            event.year.increments != lastYear.increments)
+        {
+            lastYear = event.year;
+            year = resolveYear(event.year, chunk.startYear);
+        }
+        loadEventIntoTable(event, year, chunk.table, timestampParser);
+        if (m_progress && chunk.table.size() % ProgressInterval == 0)
+        {
+            m_progress->advance(0, ProgressInterval);
+        }
+    }
+    if (m_progress)
+    {
+        m_progress->advance(0, chunk.table.size() % ProgressInterval);
+    }
+}
+
+
+void LogData::registerEvent(const size_t eventRow)
+{
+    switch (m_eventData.type.at(eventRow))
+    {
+        case OutEvent:
+        case InEvent:
+            addIndex(m_eventData.product.at(eventRow), m_uniqueProducts, m_productIndices);
+            addIndex(m_eventData.user.at(eventRow), m_uniqueUsers, m_userIndices);
+            m_endTimeRow = eventRow;
+            break;
+        case DenyEvent:
+            m_denialEvents.push_back(eventRow);
+            m_endTimeRow = eventRow;
+            break;
+        case StartEvent:
+            m_serverName = m_eventData.text(m_eventData.product.at(eventRow));
+            m_startEvents.push_back(eventRow);
+            if (m_fileFormat == ReportLog)
+            {
+                m_endTimeRow = eventRow;
+            }
+            break;
+        case ShutdownEvent:
+            m_shutdownEvents.push_back(eventRow);
+            m_endTimeRow = eventRow;
+            break;
+        case ProductEvent:
+            addIndex(m_eventData.product.at(eventRow), m_uniqueProducts, m_productIndices);
+            break;
+    }
+}
+
+
+uint32_t LogData::addIndex(const uint32_t textId, StringTable& list, std::vector<uint32_t>& indices)
+{
+    // Each text is only looked up by name the first time an event uses it
+    if (indices.size() <= textId)
+    {
+        indices.resize(m_eventData.textCount(), StringTable::NotFound);
+    }
+    if (indices.at(textId) == StringTable::NotFound)
+    {
+        indices.at(textId) = list.add(m_eventData.text(textId));
+    }
+    return indices.at(textId);
+}
+
+
+size_t LogData::productIndex(const size_t row) const
+{
+    return m_productIndices.at(m_eventData.product.at(row));
+}
+
+
+size_t LogData::userIndex(const size_t row) const
+{
+    return m_userIndices.at(m_eventData.user.at(row));
+}
+
+
+std::string LogData::resolveYear(const ChunkYear& year, const std::string& startYear)
+{
+    std::string resolvedYear = year.known ? std::string(year.year) : startYear;
+    if (year.increments > 0)
+    {
+        int yearNumber = atoi(resolvedYear.c_str()) + year.increments;
+        resolvedYear = toString(yearNumber);
+    }
+    return resolvedYear;
+}
+
+
+void LogData::getEventIndices()
+{
+    if (m_fileFormat == ReportLog)
+    {
+        m_eventIndex = 0;
+
+        m_OUTindices.push_back(m_eventIndex);
+        m_OUTindices.push_back(RepOUTIndexDate);
+        m_OUTindices.push_back(RepOUTIndexTime);
+        m_OUTindices.push_back(RepOUTIndexProduct);
+        m_OUTindices.push_back(RepOUTIndexVersion);
+        m_OUTindices.push_back(RepOUTIndexUser);
+        m_OUTindices.push_back(RepOUTIndexHost);
+        m_OUTindices.push_back(RepOUTIndexCount);
+        m_OUTindices.push_back(RepOUTIndexHandle);
+
+        m_INindices.push_back(m_eventIndex);
+        m_INindices.push_back(RepINIndexDate);
+        m_INindices.push_back(RepINIndexTime);
+        m_INindices.push_back(RepINIndexProduct);
+        m_INindices.push_back(RepINIndexVersion);
+        m_INindices.push_back(RepINIndexUser);
+        m_INindices.push_back(RepINIndexHost);
+        m_INindices.push_back(RepINIndexCount);
+        m_INindices.push_back(RepINIndexHandle);
+
+        m_DENYindices.push_back(m_eventIndex);
+        m_DENYindices.push_back(RepDENYIndexDate);
+        m_DENYindices.push_back(RepDENYIndexTime);
+        m_DENYindices.push_back(RepDENYIndexProduct);
+        m_DENYindices.push_back(RepDENYIndexVersion);
+        m_DENYindices.push_back(RepDENYIndexUser);
+        m_DENYindices.push_back(RepDENYIndexHost);
+        m_DENYindices.push_back(RepDENYIndexCount);
+
+        m_STARTindices.push_back(m_eventIndex);
+        m_STARTindices.push_back(RepSTARTIndexDate);
+        m_STARTindices.push_back(RepSTARTIndexTime);
+        m_STARTindices.push_back(RepSTARTIndexServer);
+
+        m_SHUTindices.push_back(m_eventIndex);
+        m_SHUTindices.push_back(RepSHUTIndexDate);
+        m_SHUTindices.push_back(RepSHUTIndexTime);
+
+        m_PRODUCTindices.push_back(m_eventIndex);
+        m_PRODUCTindices.push_back(RepPRODUCTIndexProduct);
+        m_PRODUCTindices.push_back(RepPRODUCTIndexVersion);
+        m_PRODUCTindices.push_back(RepPRODUCTIndexCount);
+    }
+
+    else if (m_fileFormat == ISVLog)
+    {
+        // Count and Handle data is not available in isv log files
+        m_eventIndex = 3;
+
+        m_OUTindices.push_back(m_eventIndex);
+        m_OUTindices.push_back(isvOUTIndexDate);
+        m_OUTindices.push_back(isvOUTIndexTime);
+        m_OUTindices.push_back(isvOUTIndexProduct);
+        m_OUTindices.push_back(isvOUTIndexVersion);
+        m_OUTindices.push_back(isvOUTIndexUser);
+        m_OUTindices.push_back(isvOUTIndexHost);
+        m_OUTindices.push_back(isvOUTTokenCount);
+
+        m_INindices.push_back(m_eventIndex);
+        m_INindices.push_back(isvINIndexDate);
+        m_INindices.push_back(isvINIndexTime);
+        m_INindices.push_back(isvINIndexProduct);
+        m_INindices.push_back(isvINIndexVersion);
+        m_INindices.push_back(isvINIndexUser);
+        m_INindices.push_back(isvINIndexHost);
+        m_INindices.push_back(isvINTokenCount);
+
+        m_DENYindices.push_back(m_eventIndex);
+        m_DENYindices.push_back(isvDENYIndexDate);
+        m_DENYindices.push_back(isvDENYIndexTime);
+        m_DENYindices.push_back(isvDENYIndexProduct);
+        m_DENYindices.push_back(isvDENYIndexVersion);
+        m_DENYindices.push_back(isvDENYIndexUser);
+        m_DENYindices.push_back(isvDENYIndexHost);
+
+        m_STARTindices.push_back(m_eventIndex);
+        m_STARTindices.push_back(isvSTARTIndexDate);
+        m_STARTindices.push_back(isvSTARTIndexTime);
+        m_STARTindices.push_back(isvSTARTIndexServer);
+
+        m_SHUTindices.push_back(m_eventIndex);
+        m_SHUTindices.push_back(isvSHUTIndexDate);
+        m_SHUTindices.push_back(isvSHUTIndexTime);
+    }
+}
+
+
+void LogData::standardizeLogFormatting(const size_t row,
+                                       std::vector<std::string_view>& allDataRow)
+{
+    if (allDataRow.size() > m_eventIndex)
+    {
+        if (allDataRow.at(m_eventIndex) == "OUT:")
+        {   
+            reformatEventName(allDataRow, "OUT");
+            reformatProductVersion(row, isvOUTIndexVersion, allDataRow);
+            reformatUserHost(allDataRow, m_OUTindices);
+            reformatToken(allDataRow);
+        }
+        else if (allDataRow.at(m_eventIndex) == "IN:")
+        {
+            removeInDetails(allDataRow);
+            checkForUnhandledINDetails(row, allDataRow); // call after the "remove" function
+
+            reformatEventName(allDataRow, "IN");
+            reformatProductVersion(row, isvINIndexVersion, allDataRow);
+            reformatUserHost(allDataRow, m_INindices);
+            reformatToken(allDataRow);
+        }
+        else if (allDataRow.at(m_eventIndex) == "DENIED:")
+        {
+            removeNoGood(allDataRow);
+            reformatEventName(allDataRow, "DENY");
+            reformatProductVersion(row, isvDENYIndexVersion, allDataRow);
+            reformatUserHost(allDataRow, m_DENYindices);
+        }
+        else if (allDataRow.at(m_eventIndex) == "Server")
+        {
+            reformatEventName(allDataRow, "START");
+        }
+        else if (allDataRow.at(m_eventIndex) == "Shutdown")
+        {
+            reformatEventName(allDataRow, "SHUTDOWN");
         }
     }
 }
@@ -383,596 +1404,1410 @@ void LogData::standardizeLogFormatting()
 //   IN: (failed server back up)
 // We will look for the opening paren, ( and remove the range of elements starting there until reaching the 
 // closing paren, ).
-void LogData::removeInDetails(const size_t row,
-                              std::vector<std::string>& allDataRow)
+void LogData::removeInDetails(std::vector<std::string_view>& allDataRow)
+{
+    size_t found = 0;
+    if (allDataRow.at(isvINIndexProduct).at(0) == '(')
+    {
+        for (size_t col=isvINIndexProduct; col<allDataRow.size(); ++col)
+        {
+            found = allDataRow.at(col).find(")");
+            if (found != std::string::npos)
+            {
+                allDataRow.erase(allDataRow.begin()+isvINIndexProduct, allDataRow.begin()+col+1);
+                break;
+            }
+        }
+    }
+}
+
+
+void LogData::removeNoGood(std::vector<std::string_view>& allDataRow)
+{
+    if (allDataRow.at(isvDENYIndexProduct) == "no" &&
+       (allDataRow.at(isvDENYIndexVersion) == "good"))
+    {
+        allDataRow.erase(allDataRow.begin()+isvDENYIndexProduct);
+        allDataRow.erase(allDataRow.begin()+isvDENYIndexProduct);
+    }
+}
+
+
+void LogData::reformatEventName(std::vector<std::string_view>& allDataRow,
+                                std::string_view newLabel)
+{
+    allDataRow.at(m_eventIndex) = newLabel;
+}
+
+
+void LogData::reformatUserHost(std::vector<std::string_view>& allDataRow,
+                               const std::vector<size_t>& indices)
+{
+    std::vector<std::string_view> tempVector;
+    size_t userIndex = indices.at(IndexUser);
+    size_t hostIndex = indices.at(IndexHost);
+
+    tokenizeLine(allDataRow.at(userIndex), '@', tempVector);
+    allDataRow.erase(allDataRow.begin()+userIndex);
+    allDataRow.insert(allDataRow.begin()+userIndex, tempVector.at(0));
+    allDataRow.insert(allDataRow.begin()+hostIndex, tempVector.at(1));
+}
+
+
+void LogData::reformatProductVersion(const size_t row,
+                                     const size_t col,
+                                     std::vector<std::string_view>& allDataRow)
+{
+    checkForValidProductVersion(row, col, allDataRow);
+    allDataRow.at(col).remove_prefix(1);
+}
+
+
+void LogData::reformatToken(std::vector<std::string_view>& allDataRow)
+{
+    // Try to find the token license count, which is in the string "(# licenses)",
+    // which has already been split up into two elements, "(#" and "licenses)"
+    bool tokenFound = false;
+    for (size_t col=isvINIndexHost; col<allDataRow.size(); ++col)
+    {
+        size_t found = allDataRow.at(col).find("licenses)");
+        if (found != std::string::npos)
+        {
+            tokenFound = true;
+
+            // Element before "licenses" is the actual token count
+            std::string_view tempString = allDataRow.at(col-1);
+
+            // Strip the leading paren, (
+            tempString = tempString.substr(tempString.empty() ? 0 : 1);
+
+            allDataRow.insert(allDataRow.begin()+isvINTokenCount, tempString);
+
+            break;
+        }
+    }
+
+    // If the token license count wasn't found, we assume the count is 1
+    if (! tokenFound)
+        allDataRow.insert(allDataRow.begin()+isvINTokenCount, "1");
+}
+
+
+
+void LogData::loadEventIntoTable(const ParsedEvent& event,
+                                 const std::string& year,
+                                 EventTable& table,
+                                 TimestampParser& timestampParser)
+{
+    size_t eventRow = table.addEvent(event.type);
+
+    // PRODUCT lines carry no date or time, so their fields are laid out differently
+    if (event.type == ProductEvent)
+    {
+        table.product.at(eventRow) = table.addText(event.fields.at(1));
+        table.version.at(eventRow) = table.addText(event.fields.at(2));
+        table.count.at(eventRow) = atoi(std::string(event.fields.at(3)).c_str());
+        return;
+    }
+
+    std::string date(event.fields.at(IndexDate));
+    std::string_view time = event.fields.at(IndexTime);
+    if (m_fileFormat == ReportLog && event.type != StartEvent)
+    {
+        date.append("/" + year);
+    }
+    table.date.at(eventRow) = table.addText(date);
+    table.time.at(eventRow) = table.addText(time);
+
+    if (m_fileFormat == ReportLog)
+    {
+        table.timestamp.at(eventRow) = timestampParser.parse(date, time).time_since_epoch().count();
+    }
+
+    for (size_t col=IndexProduct; col<event.fieldCount; ++col)
+    {
+        std::string_view field = event.fields.at(col);
+        switch (col)
+        {
+            case IndexProduct:
+                table.product.at(eventRow) = table.addText(field);
+                break;
+            case IndexVersion:
+                table.version.at(eventRow) = table.addText(field);
+                break;
+            case IndexUser:
+                table.user.at(eventRow) = table.addText(field);
+                break;
+            case IndexHost:
+                table.host.at(eventRow) = table.addText(field);
+                break;
+            case IndexCount:
+                table.count.at(eventRow) = atoi(std::string(field).c_str());
+                break;
+            case IndexHandle:
+                table.handle.at(eventRow) = table.addText(field);
+                break;
+        }
+    }
+}
+
+
+size_t LogData::eventFieldCount(const size_t row)
+{
+    // Fields are laid out the way they appear in eventIndices, stopping where the log
+    // format runs out of data for this kind of event.  Products just have their name,
+    // version and license count after the event name.
+    switch (m_eventData.type.at(row))
+    {
+        case OutEvent:
+            return m_OUTindices.size();
+        case InEvent:
+            return m_INindices.size();
+        case DenyEvent:
+            return m_DENYindices.size();
+        case StartEvent:
+            return m_STARTindices.size();
+        case ShutdownEvent:
+            return m_SHUTindices.size();
+        case ProductEvent:
+            return 4;
+    }
+    return 0;
+}
+
+
+void LogData::writeEventField(BufferedWriter& writer, const size_t row, const size_t field)
+{
+    eventType type = m_eventData.type.at(row);
+    if (field == IndexEvent)
+    {
+        writer.write(eventTypeName(type));
+        return;
+    }
+
+    if (type == ProductEvent)
+    {
+        switch (field)
+        {
+            case 1:
+                writer.write(m_eventData.text(m_eventData.product.at(row)));
+                break;
+            case 2:
+                writer.write(m_eventData.text(m_eventData.version.at(row)));
+                break;
+            case 3:
+                writer.writeNumber(m_eventData.count.at(row));
+                break;
+        }
+        return;
+    }
+
+    switch (field)
+    {
+        case IndexDate:
+            writer.write(m_eventData.text(m_eventData.date.at(row)));
+            break;
+        case IndexTime:
+            writer.write(m_eventData.text(m_eventData.time.at(row)));
+            break;
+        case IndexProduct:
+            writer.write(m_eventData.text(m_eventData.product.at(row)));
+            break;
+        case IndexVersion:
+            writer.write(m_eventData.text(m_eventData.version.at(row)));
+            break;
+        case IndexUser:
+            writer.write(m_eventData.text(m_eventData.user.at(row)));
+            break;
+        case IndexHost:
+            writer.write(m_eventData.text(m_eventData.host.at(row)));
+            break;
+        case IndexCount:
+            writer.writeNumber(m_eventData.count.at(row));
+            break;
+        case IndexHandle:
+            writer.write(m_eventData.text(m_eventData.handle.at(row)));
+            break;
+    }
+}
+
+
+void LogData::writeEventDateTime(BufferedWriter& writer, const size_t row)
 {
-    size_t found = 0;
-    if (allDataRow.at(isvINIndexProduct).at(0) == '(')
+    writer.write(m_eventData.text(m_eventData.date.at(row)));
+    writer.write(' ');
+    writer.write(m_eventData.text(m_eventData.time.at(row)));
+}
+
+
+void LogData::checkForValidProductVersion(const size_t row,
+                                 const size_t col,
+                                 std::vector<std::string_view>& allDataRow)
+{
+    std::string_view productVersion = allDataRow.at(col);
+
+    // Check for the "v" at the beginning of the product version
+    size_t found = productVersion.find("v");
+
+    if (found != 0)
     {
-        for (size_t col=isvINIndexProduct; col<allDataRow.size(); ++col)
+        InvalidProductVersionException invalidProductVersionException(row+1);
+        throw invalidProductVersionException;
+    }
+}
+
+
+void LogData::checkForUnhandledINDetails(const size_t row,
+                                         const std::vector<std::string_view>& allDataRow)
+{
+    size_t found = allDataRow.at(isvINIndexProduct).find("(");
+    if (found != std::string::npos)
+    {
+        INEventDetailException inEventDetailException(row+1);
+        throw inEventDetailException;
+    }
+}
+
+
+void LogData::resizeConcurrentUsage()
+{
+    // Products and users are discovered while streaming, so the accumulators grow with them
+    size_t numberOfProducts = m_uniqueProducts.size();
+    size_t numberOfUsers = m_uniqueUsers.size();
+
+    if (m_licenseCountNumbers.size() < numberOfProducts)
+    {
+        m_uniqueLicenseCountsByProduct.resize(numberOfProducts, 0);
+        m_maxLicenseCountsByProduct.resize(numberOfProducts, 0);
+        m_licenseCountNumbers.resize(numberOfProducts, 0);
+        m_rowUsage.resize(numberOfProducts, {0, 0, 0});
+        for (size_t row=0; row < m_licenseCountByProductAndUser.size(); ++row)
         {
-            found = allDataRow.at(col).find(")");
-            if (found != std::string::npos)
+            m_licenseCountByProductAndUser.at(row).resize(numberOfProducts, 0);
+        }
+    }
+
+    if (m_licenseCountByProductAndUser.size() < numberOfUsers)
+    {
+        m_licenseCountByProductAndUser.resize(numberOfUsers, std::vector<size_t>(numberOfProducts, 0));
+    }
+}
+
+
+void LogData::updateConcurrentUsage(const size_t row)
+{
+    size_t productCountIndex;
+    size_t userCountIndex;
+
+    resizeConcurrentUsage();
+
+    if (m_eventData.type.at(row) == OutEvent)
+    {
+        productCountIndex = productIndex(row);
+        userCountIndex = userIndex(row);
+
+        // Total usage
+        if (m_fileFormat == ReportLog)
+        {
+            m_licenseCountNumbers.at(productCountIndex) = reportedLicenseCount(row, productCountIndex);
+        }
+        else
+        {
+            m_licenseCountNumbers.at(productCountIndex) = m_licenseCountNumbers.at(productCountIndex) + getCountOffset(row);
+        }
+
+        // Unique usage
+        ++m_licenseCountByProductAndUser.at(userCountIndex).at(productCountIndex);
+        if (!m_serverUsage.empty())
+        {
+            ++m_serverUsage.at(m_eventServers.at(row)).licenseCountsByUserAndProduct[{userCountIndex, productCountIndex}];
+        }
+        if (m_licenseCountByProductAndUser.at(userCountIndex).at(productCountIndex) == 1)
+        {
+            ++m_uniqueLicenseCountsByProduct.at(productCountIndex);
+        }
+
+        m_changedProducts.push_back(productCountIndex);
+        gatherConcurrentUsageData(row);
+    }
+    else if (m_eventData.type.at(row) == InEvent)
+    {
+        productCountIndex = productIndex(row);
+        userCountIndex = userIndex(row);
+
+        // Total usage
+        if (m_fileFormat == ReportLog)
+        {
+            m_licenseCountNumbers.at(productCountIndex) = reportedLicenseCount(row, productCountIndex);
+        }
+        else
+        {
+            m_licenseCountNumbers.at(productCountIndex) = m_licenseCountNumbers.at(productCountIndex) - getCountOffset(row);
+        }
+
+        m_changedProducts.push_back(productCountIndex);
+
+        // Unique usage
+
+        // Make sure we can't iterate below zero
+        // (could happen if the log file started with licenses already checked out and the first event is a check-in)
+        if (m_licenseCountByProductAndUser.at(userCountIndex).at(productCountIndex) > 0 &&
+            checkInFromServer(row, userCountIndex, productCountIndex))
+        {
+            --m_licenseCountByProductAndUser.at(userCountIndex).at(productCountIndex);
+        }
+
+        if (m_licenseCountByProductAndUser.at(userCountIndex).at(productCountIndex) == 0 && m_uniqueLicenseCountsByProduct.at(productCountIndex) > 0)
+        {
+            --m_uniqueLicenseCountsByProduct.at(productCountIndex);
+        }
+
+        // Compared as signed so an ISV log that checks in more than it checked out
+        // (wrapping the count below zero) isn't treated as having seats in use
+        if (static_cast<int>(m_licenseCountNumbers.at(productCountIndex)) > 0 && m_uniqueLicenseCountsByProduct.at(productCountIndex) == 0)
+        {
+            // This deals with the special case where a report log started after licenses were checked out.
+            // The log has no data on who checked out the licenses, it just gives a count of what's checked out.
+            // We post "1".  The actual value would be greater than or equal to that value.
+            m_uniqueLicenseCountsByProduct.at(productCountIndex) = 1;
+            gatherConcurrentUsageData(row);
+
+            // Set the unique value back down to zero.  Otherwise, a subsequent OUT event will cause the unique users to go up
+            // to "2", even though we're not sure if the check-out is unique or not.
+            m_uniqueLicenseCountsByProduct.at(productCountIndex) = 0;
+            m_changedProducts.push_back(productCountIndex);
+        }
+        else
+        {
+            gatherConcurrentUsageData(row);
+        }
+    }
+    else if (m_eventData.type.at(row) == ShutdownEvent)
+    {
+        if (m_serverUsage.empty())
+        {
+            setVectorToZero(m_licenseCountNumbers);
+            setVectorToZero(m_uniqueLicenseCountsByProduct);
+            setMatrixToZero(m_licenseCountByProductAndUser);
+        }
+        else
+        {
+            shutDownServer(m_eventServers.at(row));
+        }
+        for (size_t product=0; product < m_licenseCountNumbers.size(); ++product)
+        {
+            m_changedProducts.push_back(product);
+        }
+        gatherConcurrentUsageData(row);
+    }
+    else if (m_eventData.type.at(row) == ProductEvent)
+    {
+        productCountIndex = productIndex(row);
+        if (m_fileFormat == ReportLog)
+        {
+            m_maxLicenseCountsByProduct.at(productCountIndex) = reportedLicenseTotal(row, productCountIndex);
+            m_changedProducts.push_back(productCountIndex);
+        }
+    }
+}
+
+
+int LogData::getCountOffset(const size_t& row)
+{
+    return m_eventData.count.at(row);
+}
+
+
+size_t LogData::reportedLicenseCount(const size_t row, const size_t product)
+{
+    // Report logs give the number of licenses in use after each OUT and IN.  In a pool
+    // that's only the server's share of the count.
+    size_t reported = getCountOffset(row);
+    if (m_serverUsage.empty())
+    {
+        return reported;
+    }
+    std::vector<size_t>& serverCounts = m_serverUsage.at(m_eventServers.at(row)).licenseCounts;
+    serverCounts.resize(std::max(serverCounts.size(), product + 1), 0);
+    size_t count = m_licenseCountNumbers.at(product) - serverCounts.at(product) + reported;
+    serverCounts.at(product) = reported;
+    return count;
+}
+
+
+int LogData::reportedLicenseTotal(const size_t row, const size_t product)
+{
+    // Likewise for the licenses a server has of each product
+    int reported = m_eventData.count.at(row);
+    if (m_serverUsage.empty())
+    {
+        return reported;
+    }
+    std::vector<int>& serverTotals = m_serverUsage.at(m_eventServers.at(row)).maxLicenseCounts;
+    serverTotals.resize(std::max(serverTotals.size(), product + 1), 0);
+    int total = m_maxLicenseCountsByProduct.at(product) - serverTotals.at(product) + reported;
+    serverTotals.at(product) = reported;
+    return total;
+}
+
+
+bool LogData::checkInFromServer(const size_t row, const size_t user, const size_t product)
+{
+    // In a pool, a user's licenses can only be checked in on the server they came from
+    if (m_serverUsage.empty())
+    {
+        return true;
+    }
+    std::map<std::pair<size_t, size_t>, size_t>& serverCounts =
+        m_serverUsage.at(m_eventServers.at(row)).licenseCountsByUserAndProduct;
+    auto found = serverCounts.find({user, product});
+    if (found == serverCounts.end() || found->second == 0)
+    {
+        return false;
+    }
+    --found->second;
+    return true;
+}
+
+
+void LogData::shutDownServer(const size_t server)
+{
+    // Only the licenses of the server that shut down are returned
+    ServerUsage& serverUsage = m_serverUsage.at(server);
+    for (size_t product=0; product < serverUsage.licenseCounts.size(); ++product)
+    {
+        m_licenseCountNumbers.at(product) -= serverUsage.licenseCounts.at(product);
+        serverUsage.licenseCounts.at(product) = 0;
+    }
+    for (const auto& userProductCount : serverUsage.licenseCountsByUserAndProduct)
+    {
+        size_t user = userProductCount.first.first;
+        size_t product = userProductCount.first.second;
+        size_t& poolCount = m_licenseCountByProductAndUser.at(user).at(product);
+        if (userProductCount.second > 0)
+        {
+            poolCount -= userProductCount.second;
+            if (poolCount == 0 && m_uniqueLicenseCountsByProduct.at(product) > 0)
             {
-                allDataRow.erase(allDataRow.begin()+isvINIndexProduct, allDataRow.begin()+col+1);
-                break;
+                --m_uniqueLicenseCountsByProduct.at(product);
             }
         }
     }
+    serverUsage.licenseCountsByUserAndProduct.clear();
 }
 
 
-void LogData::removeNoGood(const size_t row,
-                  std::vector<std::string>& allDataRow)
+void LogData::gatherConcurrentUsageData(const size_t& row)
 {
-    if (allDataRow.at(isvDENYIndexProduct) == "no" &&
-       (allDataRow.at(isvDENYIndexVersion) == "good"))
+    // Only the products an event could have changed are compared, so a row costs the
+    // same however many products the log has
+    std::sort(m_changedProducts.begin(), m_changedProducts.end());
+    m_changedProducts.erase(std::unique(m_changedProducts.begin(), m_changedProducts.end()), m_changedProducts.end());
+
+    size_t firstChange = m_usageChanges.size();
+    for (size_t product : m_changedProducts)
     {
-        allDataRow.erase(allDataRow.begin()+isvDENYIndexProduct);
-        allDataRow.erase(allDataRow.begin()+isvDENYIndexProduct);
+        UsageCounts usage = {m_licenseCountNumbers.at(product),
+                             m_uniqueLicenseCountsByProduct.at(product),
+                             m_maxLicenseCountsByProduct.at(product)};
+        UsageCounts& rowUsage = m_rowUsage.at(product);
+        if (usage.inUse != rowUsage.inUse ||
+            usage.uniqueUsers != rowUsage.uniqueUsers ||
+            usage.totalLicenses != rowUsage.totalLicenses)
+        {
+            rowUsage = usage;
+            m_usageChanges.push_back({product, usage});
+        }
     }
+    m_changedProducts.clear();
+
+    m_usageRows.push_back({row, firstChange, m_usageChanges.size() - firstChange});
 }
 
 
-void LogData::reformatEventName(const size_t row,
-                                const std::string newLabel)
+const ConcurrencyIndex& LogData::concurrencyIndex(const std::string& product)
 {
-    m_allData.at(row).at(m_eventIndex) = newLabel;
+    // ISV logs only give the month and day, so their events have no timestamps
+    if (m_fileFormat != ReportLog)
+    {
+        QueryFormatException queryFormatException;
+        throw queryFormatException;
+    }
+
+    getConcurrentUsage();
+    uint32_t productIndex = m_uniqueProducts.find(product);
+    if (productIndex == StringTable::NotFound)
+    {
+        UnknownProductException unknownProductException(product);
+        throw unknownProductException;
+    }
+
+    if (m_concurrencyIndices.empty())
+    {
+        // One pass over the usage rows sorts out each product's changes, in the order
+        // they were logged, starting from the usage before the first row
+        std::vector<std::vector<UsageStep>> steps(m_uniqueProducts.size());
+        for (const UsageRow& usageRow : m_usageRows)
+        {
+            int64_t time = m_eventData.timestamp.at(usageRow.eventRow);
+            for (size_t change = usageRow.firstChange; change < usageRow.firstChange + usageRow.changeCount; ++change)
+            {
+                const UsageChange& usageChange = m_usageChanges.at(change);
+                steps.at(usageChange.product).push_back({time, static_cast<int>(usageChange.counts.inUse)});
+            }
+        }
+
+        m_concurrencyIndices.reserve(steps.size());
+        for (size_t index=0; index < steps.size(); ++index)
+        {
+            int64_t initialUsage = 0;
+            if (index < m_usageBaseline.size())
+            {
+                initialUsage = static_cast<int>(m_usageBaseline.at(index).inUse);
+            }
+            m_concurrencyIndices.emplace_back(initialUsage, steps.at(index));
+        }
+    }
+    return m_concurrencyIndices.at(productIndex);
 }
 
 
-void LogData::reformatUserHost(const size_t row,
-                               const std::vector<size_t>& indices)
+void LogData::getUsageDuration()
 {
-    std::vector<std::string> tempVector;
-    size_t userIndex = indices.at(IndexUser);
-    size_t hostIndex = indices.at(IndexHost);
+    // Worked out again from all the events in memory once new ones have been read.  Only
+    // report logs have the handles that pair checkouts with checkins.
+    if (m_durationCurrent || m_fileFormat != ReportLog)
+    {
+        return;
+    }
+    StageTimer stageTimer(m_profile, DurationStage);
+    if (m_progress)
+    {
+        m_progress->startStage(DurationStage, 0, m_eventData.size());
+    }
+    m_checkOutRows.clear();
+    m_checkInRows.clear();
+
+    // Initialize matrix for total duration by user and product, starting from the
+    // checkouts a previous incremental run closed
+    m_closedDuration = m_carriedDuration;
+    m_closedDuration.resize(m_uniqueUsers.size());
+    for (size_t row=0; row < m_uniqueUsers.size(); ++row)
+    {
+        m_closedDuration.at(row).resize(m_uniqueProducts.size(), std::chrono::seconds{0});
+    }
+    m_totalDuration = m_closedDuration;
+
+    // Pair every checkout with the first later IN that has the same handle, or the first
+    // later SHUTDOWN, whichever comes first.  Open checkouts are indexed by handle so each
+    // event is visited once.  A handle can be reused before it's checked in, so every
+    // checkout still open under that handle is closed by the same IN.  In a pool each
+    // server has handles of its own, and a SHUTDOWN only closes its server's checkouts.
+    std::vector<size_t>& checkOutRows = m_checkOutRows;
+    std::vector<int>& checkInRows = m_checkInRows;
+    std::unordered_map<uint64_t, std::vector<size_t>> openCheckOuts;
+    auto serverHandle = [this](size_t row)
+    {
+        uint64_t server = m_eventServers.empty() ? 0 : m_eventServers.at(row);
+        return (server << 32) | m_eventData.handle.at(row);
+    };
+
+    for (size_t row=0; row < m_eventData.size(); ++row)
+    {
+        if (m_eventData.type.at(row) == OutEvent)
+        {
+            openCheckOuts[serverHandle(row)].push_back(checkOutRows.size());
+            checkOutRows.push_back(row);
+            checkInRows.push_back(-1);
+        }
+        else if (m_eventData.type.at(row) == InEvent)
+        {
+            auto found = openCheckOuts.find(serverHandle(row));
+            if (found != openCheckOuts.end())
+            {
+                for (size_t checkOut : found->second)
+                {
+                    checkInRows.at(checkOut) = row;
+                }
+                openCheckOuts.erase(found);
+            }
+        }
+        // A shutdown forces the return of any licenses so it will be the checkin time of 
+        // any checked out licenses
+        else if (m_eventData.type.at(row) == ShutdownEvent)
+        {
+            uint64_t server = serverHandle(row) >> 32;
+            for (auto handleCheckOuts = openCheckOuts.begin(); handleCheckOuts != openCheckOuts.end();)
+            {
+                if ((handleCheckOuts->first >> 32) != server)
+                {
+                    ++handleCheckOuts;
+                    continue;
+                }
+                for (size_t checkOut : handleCheckOuts->second)
+                {
+                    checkInRows.at(checkOut) = row;
+                }
+                handleCheckOuts = openCheckOuts.erase(handleCheckOuts);
+            }
+        }
+        if (m_progress && (row + 1) % ProgressInterval == 0)
+        {
+            m_progress->advance(0, ProgressInterval);
+        }
+    }
 
-    tokenizeString("@", m_allData.at(row).at(userIndex), tempVector);
-    m_allData.at(row).erase(m_allData.at(row).begin()+userIndex);
-    m_allData.at(row).insert(m_allData.at(row).begin()+userIndex, tempVector.at(0));
-    m_allData.at(row).insert(m_allData.at(row).begin()+hostIndex, tempVector.at(1));
+    // Anything still open is checked out at the end of the log, so it ends at m_endTimeRow
+    m_firstOpenCheckOut = std::find(checkInRows.begin(), checkInRows.end(), -1) - checkInRows.begin();
+
+    for (size_t checkOut=0; checkOut < checkOutRows.size(); ++checkOut)
+    {
+        size_t row = checkOutRows.at(checkOut);
+        std::chrono::nanoseconds usageDuration = checkOutDuration(checkOut);
+        size_t user = userIndex(row);
+        size_t product = productIndex(row);
+        m_totalDuration.at(user).at(product) += usageDuration;
+        if (checkOut < m_firstOpenCheckOut)
+        {
+            m_closedDuration.at(user).at(product) += usageDuration;
+        }
+    }
+    m_durationCurrent = true;
+    m_profile.addCounts(DurationStage, 0, m_eventData.size());
+    if (m_progress)
+    {
+        m_progress->advance(0, m_eventData.size() % ProgressInterval);
+        m_progress->finishStage();
+    }
 }
 
 
-void LogData::reformatProductVersion(const size_t row,
-                                     const size_t col,
-                                     std::vector<std::string>& allDataRow)
+std::chrono::nanoseconds LogData::checkOutDuration(const size_t checkOut)
 {
-    checkForValidProductVersion(row, col, allDataRow);
-    std::string tempString = allDataRow.at(col);
-    tempString.erase(0,1);
-    allDataRow.at(col) = tempString;
+    int checkInRow = m_checkInRows.at(checkOut);
+    int64_t startTime = m_eventData.timestamp.at(m_checkOutRows.at(checkOut));
+    int64_t endTime;
+    if (checkInRow != -1)
+    {
+        endTime = m_eventData.timestamp.at(checkInRow);
+    }
+    else
+    {
+        endTime = m_eventData.timestamp.at(m_endTimeRow);
+    }
+    return std::chrono::seconds{endTime - startTime};
+}
+
+
+void LogData::writeSummaryData(const std::string& outputFilePath)
+{
+    BufferedWriter writer(outputFilePath);
+
+    writer.write("Log Data Summary For:\n");
+    writer.write(m_inputFilePath);
+    writer.write("\n\n");
+    writer.write("Server Name: ");
+    writer.write(m_serverName);
+    writer.write("\n\n");
+
+    size_t numberOfStarts = m_startEvents.size();
+    writer.write("Server Start(s): (");
+    writer.writeNumber(numberOfStarts);
+    writer.write(" Total)\n");
+    for (size_t row = 0; row < numberOfStarts; ++row)
+    {
+        size_t eventRow = m_startEvents.at(row);
+        for (size_t field = 1; field < eventFieldCount(eventRow); ++field)
+        {
+            writeEventField(writer, eventRow, field);
+            writer.write(' ');
+        }
+        writer.write('\n');
+    }
+    writer.write('\n');
+
+    size_t numberOfShutdowns = m_shutdownEvents.size();
+    writer.write("Server Shutdown(s): (");
+    writer.writeNumber(numberOfShutdowns);
+    writer.write(" Total)\n");
+    for (size_t row = 0; row < numberOfShutdowns; ++row)
+    {
+        size_t eventRow = m_shutdownEvents.at(row);
+        for (size_t field = 1; field < eventFieldCount(eventRow); ++field)
+        {
+            writeEventField(writer, eventRow, field);
+            writer.write(' ');
+        }
+        writer.write('\n');
+    }
+    writer.write('\n');
+
+    size_t numberOfProducts = m_uniqueProducts.size();
+    writer.write("Product(s): (");
+    writer.writeNumber(numberOfProducts);
+    writer.write(" Total)\n");
+    for (size_t row = 0; row < numberOfProducts; ++row)
+    {
+        writer.write(m_uniqueProducts.at(row));
+        writer.write('\n');
+    }
+    writer.write('\n');
+
+    size_t numberOfUsers = m_uniqueUsers.size();
+    writer.write("Users(s): (");
+    writer.writeNumber(numberOfUsers);
+    writer.write(" Total)\n");
+    for (size_t row = 0; row < numberOfUsers; ++row)
+    {
+        writer.write(m_uniqueUsers.at(row));
+        writer.write('\n');
+    }
+    writer.write('\n');
+
+
+    // Denials are listed up to the user
+    size_t numberOfDenials = m_denialEvents.size();
+    writer.write("Denials(s): (");
+    writer.writeNumber(numberOfDenials);
+    writer.write(" Total)\n");
+    for (size_t row = 0; row < numberOfDenials; ++row)
+    {
+        for (size_t field = IndexDate; field < IndexHost; ++field)
+        {
+            writeEventField(writer, m_denialEvents.at(row), field);
+            writer.write(' ');
+        }
+        writer.write('\n');
+    }
+    writer.close();
+}
+
+
+void LogData::writeEventData(const std::string& outputFilePath)
+{
+    // A resumed analysis adds the new events to the file from the previous run
+    BufferedWriter writer(outputFilePath, m_resumed);
+
+    for (size_t row = m_firstNewRow; row < m_eventData.size(); ++row)
+    {
+        size_t numberOfFields = eventFieldCount(row);
+        for (size_t field = 0; field < numberOfFields; ++field)
+        {
+            writeEventField(writer, row, field);
+            if (field != numberOfFields-1)
+            {
+                writer.write(' ');
+            }
+        }
+        writer.write('\n');
+    }
+    writer.close();
 }
 
 
-void LogData::reformatToken(std::vector<std::string>& allDataRow)
+void LogData::writeUsageOverTime(const std::string& outputFilePath)
 {
-    // Try to find the token license count, which is in the string "(# licenses)",
-    // which has already been split up into two elements, "(#" and "licenses)"
-    bool tokenFound = false;
-    for (size_t col=isvINIndexHost; col<allDataRow.size(); ++col)
+    // Rows are never changed once gathered, so a resumed analysis only adds the new ones,
+    // unless a new product means the rows already written need more columns
+    if (m_resumed && m_uniqueProducts.size() > m_previousProductCount)
     {
-        size_t found = allDataRow.at(col).find("licenses)");
-        if (found != std::string::npos)
-        {
-            tokenFound = true;
-
-            // Element before "licenses" is the actual token count
-            std::string tempString = allDataRow.at(col-1);
+        padUsageOverTime(outputFilePath);
+    }
 
-            // Strip the leading paren, (
-            tempString.erase(0,1);
+    BufferedWriter writer(outputFilePath, m_resumed);
+    if (!m_resumed)
+    {
+        writeUsageHeader(writer);
+    }
 
-            allDataRow.insert(allDataRow.begin()+isvINTokenCount, tempString);
+    // Products first seen after a row had no usage yet, so they start out at zero
+    bool reportLog = (m_fileFormat == ReportLog);
+    std::vector<UsageCounts> usage = m_usageBaseline;
+    usage.resize(m_uniqueProducts.size(), {0, 0, 0});
+    for (const UsageRow& usageRow : m_usageRows)
+    {
+        for (size_t change = usageRow.firstChange; change < usageRow.firstChange + usageRow.changeCount; ++change)
+        {
+            usage.at(m_usageChanges.at(change).product) = m_usageChanges.at(change).counts;
+        }
 
-            break;
+        writeEventDateTime(writer, usageRow.eventRow);
+        for (const UsageCounts& productUsage : usage)
+        {
+            writer.write(',');
+            writer.writeNumber(productUsage.inUse);
+            writer.write(',');
+            writer.writeNumber(productUsage.uniqueUsers);
+            if (reportLog)
+            {
+                writer.write(',');
+                writer.writeNumber(productUsage.totalLicenses);
+            }
         }
+        writer.write('\n');
     }
-
-    // If the token license count wasn't found, we assume the count is 1
-    if (! tokenFound)
-        allDataRow.insert(allDataRow.begin()+isvINTokenCount, "1");
+    writer.close();
 }
 
 
-
-void LogData::licenseCountAdjust(std::vector<size_t>& licenseCountNumbers,
-                        std::vector<std::string>& licenseCountsByProduct)
+void LogData::writeUsageChanges(const std::string& outputFilePath)
 {
-    licenseCountsByProduct.clear();
-    for (size_t product=0; product<licenseCountNumbers.size(); ++product)
+    // Every event keeps its place in time, but only with the products it changed.  A row
+    // where nothing changed, like a shutdown with nothing checked out, has no lines.
+    // Usage still to be worked out is written a row at a time as the rows are made.
+    bool reportLog = (m_fileFormat == ReportLog);
+    BufferedWriter writer(outputFilePath, m_resumed);
+    if (!m_resumed)
     {
-        std::string licenseCountString = toString(licenseCountNumbers.at(product));
-        licenseCountsByProduct.push_back(licenseCountString);
+        writer.write(reportLog ? "Date/Time,Product,Licenses in use,Unique user count,Total licenses\n"
+                               : "Date/Time,Product,Licenses in use,Unique user count\n");
     }
-}
 
+    writeUsageRows(writer, 0, m_usageRows.size());
+    getConcurrentUsage(&writer);
+    writer.close();
+}
 
 
-void LogData::loadEventIntoVector(const std::vector<std::string>& allDataRow,
-                                  const size_t row,
-                                  const std::vector<size_t>& indices)
+void LogData::writeUsageRows(BufferedWriter& writer, const size_t firstRow, const size_t endRow)
 {
-    std::vector<std::string> eventLine;
-    if (allDataRow.size() >= indices.size())
+    bool reportLog = (m_fileFormat == ReportLog);
+    for (size_t row=firstRow; row < endRow; ++row)
     {
-        for (size_t col=0; col<indices.size(); ++col)
+        const UsageRow& usageRow = m_usageRows.at(row);
+        for (size_t change = usageRow.firstChange; change < usageRow.firstChange + usageRow.changeCount; ++change)
         {
-            eventLine.push_back(allDataRow.at(indices.at(col)));
+            const UsageChange& usageChange = m_usageChanges.at(change);
+            writeEventDateTime(writer, usageRow.eventRow);
+            writer.write(',');
+            writer.write(m_uniqueProducts.at(usageChange.product));
+            writer.write(',');
+            writer.writeNumber(usageChange.counts.inUse);
+            writer.write(',');
+            writer.writeNumber(usageChange.counts.uniqueUsers);
+            if (reportLog)
+            {
+                writer.write(',');
+                writer.writeNumber(usageChange.counts.totalLicenses);
+            }
+            writer.write('\n');
         }
-        m_eventData.push_back(eventLine);
-    }
-    else
-    {
-        EventDataException eventDataException(row+1);
-        throw eventDataException;
     }
 }
 
 
-size_t LogData::getIndex(const std::string& name, const std::vector<std::string>& list)
+void LogData::writeUsageHeader(BufferedWriter& writer)
 {
-    for (size_t index=0; index < list.size(); ++index)
+    writer.write("Date/Time");
+    for (size_t product=0; product<m_uniqueProducts.size(); ++product)
     {
-        if (list.at(index) == name)
+        writer.write(',');
+        writer.write(m_uniqueProducts.at(product));
+        writer.write(" Licenses in use,");
+        writer.write(m_uniqueProducts.at(product));
+        writer.write(" Unique user count");
+        if (m_fileFormat == ReportLog)
         {
-            return index;
+            writer.write(',');
+            writer.write(m_uniqueProducts.at(product));
+            writer.write(" Total licenses");
         }
     }
-
-    InvalidIndexException invalidIndexException(name);
-    throw invalidIndexException;
+    writer.write('\n');
 }
 
 
-void LogData::checkForValidProductVersion(const size_t row,
-                                 const size_t col,
-                                 std::vector<std::string>& allDataRow)
+void LogData::padUsageOverTime(const std::string& outputFilePath)
 {
-    std::string productVersion = allDataRow.at(col);
-
-    // Check for the "v" at the beginning of the product version
-    size_t found = productVersion.find("v");
+    // Usage of the new products was zero until they appeared, so they get zero columns
+    // in the rows written before, just as writeUsageOverTime() starts them out
+    std::string padding;
+    for (size_t product = m_previousProductCount; product < m_uniqueProducts.size(); ++product)
+    {
+        padding.append((m_fileFormat == ReportLog) ? ",0,0,0" : ",0,0");
+    }
 
-    if (found != 0)
+    std::string tempFilePath = outputFilePath + ".tmp";
+    std::ifstream oldFile(outputFilePath.c_str());
+    if (!oldFile.is_open())
     {
-        InvalidProductVersionException invalidProductVersionException(row+1);
-        throw invalidProductVersionException;
+        CannotOpenFileException cannotOpenFileException(outputFilePath);
+        throw cannotOpenFileException;
     }
-}
+    BufferedWriter newFile(tempFilePath);
 
+    std::string line;
+    std::getline(oldFile, line);
+    writeUsageHeader(newFile);
 
-void LogData::checkForUnhandledINDetails(const size_t row)
-{
-    size_t found = m_allData.at(row).at(isvINIndexProduct).find("(");
-    if (found != std::string::npos)
+    while (std::getline(oldFile, line))
     {
-        INEventDetailException inEventDetailException(row+1);
-        throw inEventDetailException;
+        newFile.write(line);
+        newFile.write(padding);
+        newFile.write('\n');
+    }
+    oldFile.close();
+    newFile.close();
+
+    std::error_code error;
+    std::filesystem::rename(tempFilePath, outputFilePath, error);
+    if (error)
+    {
+        CannotOpenFileException cannotOpenFileException(outputFilePath);
+        throw cannotOpenFileException;
     }
 }
 
 
-void LogData::getConcurrentUsage()
+void LogData::writeUsageDuration(const std::string& outputFilePath)
 {
-    std::vector<std::string> licenseCountsByProduct (m_uniqueProducts.size(), "0");
-    std::vector<size_t> uniqueLicenseCountsByProduct (m_uniqueProducts.size(), 0);
-    std::vector<std::vector<size_t>> licenseCountByProductAndUser;
-    std::vector<std::string> maxLicenseCountsByProduct (m_uniqueProducts.size(), "0");
-    std::vector<size_t> licenseCountNumbers (m_uniqueProducts.size(), 0);
-    size_t productCountIndex;
-    size_t userCountIndex;
+    if (m_resumed)
+    {
+        // Rows before the first checkout that was open last time are final, and the
+        // header is among them.  The rest are cut off and written again.
+        std::error_code error;
+        std::filesystem::resize_file(outputFilePath, m_finalDurationSize, error);
+        if (error)
+        {
+            CannotOpenFileException cannotOpenFileException(outputFilePath);
+            throw cannotOpenFileException;
+        }
+    }
 
-    // Initialize matrix for license count by user and product
-    for (size_t row=0; row < m_uniqueUsers.size(); ++row)
+    BufferedWriter writer(outputFilePath, m_resumed);
+    if (!m_resumed)
     {
-        std::vector<size_t> tempCountVector;
-        for (size_t col=0; col < m_uniqueProducts.size(); ++col)
+        writer.write("Checkout Date/Time,Checkin Date/Time,Product,Version,User,Duration (HH:MM:SS)\n");
+        if (m_firstOpenCheckOut == 0)
         {
-            tempCountVector.push_back(0);
+            m_finalDurationSize = writer.position();
         }
-        licenseCountByProductAndUser.push_back(tempCountVector);
     }
 
-    std::vector<std::string> tempVector;
-    tempVector.push_back("Date/Time");
-    for (size_t product=0; product<m_uniqueProducts.size(); ++product)
+    for (size_t checkOut = 0; checkOut < m_checkOutRows.size(); ++checkOut)
     {
-        if (m_fileFormat == ReportLog)
+        size_t row = m_checkOutRows.at(checkOut);
+        int checkInRow = m_checkInRows.at(checkOut);
+
+        writeEventDateTime(writer, row);
+        writer.write(',');
+        if (checkInRow != -1)
         {
-            tempVector.push_back(m_uniqueProducts.at(product) + " Licenses in use");
-            tempVector.push_back(m_uniqueProducts.at(product) + " Unique user count");
-            tempVector.push_back(m_uniqueProducts.at(product) + " Total licenses");
+            writeEventDateTime(writer, checkInRow);
         }
         else
         {
-            tempVector.push_back(m_uniqueProducts.at(product) + " Licenses in use");
-            tempVector.push_back(m_uniqueProducts.at(product) + " Unique user count");
+            writer.write("(Still checked out)");
+        }
+        writer.write(',');
+        writer.write(m_eventData.text(m_eventData.product.at(row)));
+        writer.write(',');
+        writer.write(m_eventData.text(m_eventData.version.at(row)));
+        writer.write(',');
+        writer.write(m_eventData.text(m_eventData.user.at(row)));
+        writer.write(',');
+        writer.write(durationToHHMMSS(checkOutDuration(checkOut)));
+        writer.write('\n');
+
+        // This is the last row for a closed checkout
+        if (checkOut + 1 == m_firstOpenCheckOut)
+        {
+            m_finalDurationSize = writer.position();
         }
     }
-    m_usage.push_back(tempVector);
+    writer.close();
+}
+
+
+void LogData::writeTotalDuration(const std::string& outputFilePath)
+{
+    BufferedWriter writer(outputFilePath);
 
-    for (size_t row=0; row<m_eventData.size(); ++row)
+    writer.write("User,");
+    size_t columnSize = m_uniqueProducts.size();
+    for (size_t col=0; col < columnSize; ++col)
     {
-        if (m_eventData.at(row).at(IndexEvent) == "OUT")
+        writer.write(m_uniqueProducts.at(col));
+        writer.write(" Duration (HH:MM:SS)");
+        if (col != columnSize-1)
         {
-            productCountIndex = getIndex(m_eventData.at(row).at(IndexProduct), m_uniqueProducts);
-            userCountIndex = getIndex(m_eventData.at(row).at(IndexUser), m_uniqueUsers);
+            writer.write(',');
+        }
+    }
+    writer.write('\n');
 
-            // Total usage
-            if (m_fileFormat == ReportLog)
-            {
-                licenseCountsByProduct.at(productCountIndex) = m_eventData.at(row).at(IndexCount);
-            }
-            else
+    for (size_t row=0; row < m_uniqueUsers.size(); ++row)
+    {
+        writer.write(m_uniqueUsers.at(row));
+        writer.write(',');
+        for (size_t col=0; col < columnSize; ++col)
+        {
+            writer.write(durationToHHMMSS(m_totalDuration.at(row).at(col)));
+            if (col != columnSize-1)
             {
-                licenseCountNumbers.at(productCountIndex) = licenseCountNumbers.at(productCountIndex) + getCountOffset(row);
-                licenseCountAdjust(licenseCountNumbers, licenseCountsByProduct);
+                writer.write(',');
             }
+        }
+        writer.write('\n');
+    }
+    writer.close();
+}
 
-            // Unique usage
-            ++licenseCountByProductAndUser.at(userCountIndex).at(productCountIndex);
-            if (licenseCountByProductAndUser.at(userCountIndex).at(productCountIndex) == 1)
-            {
-                ++uniqueLicenseCountsByProduct.at(productCountIndex);
-            }
 
-            gatherConcurrentUsageData(row, licenseCountsByProduct, uniqueLicenseCountsByProduct, maxLicenseCountsByProduct);
+void LogData::writeUsageByPeriod(const std::string& outputFilePath)
+{
+    if (m_resumed)
+    {
+        // Periods before the one in progress last time are final
+        std::error_code error;
+        std::filesystem::resize_file(outputFilePath, m_finalPeriodSize, error);
+        if (error)
+        {
+            CannotOpenFileException cannotOpenFileException(outputFilePath);
+            throw cannotOpenFileException;
         }
-        else if (m_eventData.at(row).at(IndexEvent) == "IN")
+    }
+
+    BufferedWriter writer(outputFilePath, m_resumed);
+    if (!m_resumed)
+    {
+        UsageAggregator::writeHeader(writer);
+    }
+
+    // Usage rows and denials are fed in the order they were logged.  Denials carried over
+    // for the summary were already counted.
+    UsageAggregator aggregator = m_periodBaseline;
+    std::vector<size_t>::const_iterator denial = std::lower_bound(m_denialEvents.begin(), m_denialEvents.end(), m_firstNewRow);
+    for (const UsageRow& usageRow : m_usageRows)
+    {
+        for (; denial != m_denialEvents.end() && *denial < usageRow.eventRow; ++denial)
         {
-            productCountIndex = getIndex(m_eventData.at(row).at(IndexProduct), m_uniqueProducts);
-            userCountIndex = getIndex(m_eventData.at(row).at(IndexUser), m_uniqueUsers);
+            aggregator.advance(m_eventData.timestamp.at(*denial), writer);
+            aggregator.addDenial(m_eventData.text(m_eventData.product.at(*denial)));
+        }
 
-            // Total usage
-            if (m_fileFormat == ReportLog)
-            {
-                licenseCountsByProduct.at(productCountIndex) = m_eventData.at(row).at(IndexCount);
-            }
-            else
-            {
-                licenseCountNumbers.at(productCountIndex) = licenseCountNumbers.at(productCountIndex) - getCountOffset(row);
-                licenseCountAdjust(licenseCountNumbers, licenseCountsByProduct);
-            }
+        aggregator.advance(m_eventData.timestamp.at(usageRow.eventRow), writer);
+        for (size_t change = usageRow.firstChange; change < usageRow.firstChange + usageRow.changeCount; ++change)
+        {
+            const UsageChange& usageChange = m_usageChanges.at(change);
+            aggregator.setUsage(m_uniqueProducts.at(usageChange.product),
+                                usageChange.counts.inUse,
+                                usageChange.counts.uniqueUsers);
+        }
+    }
+    for (; denial != m_denialEvents.end(); ++denial)
+    {
+        aggregator.advance(m_eventData.timestamp.at(*denial), writer);
+        aggregator.addDenial(m_eventData.text(m_eventData.product.at(*denial)));
+    }
+
+    // The period in progress runs to the last event, and is written again next time
+    m_periodState = aggregator;
+    m_finalPeriodSize = writer.position();
+    if (m_eventData.size() > 0)
+    {
+        aggregator.writeCurrentPeriod(m_eventData.timestamp.at(m_endTimeRow), writer);
+    }
+    writer.close();
+}
 
-            // Unique usage
 
-            // Make sure we can't iterate below zero
-            // (could happen if the log file started with licenses already checked out and the first event is a check-in)
-            if (licenseCountByProductAndUser.at(userCountIndex).at(productCountIndex) > 0)
-            {
-                --licenseCountByProductAndUser.at(userCountIndex).at(productCountIndex);
-            }
+void LogData::writeEventParquet(const std::string& outputFilePath)
+{
+    // Columns after the timestamp are laid out like eventIndices, and fields an event
+    // doesn't have are null
+    ParquetWriter writer(outputFilePath, {
+        {"type", ParquetString, false},
+        {"timestamp", ParquetTimestamp, true},
+        {"date", ParquetString, true},
+        {"time", ParquetString, true},
+        {"product", ParquetString, true},
+        {"version", ParquetString, true},
+        {"user", ParquetString, true},
+        {"host", ParquetString, true},
+        {"count", ParquetInt32, true},
+        {"handle", ParquetString, true}});
+    const size_t timestampColumn = 1;
+    const std::vector<uint32_t>* textFields[] = {nullptr, &m_eventData.date, &m_eventData.time,
+                                                 &m_eventData.product, &m_eventData.version,
+                                                 &m_eventData.user, &m_eventData.host, nullptr,
+                                                 &m_eventData.handle};
+
+    for (size_t row = 0; row < m_eventData.size(); ++row)
+    {
+        eventType type = m_eventData.type.at(row);
+        size_t fieldCount = eventFieldCount(row);
+        writer.addString(IndexEvent, type, eventTypeName(type));
+        if (m_fileFormat == ReportLog && type != ProductEvent)
+        {
+            writer.addNumber(timestampColumn, m_eventData.timestamp.at(row));
+        }
+        else
+        {
+            writer.addNull(timestampColumn);
+        }
 
-            if (licenseCountByProductAndUser.at(userCountIndex).at(productCountIndex) == 0 && uniqueLicenseCountsByProduct.at(productCountIndex) > 0)
+        for (size_t field = IndexDate; field <= IndexHandle; ++field)
+        {
+            bool hasField = (type == ProductEvent)
+                ? (field == IndexProduct || field == IndexVersion || field == IndexCount)
+                : (field < fieldCount);
+            if (!hasField)
             {
-                --uniqueLicenseCountsByProduct.at(productCountIndex);
+                writer.addNull(field + 1);
             }
-
-            if (atoi(licenseCountsByProduct.at(productCountIndex).c_str()) > 0 && uniqueLicenseCountsByProduct.at(productCountIndex) == 0)
+            else if (field == IndexCount)
             {
-                // This deals with the special case where a report log started after licenses were checked out.
-                // The log has no data on who checked out the licenses, it just gives a count of what's checked out.
-                // We post "1".  The actual value would be greater than or equal to that value.
-                uniqueLicenseCountsByProduct.at(productCountIndex) = 1;
-                gatherConcurrentUsageData(row, licenseCountsByProduct, uniqueLicenseCountsByProduct, maxLicenseCountsByProduct);
-
-                // Set the unique value back down to zero.  Otherwise, a subsequent OUT event will cause the unique users to go up
-                // to "2", even though we're not sure if the check-out is unique or not.
-                uniqueLicenseCountsByProduct.at(productCountIndex) = 0;
+                writer.addNumber(field + 1, m_eventData.count.at(row));
             }
             else
             {
-                gatherConcurrentUsageData(row, licenseCountsByProduct, uniqueLicenseCountsByProduct, maxLicenseCountsByProduct);
+                uint32_t id = textFields[field]->at(row);
+                writer.addString(field + 1, id, m_eventData.text(id));
             }
         }
-        else if (m_eventData.at(row).at(IndexEvent) == "SHUTDOWN")
+        writer.endRow();
+    }
+    writer.close();
+}
+
+
+void LogData::writeDurationParquet(const std::string& outputFilePath)
+{
+    // Checkouts still open at the end of the log have no checkin
+    ParquetWriter writer(outputFilePath, {
+        {"checkout", ParquetTimestamp, false},
+        {"checkin", ParquetTimestamp, true},
+        {"product", ParquetString, false},
+        {"version", ParquetString, false},
+        {"user", ParquetString, false},
+        {"duration_seconds", ParquetInt64, false}});
+
+    for (size_t checkOut = 0; checkOut < m_checkOutRows.size(); ++checkOut)
+    {
+        size_t row = m_checkOutRows.at(checkOut);
+        int checkInRow = m_checkInRows.at(checkOut);
+        uint32_t product = m_eventData.product.at(row);
+        uint32_t version = m_eventData.version.at(row);
+        uint32_t user = m_eventData.user.at(row);
+
+        writer.addNumber(0, m_eventData.timestamp.at(row));
+        if (checkInRow != -1)
         {
-            setVectorToZero(licenseCountNumbers);
-            setVectorToZero(uniqueLicenseCountsByProduct);
-            setMatrixToZero(licenseCountByProductAndUser);
-            licenseCountAdjust(licenseCountNumbers, licenseCountsByProduct);
-            gatherConcurrentUsageData(row, licenseCountsByProduct, uniqueLicenseCountsByProduct, maxLicenseCountsByProduct);
+            writer.addNumber(1, m_eventData.timestamp.at(checkInRow));
         }
-        else if (m_eventData.at(row).at(IndexEvent) == "PRODUCT")
+        else
         {
-            std::string tempProduct = m_eventData.at(row).at(1);
-            productCountIndex = getIndex(tempProduct, m_uniqueProducts);
-            if (m_fileFormat == ReportLog)
-            {
-                maxLicenseCountsByProduct.at(productCountIndex) = m_eventData.at(row).at(3);
-            }
+            writer.addNull(1);
         }
+        writer.addString(2, product, m_eventData.text(product));
+        writer.addString(3, version, m_eventData.text(version));
+        writer.addString(4, user, m_eventData.text(user));
+        writer.addNumber(5, std::chrono::duration_cast<std::chrono::seconds>(checkOutDuration(checkOut)).count());
+        writer.endRow();
     }
+    writer.close();
 }
 
 
-int LogData::getCountOffset(const size_t& row)
+void LogData::setOutputPaths()
 {
-    return atoi(m_eventData.at(row).at(IndexCount).c_str());
+    // Files only report logs have are left empty for other logs
+    std::string prefix = m_outputDirectory + "/" + m_inputFileName;
+    bool reportLog = (m_fileFormat == ReportLog);
+    m_outputPaths.push_back(prefix + "_Summary.txt");
+    m_outputPaths.push_back(prefix + "_AllEventData.txt");
+    m_outputPaths.push_back(prefix + "_UsageOverTime.csv");
+    m_outputPaths.push_back(reportLog ? prefix + "_UsageDuration.csv" : "");
+    m_outputPaths.push_back(reportLog ? prefix + "_TotalDuration.csv" : "");
+    m_outputPaths.push_back(reportLog ? prefix + "_UsageByPeriod.csv" : "");
+    m_outputPaths.push_back(prefix + "_AllEventData.parquet");
+    m_outputPaths.push_back(reportLog ? prefix + "_UsageDuration.parquet" : "");
 }
 
 
-void LogData::gatherConcurrentUsageData(const size_t& row,
-                                        const std::vector<std::string>& licenseUsageCount,
-                                        const std::vector<size_t>& uniqueLicenseCountsByProduct,
-                                        const std::vector<std::string>& maxLicenseUsageCount)
+bool LogData::readsInParts() const
 {
-    std::vector<std::string> tempVector;
-    tempVector.push_back(m_eventData.at(row).at(IndexDate) + " " + m_eventData.at(row).at(IndexTime));
-
-    for (size_t product=0; product<licenseUsageCount.size(); ++product)
-    {
-        tempVector.push_back(licenseUsageCount.at(product));
-        tempVector.push_back(toString(uniqueLicenseCountsByProduct.at(product)));
-        if (m_fileFormat == ReportLog)
-        {
-            tempVector.push_back(maxLicenseUsageCount.at(product));
-        }
-    }
-    
-    m_usage.push_back(tempVector);
+    return m_analysisMode == IncrementalAnalysis || m_analysisMode == SegmentedAnalysis;
 }
 
 
-void LogData::getUsageDuration()
+bool LogData::publishes(const unsigned int outputs, const size_t file) const
 {
-    int checkInRow = -1;
+    return (outputs & (1 << file)) && !m_outputPaths.at(file).empty();
+}
 
-    std::vector<std::string> tempVector;
-    tempVector.push_back("Checkout Date/Time");
-    tempVector.push_back("Checkin Date/Time");
-    tempVector.push_back("Product");
-    tempVector.push_back("Version");
-    tempVector.push_back("User");
-    tempVector.push_back("Duration (HH:MM:SS)");
-    m_usageDuration.push_back(tempVector);
 
-    // Initialize matrix for total duration by user and product
-    for (size_t row=0; row < m_uniqueUsers.size(); ++row)
+uint64_t LogData::outputSize(const unsigned int outputs) const
+{
+    uint64_t size = 0;
+    for (size_t file=0; file < m_outputPaths.size(); ++file)
     {
-        std::vector<std::chrono::nanoseconds> tempDurationVector;
-        for (size_t col=0; col < m_uniqueProducts.size(); ++col)
+        if (publishes(outputs, file))
         {
-            std::chrono::nanoseconds td = std::chrono::seconds{0};
-            tempDurationVector.push_back(td);
+            size += getFileSize(m_outputPaths.at(file));
         }
-        m_totalDuration.push_back(tempDurationVector);
     }
+    return size;
+}
 
 
-    for (size_t row=0; row < m_eventData.size(); ++row)
+void LogData::checkForExistingFiles(std::string& conflictedFileList, const unsigned int outputs)
+{
+    for (size_t file=0; file < m_outputPaths.size(); ++file)
     {
-        if (m_eventData.at(row).at(IndexEvent) == "OUT")
+        if (publishes(outputs, file) && fileExists(m_outputPaths.at(file)))
         {
-            std::string handle = m_eventData.at(row).at(IndexHandle);
-            std::string product = m_eventData.at(row).at(IndexProduct);
-            std::string userName = m_eventData.at(row).at(IndexUser);
-            auto startTime = stringToTime(m_eventData.at(row).at(IndexDate),
-                                                m_eventData.at(row).at(IndexTime));
-            std::chrono::time_point<std::chrono::system_clock> endTime;
-
-            for(size_t newRow=row+1; newRow < m_eventData.size(); ++newRow)
-            {
-                if (m_eventData.at(newRow).at(IndexEvent) == "IN")
-                {
-                    if (m_eventData.at(newRow).at(IndexHandle) == handle)
-                    {
-                        endTime = stringToTime(m_eventData.at(newRow).at(IndexDate),
-                                                    m_eventData.at(newRow).at(IndexTime));
-                        checkInRow = newRow;
-                        break;
-                    }
-                }
-                // A shutdown forces the return of any licenses so it will be the checkin time of 
-                // any checked out licenses
-                if (m_eventData.at(newRow).at(IndexEvent) == "SHUTDOWN")
-                {
-                    endTime = stringToTime(m_eventData.at(newRow).at(IndexDate),
-                                                m_eventData.at(newRow).at(IndexTime));
-                    checkInRow = newRow;
-                    break;
-                }
-            }
+            conflictedFileList.append(m_outputPaths.at(file));
+            conflictedFileList.append("\n");
+        }
+    }
+}
 
-            if (checkInRow == -1)
-            {
-                endTime = stringToTime(m_eventData.at(m_endTimeRow).at(IndexDate),
-                                            m_eventData.at(m_endTimeRow).at(IndexTime));
-            }
-            std::chrono::nanoseconds usageDuration = endTime - startTime;
-            m_totalDuration.at(getIndex(userName, m_uniqueUsers)).at(getIndex(product, m_uniqueProducts)) += usageDuration;
-            std::string usageDurationString = durationToHHMMSS(usageDuration);
-            
-            std::vector<std::string> tempVector;
 
-            std::string dateTimeCheckOut = m_eventData.at(row).at(IndexDate) + " " + m_eventData.at(row).at(IndexTime);
+void LogData::publishResults()
+{
+    publishResults(m_outputs);
+}
 
-            tempVector.push_back(dateTimeCheckOut);
-            if (checkInRow != -1)
-            {
-                std::string dateTimeCheckIn = m_eventData.at(checkInRow).at(IndexDate) + " " + m_eventData.at(checkInRow).at(IndexTime);
-                tempVector.push_back(dateTimeCheckIn);
-            }
-            else
-            {
-                tempVector.push_back("(Still checked out)");
-            }
 
-            tempVector.push_back(m_eventData.at(row).at(IndexProduct));
-            tempVector.push_back(m_eventData.at(row).at(IndexVersion));
-            tempVector.push_back(m_eventData.at(row).at(IndexUser));
-            tempVector.push_back(usageDurationString);
-            m_usageDuration.push_back(tempVector);
+void LogData::publishResults(const unsigned int outputs)
+{
+    if (readsInParts() && outputs != m_outputs)
+    {
+        IncrementalOutputsException incrementalOutputsException;
+        throw incrementalOutputsException;
+    }
 
-            checkInRow = -1;
-        }
+    // Each part read carries on from the one before, so a segmented analysis publishes
+    // until there's no more of the log
+    size_t endOffset;
+    do
+    {
+        endOffset = m_endOffset;
+        publishPart(outputs);
     }
+    while (m_analysisMode == SegmentedAnalysis && m_endOffset > endOffset);
 }
 
 
-void LogData::writeSummaryData(const std::string& outputFilePath)
+void LogData::publishPart(const unsigned int outputs)
 {
-    std::ofstream myfile;
-    myfile.open (outputFilePath.c_str());
+    prepareOutputs(outputs);
 
-    if (myfile.is_open())
+    // Files that are added to count what they grew by
+    uint64_t sizeBefore = (m_profile.enabled() && m_resumed) ? outputSize(outputs) : 0;
     {
-        myfile << "Log Data Summary For:" << "\n" << m_inputFilePath << "\n\n";
-        myfile << "Server Name: " << m_serverName << "\n\n";
-
-        size_t numberOfStarts = m_startEvents.size();
-        myfile << "Server Start(s): (" << numberOfStarts << " Total)\n";
-        for (size_t row = 0; row < numberOfStarts; ++row)
+        StageTimer stageTimer(m_profile, PublishStage);
+        if (m_progress)
         {
-            for (size_t col = 1; col < m_startEvents.at(row).size(); ++col)
-            {
-                myfile << m_startEvents.at(row).at(col) << " ";
-            }
-            myfile << "\n";
+            m_progress->startStage(PublishStage, 0, 0);
         }
-        myfile << "\n";
 
-        size_t numberOfShutdowns = m_shutdownEvents.size();
-        myfile << "Server Shutdown(s): (" << numberOfShutdowns << " Total)\n";
-        for (size_t row = 0; row < numberOfShutdowns; ++row)
+        // The files only read the results, and each writes members of its own, so they're
+        // written by a task each, the ones that tend to be biggest first.  The sparse usage
+        // over time file is first so the usage it works out is ready as soon as possible,
+        // and the usage by period, which needs all of it, follows it in the same task.
+        bool streamUsage = streamsUsage(outputs);
+        std::vector<std::pair<size_t, void (LogData::*)(const std::string&)>> files;
+        if ((outputs & UsageOverTimeOutput) && (outputs & SparseUsageOverTime))
         {
-            for (size_t col = 1; col < m_shutdownEvents.at(row).size(); ++col)
-            {
-                myfile << m_shutdownEvents.at(row).at(col) << " ";
-            }
-            myfile << "\n";
+            files.push_back({2, &LogData::writeUsageChanges});
         }
-        myfile << "\n";
-
-        size_t numberOfProducts = m_uniqueProducts.size();
-        myfile << "Product(s): (" << numberOfProducts << " Total)\n";
-        for (size_t row = 0; row < numberOfProducts; ++row)
+        else if (outputs & UsageOverTimeOutput)
         {
-            myfile << m_uniqueProducts.at(row) << "\n";
+            files.push_back({2, &LogData::writeUsageOverTime});
         }
-        myfile << "\n";
-
-        size_t numberOfUsers = m_uniqueUsers.size();
-        myfile << "Users(s): (" << numberOfUsers << " Total)\n";
-        for (size_t row = 0; row < numberOfUsers; ++row)
+        if (outputs & EventDataOutput)
         {
-            myfile << m_uniqueUsers.at(row) << "\n";
+            files.push_back({1, &LogData::writeEventData});
         }
-        myfile << "\n";
-
 
-        size_t numberOfDenials = m_denialEvents.size();
-        myfile << "Denials(s): (" << numberOfDenials << " Total)\n";
-        for (size_t row = 0; row < numberOfDenials; ++row)
+        // Durations depend on checkout handles, and periods on timestamps, which only report
+        // logs have
+        bool reportLog = (m_fileFormat == ReportLog);
+        if (reportLog && (outputs & UsageDurationOutput))
         {
-            for (size_t col = 1; col < 6; ++col)
-            {
-                myfile << m_denialEvents.at(row).at(col) << " ";
-            }
-            myfile << "\n";
+            files.push_back({3, &LogData::writeUsageDuration});
         }
-        myfile.close();
-    }
-    else
-    {
-        CannotOpenFileException cannotOpenFileException(outputFilePath);
-        throw cannotOpenFileException;
-    }
-}
-
-
-void LogData::writeTotalDuration(const std::string& outputFilePath)
-{
-    std::ofstream myfile;
-    myfile.open (outputFilePath.c_str());
-
-    if (myfile.is_open())
-    {
-        myfile << "User,";
-        size_t columnSize = m_uniqueProducts.size();
-        for (size_t col=0; col < m_uniqueProducts.size(); ++col)
+        if (outputs & EventParquetOutput)
         {
-            myfile << m_uniqueProducts.at(col) << " Duration (HH:MM:SS)";
-            if (col != columnSize-1)
-            {
-                myfile << ",";
-            }
+            files.push_back({6, &LogData::writeEventParquet});
         }
-        myfile << "\n";
-
-        for (size_t row=0; row < m_uniqueUsers.size(); ++row)
+        if (reportLog && (outputs & DurationParquetOutput))
+        {
+            files.push_back({7, &LogData::writeDurationParquet});
+        }
+        bool periodAfterUsage = reportLog && (outputs & UsageByPeriodOutput) && streamUsage;
+        if (reportLog && (outputs & UsageByPeriodOutput) && !streamUsage)
+        {
+            files.push_back({5, &LogData::writeUsageByPeriod});
+        }
+        if (outputs & SummaryOutput)
+        {
+            files.push_back({0, &LogData::writeSummaryData});
+        }
+        if (reportLog && (outputs & TotalDurationOutput))
+        {
+            files.push_back({4, &LogData::writeTotalDuration});
+        }
+        runInParallel(files.size(), threadsToUse(), [this, &files, periodAfterUsage](size_t file)
         {
-            std::vector<std::chrono::nanoseconds> tempDurationVector;
-            myfile << m_uniqueUsers.at(row) << ",";
-            
-            size_t columnSize = m_uniqueProducts.size();
-            for (size_t col=0; col < columnSize; ++col)
+            publishFile(files.at(file).first, files.at(file).second);
+            if (file == 0 && periodAfterUsage)
             {
-                std::string usageDurationString = durationToHHMMSS(m_totalDuration.at(row).at(col));
-                myfile << usageDurationString;
-                if (col != columnSize-1)
-                {
-                    myfile << ",";
-                }
+                publishFile(5, &LogData::writeUsageByPeriod);
             }
-            myfile << "\n";
-        }
+        });
 
-        myfile.close();
-    }
-    else
-    {
-        CannotOpenFileException cannotOpenFileException(outputFilePath);
-        throw cannotOpenFileException;
+        if (m_progress)
+        {
+            m_progress->finishStage();
+        }
+        if (m_profile.enabled())
+        {
+            uint64_t sizeAfter = outputSize(outputs);
+            m_profile.addCounts(PublishStage, 0, 0, 0, (sizeAfter > sizeBefore) ? sizeAfter - sizeBefore : 0);
+        }
     }
-}
 
-
-void LogData::setOutputPaths()
-{
-    m_outputPaths.push_back(m_outputDirectory + "/" + m_inputFileName + "_Summary.txt");
-    m_outputPaths.push_back(m_outputDirectory + "/" + m_inputFileName + "_AllEventData.txt");
-    m_outputPaths.push_back(m_outputDirectory + "/" + m_inputFileName + "_UsageOverTime.csv");
-    if (m_fileFormat == ReportLog)
+    if (outputs & ProfileOutput)
     {
-        m_outputPaths.push_back(m_outputDirectory + "/" + m_inputFileName + "_UsageDuration.csv");
-        m_outputPaths.push_back(m_outputDirectory + "/" + m_inputFileName + "_TotalDuration.csv");
+        m_profile.writeJSON(m_outputDirectory + "/" + m_inputFileName + "_Profile.json", m_inputFilePath);
     }
-}
-
 
-void LogData::checkForExistingFiles(std::string& conflictedFileList)
-{
-    for (size_t file=0; file < m_outputPaths.size(); ++file)
+    // Saved last, so a run that fails part way leaves files that don't match the old
+    // checkpoint, and the next run starts over.  Carrying on from the new checkpoint
+    // drops everything the files no longer need from memory.
+    if (readsInParts())
     {
-        if (fileExists(m_outputPaths.at(file)))
-        {
-            conflictedFileList.append(m_outputPaths.at(file));
-            conflictedFileList.append("\n");
-        }
+        Checkpoint checkpoint;
+        saveCheckpoint(checkpoint);
+        restoreCheckpoint(checkpoint);
+        extractEvents();
+        prepareOutputs(m_outputs);
     }
 }
 
 
-void LogData::publishResults()
+void LogData::publishFile(const size_t file, void (LogData::*writeFile)(const std::string&))
 {
-    writeSummaryData(m_outputPaths.at(0));
-
-    write2DVectorToFile(m_outputPaths.at(2), m_usage, ",");
-    if (m_fileFormat == ReportLog)
+    // A cancelled analysis doesn't start any more files, so each file it wrote is whole.
+    // Files that are added to count what they grew by.
+    if (!m_progress)
     {
-        write2DVectorToFile(m_outputPaths.at(3), m_usageDuration, ",");
-        writeTotalDuration(m_outputPaths.at(4));
+        (this->*writeFile)(m_outputPaths.at(file));
+        return;
     }
+    m_progress->checkCancelled();
+    uint64_t sizeBefore = m_resumed ? getFileSize(m_outputPaths.at(file)) : 0;
+    (this->*writeFile)(m_outputPaths.at(file));
+    uint64_t sizeAfter = getFileSize(m_outputPaths.at(file));
+    m_progress->advance((sizeAfter > sizeBefore) ? sizeAfter - sizeBefore : 0, 0);
 }
 
 
 void LogData::publishEventDataResults()
 {
-    write2DVectorToFile(m_outputPaths.at(1), m_eventData, " ");
+    publishResults(EventDataOutput);
 }
-
-
-
@@ -17,10 +17,29 @@
 
 #pragma once
 
+#include <array>
 #include <chrono>
+#include <exception>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <map>
+#include "AnalysisProfile.h"
+#include "AnalysisProgress.h"
+#include "Checkpoint.h"
+#include "ConcurrencyIndex.h"
+#include "DecompressingReader.h"
+#include "EventTable.h"
+#include "MappedFile.h"
+#include "StringTable.h"
+#include "TimestampParser.h"
+#include "UsageAggregator.h"
+
+
+class BufferedWriter;
+struct ChunkYear;
+struct LogChunk;
+struct ParsedEvent;
 
 
 enum fileFormat
@@ -31,78 +50,277 @@ enum fileFormat
 };
 
 
+// Files that can be published, as flags in the order of the output paths
+enum outputFile
+{
+    SummaryOutput = 1 << 0,
+    EventDataOutput = 1 << 1,
+    UsageOverTimeOutput = 1 << 2,
+    UsageDurationOutput = 1 << 3,
+    TotalDurationOutput = 1 << 4,
+    UsageByPeriodOutput = 1 << 5,
+    StandardOutputs = SummaryOutput | UsageOverTimeOutput | UsageDurationOutput | TotalDurationOutput,
+    AllOutputs = StandardOutputs | EventDataOutput | UsageByPeriodOutput,
+
+    // Columnar copies of the events and the usage durations for loading into dataframes.
+    // They're written whole each time, so incremental analyses can't publish them.
+    EventParquetOutput = 1 << 6,
+    DurationParquetOutput = 1 << 7,
+    ParquetOutputs = EventParquetOutput | DurationParquetOutput,
+
+    // Not a file of its own.  Writes the usage over time file as a line for each product
+    // whose usage changed at an event, rather than a column for every product on every row.
+    SparseUsageOverTime = 1 << 16,
+
+    // Not a result of the log.  Measures what each stage of the analysis costs as it runs,
+    // and writes it out as JSON after the results.  It's rewritten each time, and doesn't
+    // count as a conflict with existing files.
+    ProfileOutput = 1 << 17
+};
+
+
+enum analysisMode
+{
+    FullAnalysis,
+    // For logs that are still being written.  A checkpoint beside the output files records
+    // how far the log was read, and when it still matches the log and the files, only the
+    // lines appended since are read and the output files are added to.  Otherwise the log
+    // is read from the start.  A last line without its line break is left for next time.
+    IncrementalAnalysis,
+    // A full analysis that keeps the events it reads in a cache beside the output files.
+    // While the log's path, size, modification time and contents are unchanged, later
+    // runs load the events from there instead of parsing the log again.
+    CachedAnalysis,
+    // For logs too big to analyze in memory at once.  The log is read SegmentSize bytes at
+    // a time, and publishResults() adds each part to the output files as an incremental
+    // analysis would, then drops what they no longer need before reading the next.  What's
+    // kept is the usage and durations by product and user, the open checkouts and the ones
+    // after the oldest of them, and the starts, shutdowns and denials the summary lists,
+    // so memory only grows with those rather than with the whole log.  Outputs are as for
+    // an incremental analysis, queries only cover the part of the log read so far, and
+    // compressed logs are still read whole.
+    SegmentedAnalysis
+};
+
+
+// Current state of a product while following a log
+struct ProductUsage
+{
+    std::string product;
+    int licensesInUse;
+    size_t uniqueUsers;
+    int totalLicenses;      // Report logs only
+};
+
+
 class LogData
 {
     public:
-        LogData(const std::string& inputFilePath, const std::string& outputDirectory);
+        // threadCount of 0 uses every core, but only splits files big enough to benefit.
+        // An incremental analysis must publish the outputs it's given here.  period is
+        // the length of the periods the usage by period file sums up.  progress, if
+        // given, follows the analysis here and in publishResults(), and must outlive it.
+        //
+        // The log is read here, along with what the summary needs.  The usage and the
+        // checkout durations are worked out here too if outputs needs them, and otherwise
+        // the first time an output or a query does.  Usage for SparseUsageOverTime is left
+        // to publishResults(), which writes it out as it goes.
+        LogData(const std::string& inputFilePath,
+                const std::string& outputDirectory,
+                size_t threadCount = 0,
+                analysisMode mode = FullAnalysis,
+                const unsigned int outputs = StandardOutputs,
+                usagePeriod period = PerHour,
+                AnalysisProgress* progress = nullptr);
+
+        // Analyzes the report logs of several license servers as one pool, as if a single
+        // server had served all of their licenses.  Each log must be in time order.  The
+        // results are named after poolName.
+        LogData(const std::vector<std::string>& inputFilePaths,
+                const std::string& poolName,
+                const std::string& outputDirectory,
+                size_t threadCount = 0,
+                const unsigned int outputs = StandardOutputs,
+                usagePeriod period = PerHour,
+                AnalysisProgress* progress = nullptr);
         ~LogData() {}
-        void checkForExistingFiles(std::string& conflictedFiles);
+
+        // Whether the output files are added to rather than written from scratch, which
+        // is also the case after an incremental analysis has published once
+        bool resumed() const;
+
+        // Whether the events were loaded from the cache of a CachedAnalysis
+        bool fromCache() const;
+
+        // Reads whatever has been appended to the log since it was last read, for an
+        // incremental analysis.  Returns false if the log was replaced instead, in which
+        // case a new LogData is needed.  Results are only written by publishResults().
+        bool update();
+        void currentUsage(std::vector<ProductUsage>& usage);
+        // Licenses of product in use at time, in seconds since the epoch like the event
+        // timestamps, and the most and the time-weighted average in use from one time to
+        // another, neither after the other.  The first query indexes the usage of every
+        // product.  Throws UnknownProductException for a product that isn't in the log, and
+        // QueryFormatException for an ISV log, which doesn't give the year of its events.
+        int64_t usageAt(const std::string& product, int64_t time);
+        int64_t peakUsage(const std::string& product, int64_t from, int64_t to);
+        double averageUsage(const std::string& product, int64_t from, int64_t to);
+        size_t denialCount() const;
+        std::string lastEventTime() const;
+
+        // Lists the output files an analysis would write over, one per line, from no more
+        // of the log than it takes to name them.  Nothing is listed for an incremental
+        // analysis that would resume, since it adds to the files its last run wrote.
+        static void findExistingFiles(const std::string& inputFilePath,
+                                      const std::string& outputDirectory,
+                                      std::string& conflictedFiles,
+                                      analysisMode mode = FullAnalysis,
+                                      const unsigned int outputs = StandardOutputs,
+                                      usagePeriod period = PerHour);
+        static void findExistingPoolFiles(const std::string& poolName,
+                                          const std::string& outputDirectory,
+                                          std::string& conflictedFiles,
+                                          const unsigned int outputs = StandardOutputs);
+        void checkForExistingFiles(std::string& conflictedFiles,
+                                   const unsigned int outputs = AllOutputs);
+        // Each file is written by a task of its own, on as many threads as the analysis used.
+        // The sparse usage over time file is written as the usage is worked out, alongside
+        // the other files, so that pass costs no time of its own.  Reading the log still
+        // comes first, since nothing is written before publishResults() is called.
         void publishResults();
+        void publishResults(const unsigned int outputs);
         void publishEventDataResults();
-        size_t fileFormat();
+        size_t fileFormat() const;
+
+        // Only measured when the outputs include ProfileOutput
+        const AnalysisProfile& profile() const;
     private:
+        // Only names the outputs, for findExistingFiles()
+        explicit LogData(usagePeriod period);
+        void initialize(const std::string& outputDirectory,
+                        size_t threadCount,
+                        analysisMode mode,
+                        const unsigned int outputs,
+                        AnalysisProgress* progress);
+        void nameOutputs(const std::string& inputFilePath);
+        void namePoolOutputs(const std::string& poolName);
+        void openInputFile(const std::string& inputFilePath);
         void findFileFormat();
+        bool findFileFormatInLines(std::string_view data);
         void setOutputPaths();
+        bool publishes(const unsigned int outputs, const size_t file) const;
+        bool readsInParts() const;
+        void publishPart(const unsigned int outputs);
+        uint64_t outputSize(const unsigned int outputs) const;
+        void resumeFromCheckpoint();
+        void restoreCheckpoint(Checkpoint& checkpoint);
+        bool checkpointMatches(const Checkpoint& checkpoint);
+        void saveCheckpoint(Checkpoint& checkpoint);
         void extractEvents();
+        void registerEvents(const size_t firstEvent);
+        void prepareOutputs(const unsigned int outputs);
+        bool streamsUsage(const unsigned int outputs) const;
+        void getConcurrentUsage(BufferedWriter* usageChangesWriter = nullptr);
+        void extractCachedEvents();
+        void extractPooledEvents(const std::vector<std::string>& inputFilePaths);
+        void readEvents(EventTable& table);
+        size_t threadsToUse() const;
+        void readCompressedEvents(std::string_view compressed, size_t threadCount, EventTable& table);
+        void readChunks(const std::vector<std::string_view>& chunkData,
+                        bool endOfLog,
+                        size_t threadCount,
+                        size_t& firstRow,
+                        EventTable& table);
+        void parseChunk(LogChunk& chunk, const size_t firstRow);
+        void parseEvent(const size_t row,
+                        const std::vector<std::string_view>& allDataRow,
+                        LogChunk& chunk);
+        void loadChunk(LogChunk& chunk);
+        void registerEvent(const size_t eventRow);
+        uint32_t addIndex(const uint32_t textId, StringTable& list, std::vector<uint32_t>& indices);
+        size_t productIndex(const size_t row) const;
+        size_t userIndex(const size_t row) const;
+        static std::string resolveYear(const ChunkYear& year, const std::string& startYear);
         void getEventIndices();
-        void addYearToDate();
-        void standardizeLogFormatting();
-        void loadEventIntoVector(const std::vector<std::string>& allDataRow,
-                                 const size_t row,
-                                 const std::vector<size_t>& indices);
-        void getConcurrentUsage();
+        void standardizeLogFormatting(const size_t row,
+                                      std::vector<std::string_view>& allDataRow);
+        void loadEventIntoTable(const ParsedEvent& event,
+                                const std::string& year,
+                                EventTable& table,
+                                TimestampParser& timestampParser);
+        size_t eventFieldCount(const size_t row);
+        void writeEventField(BufferedWriter& writer, const size_t row, const size_t field);
+        void writeEventDateTime(BufferedWriter& writer, const size_t row);
+        void resizeConcurrentUsage();
+        void updateConcurrentUsage(const size_t row);
         int getCountOffset(const size_t& row);
-        void gatherConcurrentUsageData(const size_t& row,
-                                       const std::vector<std::string>& licenseUsageCount,
-                                       const std::vector<size_t>& uniqueLicenseCountsByProduct,
-                                       const std::vector<std::string>& maxLicenseUsageCount);
+        size_t reportedLicenseCount(const size_t row, const size_t product);
+        int reportedLicenseTotal(const size_t row, const size_t product);
+        bool checkInFromServer(const size_t row, const size_t user, const size_t product);
+        void shutDownServer(const size_t server);
+        void gatherConcurrentUsageData(const size_t& row);
+        const ConcurrencyIndex& concurrencyIndex(const std::string& product);
         void getUsageDuration();
-        size_t getIndex(const std::string& name, const std::vector<std::string>& list);
+        std::chrono::nanoseconds checkOutDuration(const size_t checkOut);
 
+        void publishFile(const size_t file, void (LogData::*writeFile)(const std::string&));
         void writeSummaryData(const std::string& outputFilePath);
+        void writeEventData(const std::string& outputFilePath);
+        void writeUsageOverTime(const std::string& outputFilePath);
+        void writeUsageHeader(BufferedWriter& writer);
+        void writeUsageChanges(const std::string& outputFilePath);
+        void writeUsageRows(BufferedWriter& writer, const size_t firstRow, const size_t endRow);
+        void padUsageOverTime(const std::string& outputFilePath);
+        void writeUsageDuration(const std::string& outputFilePath);
         void writeTotalDuration(const std::string& outputFilePath);
+        void writeUsageByPeriod(const std::string& outputFilePath);
+        void writeEventParquet(const std::string& outputFilePath);
+        void writeDurationParquet(const std::string& outputFilePath);
 
         // Methods that tweak the ISV log format to look more like the Report log format
-        void reformatEventName(const size_t row,
-                               const std::string newLabel);
+        void reformatEventName(std::vector<std::string_view>& allDataRow,
+                               std::string_view newLabel);
 
-        void reformatUserHost(const size_t row,
+        void reformatUserHost(std::vector<std::string_view>& allDataRow,
                               const std::vector<size_t>& indices);
 
         void reformatProductVersion(const size_t row,
                                     const size_t col,
-                                    std::vector<std::string>& allDataRow);
-
-        void reformatToken(std::vector<std::string>& allDataRow);
+                                    std::vector<std::string_view>& allDataRow);
 
-        void removeInDetails(const size_t row,
-                              std::vector<std::string>& allDataRow);
+        void reformatToken(std::vector<std::string_view>& allDataRow);
 
-        void removeNoGood(const size_t row,
-                          std::vector<std::string>& allDataRow);
+        void removeInDetails(std::vector<std::string_view>& allDataRow);
 
-        void licenseCountAdjust(std::vector<size_t>& licenseCountNumbers,
-                        std::vector<std::string>& licenseCountsByProduct);
+        void removeNoGood(std::vector<std::string_view>& allDataRow);
 
         void checkForValidProductVersion(const size_t row,
                                          const size_t col,
-                                         std::vector<std::string>& allDataRow);
+                                         std::vector<std::string_view>& allDataRow);
 
-        void checkForUnhandledINDetails(const size_t row);
+        void checkForUnhandledINDetails(const size_t row,
+                                        const std::vector<std::string_view>& allDataRow);
 
         std::string m_inputFilePath;
         std::string m_inputFileName;
         std::string m_outputDirectory;
         enum fileFormat m_fileFormat;
         std::vector<std::string> m_outputPaths;
-        std::vector<std::string> m_rawData;
-        std::vector<std::vector<std::string>> m_allData;
-        std::vector<std::vector<std::string>> m_eventData;
-        std::vector<std::vector<std::string>> m_denialEvents;
-        std::vector<std::vector<std::string>> m_shutdownEvents;
-        std::vector<std::vector<std::string>> m_startEvents;
-        std::vector<std::string> m_uniqueProducts;
-        std::vector<std::string> m_uniqueUsers;
+        MappedFile m_inputFile;
+        compressionFormat m_compression;
+        EventTable m_eventData;
+        size_t m_threadCount;
+        analysisMode m_analysisMode;
+        unsigned int m_outputs;
+        std::vector<size_t> m_denialEvents;
+        std::vector<size_t> m_shutdownEvents;
+        std::vector<size_t> m_startEvents;
+        StringTable m_uniqueProducts;
+        StringTable m_uniqueUsers;
+        // Index into m_uniqueProducts and m_uniqueUsers of each text of m_eventData, so the
+        // analyses look up products and users by number instead of by name
+        std::vector<uint32_t> m_productIndices;
+        std::vector<uint32_t> m_userIndices;
 
         std::string m_eventYear;
         std::string m_serverName;
@@ -115,11 +333,94 @@ class LogData
         std::vector<size_t> m_SHUTindices;
         std::vector<size_t> m_PRODUCTindices;
 
-        std::vector<std::vector<std::string>> m_usage;
-        std::vector<std::vector<std::string>> m_usageDuration;
+        // Running state of the concurrent usage calculation, updated one event at a time.
+        // Rows from m_concurrentRows on haven't been counted yet.
+        size_t m_concurrentRows;
+        std::vector<size_t> m_uniqueLicenseCountsByProduct;
+        std::vector<std::vector<size_t>> m_licenseCountByProductAndUser;
+        std::vector<int> m_maxLicenseCountsByProduct;
+        std::vector<size_t> m_licenseCountNumbers;
+
+        // Concurrent usage after each OUT, IN and SHUTDOWN, kept as the products that changed
+        // since the row before.  m_rowUsage is every product's usage as of the last row, and
+        // m_usageBaseline what it was before the first row, so the full rows can be played
+        // back when the file is written.  Products in m_changedProducts may differ from
+        // m_rowUsage, and no others do.
+        struct UsageCounts
+        {
+            size_t inUse;
+            size_t uniqueUsers;
+            int totalLicenses;
+        };
+        struct UsageChange
+        {
+            size_t product;
+            UsageCounts counts;
+        };
+        struct UsageRow
+        {
+            size_t eventRow;
+            size_t firstChange;
+            size_t changeCount;
+        };
+        std::vector<UsageRow> m_usageRows;
+        std::vector<UsageChange> m_usageChanges;
+        std::vector<UsageCounts> m_rowUsage;
+        std::vector<UsageCounts> m_usageBaseline;
+        std::vector<size_t> m_changedProducts;
+
+        // The usage rows indexed by product for queries, once one's been asked for.  Emptied
+        // whenever the rows change.
+        std::vector<ConcurrencyIndex> m_concurrencyIndices;
         std::vector<std::vector<std::chrono::nanoseconds>> m_totalDuration;
 
+        // Pools only.  The log each event came from, and each server's share of the
+        // counts above, so that a server's events only replace its own share.
+        struct ServerUsage
+        {
+            std::vector<size_t> licenseCounts;
+            std::vector<int> maxLicenseCounts;
+            std::map<std::pair<size_t, size_t>, size_t> licenseCountsByUserAndProduct;
+        };
+        std::vector<size_t> m_eventServers;
+        std::vector<ServerUsage> m_serverUsage;
+
+        // Usage summed up by period, from m_periodBaseline, which has everything before
+        // the first usage row.  m_periodState is where the last file written left off.
+        usagePeriod m_usagePeriod;
+        UsageAggregator m_periodBaseline;
+        UsageAggregator m_periodState;
+
         size_t m_endTimeRow;
+
+        // Pairing of checkouts with the checkins that end them, -1 when still open.  Out
+        // of date once events are read, until m_durationCurrent is set again.
+        bool m_durationCurrent;
+        std::vector<size_t> m_checkOutRows;
+        std::vector<int> m_checkInRows;
+
+        // Incremental analysis.  Rows of m_eventData before m_firstNewRow were carried over
+        // from the checkpoint.  Checkouts before m_firstOpenCheckOut are closed, along with
+        // every one before them, so their usage duration rows won't change again.  Their
+        // durations are in m_closedDuration, which starts from m_carriedDuration, the ones
+        // closed before the checkpoint.
+        std::string m_checkpointPath;
+        bool m_resumed;
+        uint64_t m_startOffset;
+        uint64_t m_endOffset;
+        size_t m_lineCount;
+        size_t m_firstNewRow;
+        size_t m_previousProductCount;
+        size_t m_firstOpenCheckOut;
+        uint64_t m_finalDurationSize;
+        uint64_t m_finalPeriodSize;
+
+        bool m_fromCache;
+        std::vector<std::vector<std::chrono::nanoseconds>> m_carriedDuration;
+        std::vector<std::vector<std::chrono::nanoseconds>> m_closedDuration;
+
+        AnalysisProfile m_profile;
+        AnalysisProgress* m_progress;
 };
 
 
@@ -137,6 +438,61 @@ enum eventIndices
 };
 
 
+// Files are split into chunks of at most MaxChunkSize bytes, and when the thread count
+// is picked automatically, of at least MinChunkSize bytes
+const size_t MinChunkSize = 1 << 20;
+const size_t MaxChunkSize = 32 << 20;
+
+// Bytes of the log a SegmentedAnalysis reads at a time
+const size_t SegmentSize = 8 << 20;
+
+// Progress is reported, and cancellation checked for, every this many lines or events
+const size_t ProgressInterval = 4096;
+
+// Compressed logs are parsed as they're decompressed, in chunks of this many bytes
+const size_t StreamChunkSize = 4 << 20;
+
+
+// The year in effect at some point in a chunk of a report log.  Until a chunk reaches a
+// line that names the year, its events count from the year the chunk starts in, which
+// is only known once every chunk before it has been read.
+struct ChunkYear
+{
+    bool known = false;         // Otherwise relative to the year the chunk starts in
+    std::string_view year;      // Last year named in the chunk, if known
+    int increments = 0;         // New Years passed since then
+};
+
+
+// An event as it was read from its line, before its year is resolved.  The fields are
+// views into the mapped file, laid out like eventIndices.
+struct ParsedEvent
+{
+    eventType type;
+    std::array<std::string_view, IndexHandle+1> fields;
+    size_t fieldCount;
+    ChunkYear year;
+};
+
+
+// A newline-aligned piece of the log that's parsed on its own thread
+struct LogChunk
+{
+    std::string_view data;
+    bool last = false;
+    size_t lineCount = 0;
+    std::vector<ParsedEvent> events;
+    ChunkYear endYear;
+    std::string startYear;
+    EventTable table;
+    std::exception_ptr error;
+
+    // Only measured when profiling
+    std::chrono::nanoseconds tokenizeTime{0};
+    std::chrono::nanoseconds normalizeTime{0};
+};
+
+
 
 enum RepOUTEventIndices
 {
@@ -0,0 +1,149 @@
+// Copyright 2014 Steve Robinson
+//
+// This file is part of RLM Log Reader.
+//
+// RLM Log Reader is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// RLM Log Reader is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with RLM Log Reader.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "LogWatcher.h"
+#include "Utilities.h"
+
+#include <thread>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+
+namespace
+{
+    const std::chrono::milliseconds PollInterval(100);
+}
+
+
+LogWatcher::LogWatcher(const std::string& filePath)
+{
+    m_filePath = filePath;
+    std::filesystem::path path(filePath);
+    m_fileName = path.filename().string();
+    m_inotifyDescriptor = -1;
+    m_lastSize = 0;
+
+#ifdef __linux__
+    // Polling is the fallback if inotify isn't available, e.g. when out of watches
+    std::string directory = path.has_parent_path() ? path.parent_path().string() : ".";
+    m_inotifyDescriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_inotifyDescriptor != -1 &&
+        inotify_add_watch(m_inotifyDescriptor, directory.c_str(),
+                          IN_MODIFY | IN_CLOSE_WRITE | IN_CREATE | IN_MOVED_TO | IN_DELETE | IN_MOVED_FROM) == -1)
+    {
+        close(m_inotifyDescriptor);
+        m_inotifyDescriptor = -1;
+    }
+#endif
+
+    fileChanged();
+}
+
+
+LogWatcher::~LogWatcher()
+{
+#ifdef __linux__
+    if (m_inotifyDescriptor != -1)
+    {
+        close(m_inotifyDescriptor);
+    }
+#endif
+}
+
+
+bool LogWatcher::waitForChange(std::chrono::milliseconds timeout)
+{
+    if (m_inotifyDescriptor != -1)
+    {
+        return waitForNotification(timeout);
+    }
+    return pollForChange(timeout);
+}
+
+
+bool LogWatcher::waitForNotification(std::chrono::milliseconds timeout)
+{
+#ifdef __linux__
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    alignas(inotify_event) char buffer[4096];
+
+    while (true)
+    {
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        pollfd descriptor = {m_inotifyDescriptor, POLLIN, 0};
+        if (remaining.count() < 0 || poll(&descriptor, 1, static_cast<int>(remaining.count())) <= 0)
+        {
+            return false;
+        }
+
+        // Other files in the directory change too, so only wake up for this one
+        bool changed = false;
+        ssize_t length;
+        while ((length = read(m_inotifyDescriptor, buffer, sizeof(buffer))) > 0)
+        {
+            for (char* position = buffer; position < buffer + length; )
+            {
+                const inotify_event* event = reinterpret_cast<const inotify_event*>(position);
+                if (event->len > 0 && m_fileName == event->name)
+                {
+                    changed = true;
+                }
+                position += sizeof(inotify_event) + event->len;
+            }
+        }
+        if (changed)
+        {
+            fileChanged();
+            return true;
+        }
+    }
+#else
+    return pollForChange(timeout);
+#endif
+}
+
+
+bool LogWatcher::pollForChange(std::chrono::milliseconds timeout)
+{
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (!fileChanged())
+    {
+        if (std::chrono::steady_clock::now() >= deadline)
+        {
+            return false;
+        }
+        std::this_thread::sleep_for(PollInterval);
+    }
+    return true;
+}
+
+
+bool LogWatcher::fileChanged()
+{
+    std::error_code error;
+    uint64_t size = getFileSize(m_filePath);
+    std::filesystem::file_time_type writeTime = std::filesystem::last_write_time(m_filePath, error);
+
+    bool changed = (size != m_lastSize || writeTime != m_lastWriteTime);
+    m_lastSize = size;
+    m_lastWriteTime = writeTime;
+    return changed;
+}
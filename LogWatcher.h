@@ -0,0 +1,49 @@
+// Copyright 2014 Steve Robinson
+//
+// This file is part of RLM Log Reader.
+//
+// RLM Log Reader is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// RLM Log Reader is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with RLM Log Reader.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+
+// Waits for a log file to be written to.  On Linux the log's directory is watched with
+// inotify, so a log that's rotated (renamed away and created again) is still noticed.
+// Elsewhere the file's size and modification time are polled.
+class LogWatcher
+{
+    public:
+        explicit LogWatcher(const std::string& filePath);
+        ~LogWatcher();
+        LogWatcher(const LogWatcher&) = delete;
+        LogWatcher& operator=(const LogWatcher&) = delete;
+
+        // Returns true as soon as the file may have changed, or false after timeout
+        bool waitForChange(std::chrono::milliseconds timeout);
+    private:
+        bool waitForNotification(std::chrono::milliseconds timeout);
+        bool pollForChange(std::chrono::milliseconds timeout);
+        bool fileChanged();
+
+        std::string m_filePath;
+        std::string m_fileName;
+        int m_inotifyDescriptor;
+        uint64_t m_lastSize;
+        std::filesystem::file_time_type m_lastWriteTime;
+};
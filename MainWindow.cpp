@@ -23,6 +23,7 @@
 #include "MainWindowConfig.h"
 #include "Exceptions.h"
 
+#include <algorithm>
 #include <iostream>
 #include <string>
 
@@ -31,10 +32,29 @@
 #include <QDebug>
 
 
+WindowProgress::WindowProgress(MainWindow* window)
+    : m_window(window)
+{
+}
+
+
+void WindowProgress::progressed(const StageProgress& progress)
+{
+    // Called on the worker thread, so the window is updated from its own event loop
+    MainWindow* window = m_window;
+    QMetaObject::invokeMethod(window, [window, progress]()
+    {
+        window->showProgress(progress);
+    }, Qt::QueuedConnection);
+}
+
+
 MainWindow::MainWindow(QMainWindow* parent)
-    : QMainWindow(parent)
+    : QMainWindow(parent),
+      m_worker(nullptr)
 {
     ui.setupUi(this);
+    setRunning(false);
 
     const std::string windowTitle = appTitle + " " + versionMajor + "." + versionMinor + "." + versionPatch;
     QWidget::setWindowTitle(windowTitle.c_str());
@@ -42,12 +62,34 @@ MainWindow::MainWindow(QMainWindow* parent)
     connect( this->ui.openButton, SIGNAL( clicked() ), this, SLOT(openButtonClicked()) );
     connect( this->ui.saveButton, SIGNAL( clicked() ), this, SLOT(saveButtonClicked()) );
     connect( this->ui.generateButton, SIGNAL( clicked() ), this, SLOT(generateButtonClicked()) );
+    connect( this->ui.cancelButton, SIGNAL( clicked() ), this, SLOT(cancelButtonClicked()) );
 
     QString settingsPath = QStandardPaths::writableLocation(QStandardPaths::GenericDataLocation);
     m_settingsFile = settingsPath + "/" + appTitleNoSpaces.c_str() + ".ini";
     qDebug() << "Settings filepath: " << m_settingsFile;
 }
 
+MainWindow::~MainWindow()
+{
+    if (m_worker)
+    {
+        m_progress->cancel();
+        m_worker->wait();
+        delete m_worker;
+    }
+}
+
+void MainWindow::closeEvent(QCloseEvent* event)
+{
+    // Parsing stops within milliseconds of being cancelled, so the window can wait for it
+    if (m_worker)
+    {
+        m_progress->cancel();
+        m_worker->wait();
+    }
+    QMainWindow::closeEvent(event);
+}
+
 void MainWindow::loadSettings()
 {
     QSettings settings(m_settingsFile, QSettings::IniFormat);
@@ -68,7 +110,7 @@ void MainWindow::openButtonClicked()
 
     // Get path to the log file
     QString path = QFileDialog::getOpenFileName(this,
-        tr("Open RLM report or ISV log file"), m_inputFilePath, tr("Log Files (*.log *.txt);;All Files (*.*)"));
+        tr("Open RLM report or ISV log file"), m_inputFilePath, tr("Log Files (*.log *.txt *.gz *.zst);;All Files (*.*)"));
  
     if (! path.isNull())
     {
@@ -106,59 +148,192 @@ void MainWindow::generateButtonClicked()
     std::string inputFilePathString = m_inputFilePath.toStdString();
     std::string outputDirectoryString = m_outputDirectory.toStdString();
 
-    bool filesPublished = false;
-    
-    this->setCursor(Qt::WaitCursor);
+    QDir path = m_outputDirectory;
+    if(!path.exists() || outputDirectoryString.empty())
+    {
+        CannotFindDirException cannotFindDirException(outputDirectoryString);
+        showError(cannotFindDirException.what());
+        return;
+    }
+
+    // The log is analyzed before asking about overwriting, since what's published depends
+    // on what kind of log it is
+    m_progress = std::make_unique<WindowProgress>(this);
+    WindowProgress* progress = m_progress.get();
+    runInBackground([this, inputFilePathString, outputDirectoryString, progress]()
+    {
+        m_logData = std::make_unique<LogData>(inputFilePathString, outputDirectoryString, 0,
+                                              FullAnalysis, StandardOutputs, PerHour, progress);
+    },
+    [this]()
+    {
+        analysisFinished();
+    });
+}
+
+void MainWindow::analysisFinished()
+{
+    std::string conflictedFileList;
     try
     {
-        QDir path = m_outputDirectory;
+        m_logData->checkForExistingFiles(conflictedFileList);
+    }
+    catch (std::exception& e)
+    {
+        m_logData.reset();
+        showError(e.what());
+        return;
+    }
+
+    if (! conflictedFileList.empty())
+    {
+        std::string overwriteQuestion = "Do you wish to overwrite the following files?\n\n";
+        overwriteQuestion.append(conflictedFileList);
+
+        QMessageBox messageBox;
+        messageBox.setWindowTitle("Overwrite?");
+        messageBox.setText(QDir::toNativeSeparators(QString(overwriteQuestion.c_str())));
+        messageBox.setStandardButtons(QMessageBox::Yes|QMessageBox::No);
+        messageBox.setDefaultButton(QMessageBox::No);
 
-        if(!path.exists() || outputDirectoryString.empty())
+        if (messageBox.exec() != QMessageBox::Yes)
         {
-            CannotFindDirException cannotFindDirException(outputDirectoryString);
-            throw cannotFindDirException;
+            m_logData.reset();
+            ui.progressLabel->clear();
+            return;
         }
+    }
 
-        LogData logData(inputFilePathString, outputDirectoryString);
+    runInBackground([this]()
+    {
+        m_logData->publishResults();
+    },
+    [this]()
+    {
+        publishFinished();
+    });
+}
 
-        std::string conflictedFileList;
-        logData.checkForExistingFiles(conflictedFileList);
+void MainWindow::publishFinished()
+{
+    m_logData.reset();
+    ui.progressLabel->setText("Done");
+    QDesktopServices::openUrl(QUrl("file:///" + m_outputDirectory));
+}
+
+void MainWindow::cancelButtonClicked()
+{
+    if (m_worker)
+    {
+        m_progress->cancel();
+        ui.cancelButton->setEnabled(false);
+        ui.progressLabel->setText("Cancelling...");
+    }
+}
 
-        if (! conflictedFileList.empty())
+void MainWindow::runInBackground(std::function<void()> task, std::function<void()> finished)
+{
+    setRunning(true);
+    m_workerError = nullptr;
+    m_worker = QThread::create([this, task]()
+    {
+        try
         {
-            std::string overwriteQuestion = "Do you wish to overwrite the following files?\n\n";
-            overwriteQuestion.append(conflictedFileList);
-
-            QMessageBox messageBox;
-            messageBox.setWindowTitle("Overwrite?");
-            messageBox.setText(QDir::toNativeSeparators(QString(overwriteQuestion.c_str())));
-            messageBox.setStandardButtons(QMessageBox::Yes|QMessageBox::No);
-            messageBox.setDefaultButton(QMessageBox::No);
-
-            if (messageBox.exec() == QMessageBox::Yes)
-            {
-                logData.publishResults();
-                filesPublished = true;
-            }
+            task();
         }
-        else
+        catch (...)
         {
-            logData.publishResults();
-            filesPublished = true;
+            m_workerError = std::current_exception();
         }
-        
-        if (filesPublished)
+    });
+
+    // Queued to the GUI thread, since the window is this thread's context
+    QThread* worker = m_worker;
+    connect(worker, &QThread::finished, this, [this, worker, finished]()
+    {
+        worker->deleteLater();
+        m_worker = nullptr;
+        setRunning(false);
+        if (! m_workerError)
         {
-            QDesktopServices::openUrl(QUrl("file:///" + m_outputDirectory));
+            finished();
+            return;
         }
+
+        m_logData.reset();
+        try
+        {
+            std::rethrow_exception(m_workerError);
+        }
+        catch (AnalysisCancelledException&)
+        {
+            ui.progressLabel->setText("Cancelled");
+        }
+        catch (std::exception& e)
+        {
+            ui.progressLabel->clear();
+            showError(e.what());
+        }
+    });
+    worker->start();
+}
+
+void MainWindow::showProgress(const StageProgress& progress)
+{
+    static const char* descriptions[StageCount] = {"Opening the log", "Finding the log format",
+                                                   "Tokenizing", "Normalizing", "Reading events",
+                                                   "Working out concurrent usage",
+                                                   "Working out usage durations",
+                                                   "Writing the results"};
+    if (! m_worker || m_progress->cancelled())
+    {
+        return;
     }
-    catch (std::exception& e)
+
+    // Bytes where the stage knows how many there are, events otherwise, and a busy
+    // indicator when it knows neither
+    uint64_t done = progress.totalBytes ? progress.bytes : progress.events;
+    uint64_t total = progress.totalBytes ? progress.totalBytes : progress.totalEvents;
+    if (total == 0)
     {
-        QMessageBox messageBox;
-        messageBox.setIcon(QMessageBox::Critical);
-        messageBox.setWindowTitle("Error");
-        messageBox.setText(e.what());
-        messageBox.exec();
+        ui.progressBar->setRange(0, 0);
+    }
+    else
+    {
+        ui.progressBar->setRange(0, 1000);
+        ui.progressBar->setValue(static_cast<int>(std::min(done, total) * 1000 / total));
     }
-    this->setCursor(Qt::ArrowCursor);
+
+    QString text = descriptions[progress.stage];
+    if (progress.bytes > 0)
+    {
+        text += QString(", %1 MB").arg(progress.bytes / double(1 << 20), 0, 'f', 1);
+    }
+    if (progress.events > 0)
+    {
+        text += QString(", %1 events").arg(progress.events);
+    }
+    ui.progressLabel->setText(text);
+}
+
+void MainWindow::setRunning(bool running)
+{
+    ui.generateButton->setEnabled(! running);
+    ui.openButton->setEnabled(! running);
+    ui.saveButton->setEnabled(! running);
+    ui.inputTextField->setEnabled(! running);
+    ui.outputTextField->setEnabled(! running);
+    ui.cancelButton->setEnabled(running);
+    ui.progressBar->setRange(0, 1000);
+    ui.progressBar->setValue(0);
+    ui.progressBar->setVisible(running);
+}
+
+void MainWindow::showError(const char* error)
+{
+    QMessageBox messageBox;
+    messageBox.setIcon(QMessageBox::Critical);
+    messageBox.setWindowTitle("Error");
+    messageBox.setText(error);
+    messageBox.exec();
 }
@@ -18,7 +18,29 @@
 #pragma once
 
 #include <QMainWindow>
+#include <QThread>
 #include "ui_MainWindow.h"
+#include "AnalysisProgress.h"
+
+#include <exception>
+#include <functional>
+#include <memory>
+
+class LogData;
+class MainWindow;
+
+
+// Passes the progress of an analysis running on the worker thread over to the window
+class WindowProgress : public AnalysisProgress
+{
+    public:
+        WindowProgress(MainWindow* window);
+    protected:
+        void progressed(const StageProgress& progress) override;
+    private:
+        MainWindow* m_window;
+};
+
 
 class MainWindow : public QMainWindow
 {
@@ -26,19 +48,40 @@ class MainWindow : public QMainWindow
 
 public:
     MainWindow(QMainWindow *parent = 0);
+    ~MainWindow();
+
+    void showProgress(const StageProgress& progress);
+
+protected:
+    void closeEvent(QCloseEvent* event) override;
 
 private slots:
     void openButtonClicked();
     void saveButtonClicked();
     void generateButtonClicked();
+    void cancelButtonClicked();
 
 private:
     void loadSettings();
     void saveSettings();
 
+    // Runs task on the worker thread while the window shows its progress, then runs
+    // finished back on the GUI thread if it succeeded
+    void runInBackground(std::function<void()> task, std::function<void()> finished);
+    void analysisFinished();
+    void publishFinished();
+    void setRunning(bool running);
+    void showError(const char* error);
+
     Ui::RLMLogReader ui;
 
     QString m_settingsFile;
     QString m_inputFilePath;
     QString m_outputDirectory;
+
+    // The analysis is only touched by the worker thread while it's running
+    std::unique_ptr<WindowProgress> m_progress;
+    std::unique_ptr<LogData> m_logData;
+    QThread* m_worker;
+    std::exception_ptr m_workerError;
 };
@@ -0,0 +1,189 @@
+// Copyright 2014 Steve Robinson
+//
+// This file is part of RLM Log Reader.
+//
+// RLM Log Reader is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// RLM Log Reader is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with RLM Log Reader.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "MappedFile.h"
+#include "Exceptions.h"
+
+#include <algorithm>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+MappedFile::MappedFile()
+    : m_data(nullptr),
+      m_size(0),
+#ifdef _WIN32
+      m_fileHandle(INVALID_HANDLE_VALUE),
+      m_mappingHandle(nullptr)
+#else
+      m_fileDescriptor(-1)
+#endif
+{
+}
+
+
+MappedFile::MappedFile(const std::string& filePath)
+    : MappedFile()
+{
+    open(filePath);
+}
+
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+
+void MappedFile::open(const std::string& filePath)
+{
+    close();
+
+#ifdef _WIN32
+    m_fileHandle = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                               nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    LARGE_INTEGER fileSize;
+    if (m_fileHandle == INVALID_HANDLE_VALUE || !GetFileSizeEx(m_fileHandle, &fileSize))
+    {
+        close();
+        CannotOpenFileException cannotOpenFileException(filePath);
+        throw cannotOpenFileException;
+    }
+    m_size = static_cast<size_t>(fileSize.QuadPart);
+
+    // Zero-length files can't be mapped, but they're still valid (empty) input
+    if (m_size > 0)
+    {
+        m_mappingHandle = CreateFileMappingA(m_fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (m_mappingHandle != nullptr)
+        {
+            m_data = static_cast<const char*>(MapViewOfFile(m_mappingHandle, FILE_MAP_READ, 0, 0, 0));
+        }
+        if (m_data == nullptr)
+        {
+            close();
+            CannotOpenFileException cannotOpenFileException(filePath);
+            throw cannotOpenFileException;
+        }
+    }
+#else
+    struct stat fileStatus;
+    m_fileDescriptor = ::open(filePath.c_str(), O_RDONLY);
+    if (m_fileDescriptor == -1 || fstat(m_fileDescriptor, &fileStatus) != 0 || S_ISDIR(fileStatus.st_mode))
+    {
+        close();
+        CannotOpenFileException cannotOpenFileException(filePath);
+        throw cannotOpenFileException;
+    }
+    m_size = static_cast<size_t>(fileStatus.st_size);
+
+    // Zero-length files can't be mapped, but they're still valid (empty) input
+    if (m_size > 0)
+    {
+        void* mapping = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_fileDescriptor, 0);
+        if (mapping == MAP_FAILED)
+        {
+            close();
+            CannotOpenFileException cannotOpenFileException(filePath);
+            throw cannotOpenFileException;
+        }
+        m_data = static_cast<const char*>(mapping);
+
+        // The log is scanned front to back exactly once, so let the kernel read ahead aggressively
+        madvise(mapping, m_size, MADV_SEQUENTIAL);
+    }
+#endif
+}
+
+
+void MappedFile::close()
+{
+#ifdef _WIN32
+    if (m_data != nullptr)
+    {
+        UnmapViewOfFile(m_data);
+    }
+    if (m_mappingHandle != nullptr)
+    {
+        CloseHandle(m_mappingHandle);
+        m_mappingHandle = nullptr;
+    }
+    if (m_fileHandle != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(m_fileHandle);
+        m_fileHandle = INVALID_HANDLE_VALUE;
+    }
+#else
+    if (m_data != nullptr)
+    {
+        munmap(const_cast<char*>(m_data), m_size);
+    }
+    if (m_fileDescriptor != -1)
+    {
+        ::close(m_fileDescriptor);
+        m_fileDescriptor = -1;
+    }
+#endif
+    m_data = nullptr;
+    m_size = 0;
+}
+
+
+std::string_view MappedFile::data() const
+{
+    return std::string_view(m_data, m_size);
+}
+
+
+size_t MappedFile::size() const
+{
+    return m_size;
+}
+
+
+void MappedFile::release(const size_t offset)
+{
+    if (m_data == nullptr)
+    {
+        return;
+    }
+#ifdef _WIN32
+    // Unlocking pages that aren't locked takes them out of the working set
+    SYSTEM_INFO systemInfo;
+    GetSystemInfo(&systemInfo);
+    size_t length = std::min(offset, m_size) / systemInfo.dwPageSize * systemInfo.dwPageSize;
+    if (length > 0)
+    {
+        VirtualUnlock(const_cast<char*>(m_data), length);
+    }
+#else
+    size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t length = std::min(offset, m_size) / pageSize * pageSize;
+    if (length > 0)
+    {
+        madvise(const_cast<char*>(m_data), length, MADV_DONTNEED);
+    }
+#endif
+}
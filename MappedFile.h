@@ -0,0 +1,51 @@
+// Copyright 2014 Steve Robinson
+//
+// This file is part of RLM Log Reader.
+//
+// RLM Log Reader is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// RLM Log Reader is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with RLM Log Reader.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <string>
+#include <string_view>
+
+
+// Read-only memory mapping of a whole file.  The contents stay valid until the
+// object is closed or destroyed, so string_views into data() must not outlive it.
+class MappedFile
+{
+    public:
+        MappedFile();
+        explicit MappedFile(const std::string& filePath);
+        ~MappedFile();
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        void open(const std::string& filePath);
+        void close();
+        std::string_view data() const;
+        size_t size() const;
+        // Hands back the memory for the pages before offset.  They're read from the file
+        // again if they're touched, so data() stays valid.
+        void release(const size_t offset);
+    private:
+        const char* m_data;
+        size_t m_size;
+#ifdef _WIN32
+        void* m_fileHandle;
+        void* m_mappingHandle;
+#else
+        int m_fileDescriptor;
+#endif
+};
@@ -0,0 +1,567 @@
+// Copyright 2014 Steve Robinson
+//
+// This file is part of RLM Log Reader.
+//
+// RLM Log Reader is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// RLM Log Reader is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with RLM Log Reader.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "ParquetWriter.h"
+#include "Exceptions.h"
+
+#include <algorithm>
+#include <zlib.h>
+
+
+namespace
+{
+    // Values from parquet.thrift
+    const int32_t TypeInt32 = 1;
+    const int32_t TypeInt64 = 2;
+    const int32_t TypeByteArray = 6;
+    const int32_t RepetitionRequired = 0;
+    const int32_t RepetitionOptional = 1;
+    const int32_t ConvertedUTF8 = 0;
+    const int32_t EncodingPlain = 0;
+    const int32_t EncodingRLE = 3;
+    const int32_t EncodingRLEDictionary = 8;
+    const int32_t CodecGzip = 2;
+    const int32_t PageData = 0;
+    const int32_t PageDictionary = 2;
+
+    const uint32_t NotInDictionary = UINT32_MAX;
+
+    // Type ids of the Thrift compact protocol
+    const uint8_t ThriftTrue = 1;
+    const uint8_t ThriftFalse = 2;
+    const uint8_t ThriftI32 = 5;
+    const uint8_t ThriftI64 = 6;
+    const uint8_t ThriftBinary = 8;
+    const uint8_t ThriftList = 9;
+    const uint8_t ThriftStruct = 12;
+
+
+    void appendLittleEndian(std::string& bytes, uint64_t value, int size)
+    {
+        for (int byte = 0; byte < size; ++byte)
+        {
+            bytes.push_back(static_cast<char>((value >> (8 * byte)) & 0xFF));
+        }
+    }
+
+
+    void appendVarint(std::string& bytes, uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            bytes.push_back(static_cast<char>((value & 0x7F) | 0x80));
+            value >>= 7;
+        }
+        bytes.push_back(static_cast<char>(value));
+    }
+
+
+    // Page headers and the footer are Thrift structs in the compact protocol.  Fields have
+    // to be written in increasing order within each struct.
+    class ThriftWriter
+    {
+        public:
+            ThriftWriter() : m_lastField(1, 0) {}
+
+            void i32(int16_t field, int32_t value)
+            {
+                fieldHeader(field, ThriftI32);
+                appendVarint(bytes, (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31));
+            }
+
+            void i64(int16_t field, int64_t value)
+            {
+                fieldHeader(field, ThriftI64);
+                appendVarint(bytes, (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+            }
+
+            void binary(int16_t field, std::string_view value)
+            {
+                fieldHeader(field, ThriftBinary);
+                listBinary(value);
+            }
+
+            void boolean(int16_t field, bool value)
+            {
+                fieldHeader(field, value ? ThriftTrue : ThriftFalse);
+            }
+
+            void beginStruct(int16_t field)
+            {
+                fieldHeader(field, ThriftStruct);
+                m_lastField.push_back(0);
+            }
+
+            // Also ends the outermost struct, and each struct in a list
+            void endStruct()
+            {
+                bytes.push_back(0);
+                m_lastField.pop_back();
+            }
+
+            void beginList(int16_t field, uint8_t elementType, size_t size)
+            {
+                fieldHeader(field, ThriftList);
+                if (size < 15)
+                {
+                    bytes.push_back(static_cast<char>((size << 4) | elementType));
+                }
+                else
+                {
+                    bytes.push_back(static_cast<char>(0xF0 | elementType));
+                    appendVarint(bytes, size);
+                }
+            }
+
+            void listI32(int32_t value)
+            {
+                appendVarint(bytes, (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31));
+            }
+
+            void listBinary(std::string_view value)
+            {
+                appendVarint(bytes, value.size());
+                bytes.append(value);
+            }
+
+            void beginListStruct()
+            {
+                m_lastField.push_back(0);
+            }
+
+            std::string bytes;
+        private:
+            void fieldHeader(int16_t field, uint8_t type)
+            {
+                int delta = field - m_lastField.back();
+                if (delta > 0 && delta <= 15)
+                {
+                    bytes.push_back(static_cast<char>((delta << 4) | type));
+                }
+                else
+                {
+                    bytes.push_back(static_cast<char>(type));
+                    appendVarint(bytes, (static_cast<uint32_t>(field) << 1) ^ static_cast<uint32_t>(field >> 15));
+                }
+                m_lastField.back() = field;
+            }
+
+            std::vector<int16_t> m_lastField;
+    };
+
+
+    size_t repeatCount(const uint32_t* values, size_t start, size_t count)
+    {
+        size_t end = start + 1;
+        while (end < count && values[end] == values[start])
+        {
+            ++end;
+        }
+        return end - start;
+    }
+
+
+    // Parquet's RLE/bit-packing hybrid, used for definition levels and dictionary indices.
+    // Runs of at least 8 equal values are run-length encoded and everything between them
+    // is bit-packed, 8 values at a time.  Only the last group is padded.
+    void appendHybrid(std::string& bytes, const std::vector<uint32_t>& values, int bitWidth)
+    {
+        const size_t minimumRun = 8;
+        const size_t count = values.size();
+        size_t position = 0;
+        while (position < count)
+        {
+            size_t run = repeatCount(values.data(), position, count);
+            if (run >= minimumRun)
+            {
+                appendVarint(bytes, run << 1);
+                appendLittleEndian(bytes, values[position], (bitWidth + 7) / 8);
+                position += run;
+                continue;
+            }
+
+            size_t start = position;
+            do
+            {
+                position += minimumRun;
+            }
+            while (position < count && repeatCount(values.data(), position, count) < minimumRun);
+
+            appendVarint(bytes, (((position - start) / minimumRun) << 1) | 1);
+            uint64_t buffer = 0;
+            int bufferedBits = 0;
+            for (size_t value = start; value < position; ++value)
+            {
+                buffer |= static_cast<uint64_t>(value < count ? values[value] : 0) << bufferedBits;
+                bufferedBits += bitWidth;
+                while (bufferedBits >= 8)
+                {
+                    bytes.push_back(static_cast<char>(buffer & 0xFF));
+                    buffer >>= 8;
+                    bufferedBits -= 8;
+                }
+            }
+            position = std::min(position, count);
+        }
+    }
+
+
+    // The fastest level, since dictionary indices and levels are already small and the
+    // better levels only save a few percent more
+    std::string gzipCompress(const std::string& data, const std::string& filePath)
+    {
+        z_stream stream = {};
+        const int gzipWindowBits = 15 + 16;
+        if (deflateInit2(&stream, Z_BEST_SPEED, Z_DEFLATED, gzipWindowBits,
+                         8, Z_DEFAULT_STRATEGY) != Z_OK)
+        {
+            CannotOpenFileException cannotOpenFileException(filePath);
+            throw cannotOpenFileException;
+        }
+
+        std::string compressed(deflateBound(&stream, static_cast<uLong>(data.size())), '\0');
+        stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+        stream.avail_in = static_cast<uInt>(data.size());
+        stream.next_out = reinterpret_cast<Bytef*>(&compressed[0]);
+        stream.avail_out = static_cast<uInt>(compressed.size());
+        int result = deflate(&stream, Z_FINISH);
+        compressed.resize(stream.total_out);
+        deflateEnd(&stream);
+        if (result != Z_STREAM_END)
+        {
+            CannotOpenFileException cannotOpenFileException(filePath);
+            throw cannotOpenFileException;
+        }
+        return compressed;
+    }
+
+
+    std::string pageHeader(int32_t type, size_t valueCount, int32_t encoding,
+                           const std::string& uncompressed, const std::string& compressed)
+    {
+        ThriftWriter header;
+        header.i32(1, type);
+        header.i32(2, static_cast<int32_t>(uncompressed.size()));
+        header.i32(3, static_cast<int32_t>(compressed.size()));
+        if (type == PageDictionary)
+        {
+            header.beginStruct(7);
+            header.i32(1, static_cast<int32_t>(valueCount));
+            header.i32(2, encoding);
+        }
+        else
+        {
+            header.beginStruct(5);
+            header.i32(1, static_cast<int32_t>(valueCount));
+            header.i32(2, encoding);
+            header.i32(3, EncodingRLE);
+            header.i32(4, EncodingRLE);
+        }
+        header.endStruct();
+        header.endStruct();
+        return header.bytes;
+    }
+
+
+    int32_t physicalType(parquetType type)
+    {
+        switch (type)
+        {
+            case ParquetInt32:
+                return TypeInt32;
+            case ParquetInt64:
+            case ParquetTimestamp:
+                return TypeInt64;
+            case ParquetString:
+                return TypeByteArray;
+        }
+        return TypeByteArray;
+    }
+}
+
+
+ParquetWriter::ParquetWriter(const std::string& filePath,
+                             const std::vector<ParquetColumn>& columns,
+                             size_t rowGroupSize)
+    : m_filePath(filePath),
+      m_writer(filePath, false, true),
+      m_columns(columns),
+      m_values(columns.size()),
+      m_rowGroupSize(rowGroupSize),
+      m_rowCount(0),
+      m_totalRowCount(0),
+      m_offset(0)
+{
+    m_writer.write("PAR1");
+    m_offset = 4;
+}
+
+
+void ParquetWriter::addNull(size_t column)
+{
+    m_values.at(column).present.push_back(0);
+}
+
+
+void ParquetWriter::addNumber(size_t column, int64_t number)
+{
+    ColumnValues& values = m_values.at(column);
+    if (m_columns.at(column).optional)
+    {
+        values.present.push_back(1);
+    }
+    const int64_t millisecondsPerSecond = 1000;
+    values.numbers.push_back(m_columns.at(column).type == ParquetTimestamp ? number * millisecondsPerSecond : number);
+}
+
+
+void ParquetWriter::addString(size_t column, uint32_t id, std::string_view text)
+{
+    ColumnValues& values = m_values.at(column);
+    if (m_columns.at(column).optional)
+    {
+        values.present.push_back(1);
+    }
+
+    if (id >= values.dictionaryIndices.size())
+    {
+        values.dictionaryIndices.resize(id + 1, NotInDictionary);
+    }
+    uint32_t& index = values.dictionaryIndices[id];
+    if (index == NotInDictionary)
+    {
+        index = static_cast<uint32_t>(values.dictionary.size());
+        values.dictionary.emplace_back(text);
+        values.dictionaryIds.push_back(id);
+    }
+    values.indices.push_back(index);
+}
+
+
+void ParquetWriter::endRow()
+{
+    ++m_rowCount;
+    if (m_rowCount == m_rowGroupSize)
+    {
+        writeRowGroup();
+    }
+}
+
+
+void ParquetWriter::close()
+{
+    writeRowGroup();
+    writeFooter();
+    m_writer.close();
+}
+
+
+void ParquetWriter::writeRowGroup()
+{
+    if (m_rowCount == 0)
+    {
+        return;
+    }
+
+    RowGroup rowGroup;
+    rowGroup.rowCount = m_rowCount;
+    for (size_t column = 0; column < m_columns.size(); ++column)
+    {
+        rowGroup.columns.push_back(writeColumnChunk(column));
+
+        ColumnValues& values = m_values.at(column);
+        values.present.clear();
+        values.numbers.clear();
+        values.indices.clear();
+        for (uint32_t id : values.dictionaryIds)
+        {
+            values.dictionaryIndices[id] = NotInDictionary;
+        }
+        values.dictionaryIds.clear();
+        values.dictionary.clear();
+    }
+    m_rowGroups.push_back(rowGroup);
+    m_totalRowCount += m_rowCount;
+    m_rowCount = 0;
+}
+
+
+ParquetWriter::ColumnChunk ParquetWriter::writeColumnChunk(size_t column)
+{
+    const ParquetColumn& definition = m_columns.at(column);
+    const ColumnValues& values = m_values.at(column);
+    ColumnChunk chunk = {0, 0, 0, 0, m_rowCount};
+    uint64_t start = m_offset;
+
+    // Definition levels come first in a data page, 1 for a value and 0 for a null
+    std::string page;
+    if (definition.optional)
+    {
+        std::string levels;
+        appendHybrid(levels, values.present, 1);
+        appendLittleEndian(page, levels.size(), 4);
+        page.append(levels);
+    }
+
+    int32_t encoding = EncodingPlain;
+    if (definition.type == ParquetString && !values.dictionary.empty())
+    {
+        std::string dictionary;
+        for (const std::string& text : values.dictionary)
+        {
+            appendLittleEndian(dictionary, text.size(), 4);
+            dictionary.append(text);
+        }
+        std::string compressed = gzipCompress(dictionary, m_filePath);
+        std::string header = pageHeader(PageDictionary, values.dictionary.size(), EncodingPlain, dictionary, compressed);
+        chunk.dictionaryPageOffset = m_offset;
+        chunk.uncompressedSize += header.size() + dictionary.size();
+        writePage(header, compressed);
+
+        int bitWidth = 1;
+        while ((size_t(1) << bitWidth) < values.dictionary.size())
+        {
+            ++bitWidth;
+        }
+        page.push_back(static_cast<char>(bitWidth));
+        appendHybrid(page, values.indices, bitWidth);
+        encoding = EncodingRLEDictionary;
+    }
+    else if (definition.type != ParquetString)
+    {
+        int size = definition.type == ParquetInt32 ? 4 : 8;
+        page.reserve(page.size() + values.numbers.size() * size);
+        for (int64_t number : values.numbers)
+        {
+            appendLittleEndian(page, static_cast<uint64_t>(number), size);
+        }
+    }
+
+    std::string compressed = gzipCompress(page, m_filePath);
+    std::string header = pageHeader(PageData, m_rowCount, encoding, page, compressed);
+    chunk.dataPageOffset = m_offset;
+    chunk.uncompressedSize += header.size() + page.size();
+    writePage(header, compressed);
+
+    chunk.compressedSize = m_offset - start;
+    return chunk;
+}
+
+
+void ParquetWriter::writePage(const std::string& header, const std::string& compressed)
+{
+    m_writer.write(header);
+    m_writer.write(compressed);
+    m_offset += header.size() + compressed.size();
+}
+
+
+void ParquetWriter::writeFooter()
+{
+    ThriftWriter footer;
+    footer.i32(1, 1);
+
+    // A root with every column under it
+    footer.beginList(2, ThriftStruct, m_columns.size() + 1);
+    footer.beginListStruct();
+    footer.binary(4, "schema");
+    footer.i32(5, static_cast<int32_t>(m_columns.size()));
+    footer.endStruct();
+    for (const ParquetColumn& column : m_columns)
+    {
+        footer.beginListStruct();
+        footer.i32(1, physicalType(column.type));
+        footer.i32(3, column.optional ? RepetitionOptional : RepetitionRequired);
+        footer.binary(4, column.name);
+        if (column.type == ParquetString)
+        {
+            footer.i32(6, ConvertedUTF8);
+            footer.beginStruct(10);
+            footer.beginStruct(1);
+            footer.endStruct();
+            footer.endStruct();
+        }
+        else if (column.type == ParquetTimestamp)
+        {
+            // Log times are local, so not adjusted to UTC
+            footer.beginStruct(10);
+            footer.beginStruct(8);
+            footer.boolean(1, false);
+            footer.beginStruct(2);
+            footer.beginStruct(1);
+            footer.endStruct();
+            footer.endStruct();
+            footer.endStruct();
+            footer.endStruct();
+        }
+        footer.endStruct();
+    }
+
+    footer.i64(3, static_cast<int64_t>(m_totalRowCount));
+
+    footer.beginList(4, ThriftStruct, m_rowGroups.size());
+    for (const RowGroup& rowGroup : m_rowGroups)
+    {
+        footer.beginListStruct();
+        footer.beginList(1, ThriftStruct, rowGroup.columns.size());
+        uint64_t totalSize = 0;
+        for (size_t column = 0; column < rowGroup.columns.size(); ++column)
+        {
+            const ColumnChunk& chunk = rowGroup.columns.at(column);
+            const ParquetColumn& definition = m_columns.at(column);
+            bool hasDictionary = (chunk.dictionaryPageOffset != 0);
+            totalSize += chunk.uncompressedSize;
+
+            footer.beginListStruct();
+            footer.i64(2, static_cast<int64_t>(hasDictionary ? chunk.dictionaryPageOffset : chunk.dataPageOffset));
+            footer.beginStruct(3);
+            footer.i32(1, physicalType(definition.type));
+            footer.beginList(2, ThriftI32, hasDictionary ? 3 : 2);
+            footer.listI32(EncodingPlain);
+            footer.listI32(EncodingRLE);
+            if (hasDictionary)
+            {
+                footer.listI32(EncodingRLEDictionary);
+            }
+            footer.beginList(3, ThriftBinary, 1);
+            footer.listBinary(definition.name);
+            footer.i32(4, CodecGzip);
+            footer.i64(5, static_cast<int64_t>(chunk.valueCount));
+            footer.i64(6, static_cast<int64_t>(chunk.uncompressedSize));
+            footer.i64(7, static_cast<int64_t>(chunk.compressedSize));
+            footer.i64(9, static_cast<int64_t>(chunk.dataPageOffset));
+            if (hasDictionary)
+            {
+                footer.i64(11, static_cast<int64_t>(chunk.dictionaryPageOffset));
+            }
+            footer.endStruct();
+            footer.endStruct();
+        }
+        footer.i64(2, static_cast<int64_t>(totalSize));
+        footer.i64(3, static_cast<int64_t>(rowGroup.rowCount));
+        footer.endStruct();
+    }
+
+    footer.binary(6, "RLM Log Reader");
+    footer.endStruct();
+
+    std::string ending;
+    appendLittleEndian(ending, footer.bytes.size(), 4);
+    ending.append("PAR1");
+    m_writer.write(footer.bytes);
+    m_writer.write(ending);
+}
@@ -0,0 +1,114 @@
+// Copyright 2014 Steve Robinson
+//
+// This file is part of RLM Log Reader.
+//
+// RLM Log Reader is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// RLM Log Reader is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with RLM Log Reader.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "BufferedWriter.h"
+
+
+enum parquetType
+{
+    ParquetInt32,
+    ParquetInt64,
+    ParquetTimestamp,   // Given in seconds since the epoch, stored in milliseconds
+    ParquetString
+};
+
+
+struct ParquetColumn
+{
+    std::string name;
+    parquetType type;
+    bool optional;      // Whether the column can hold nulls
+};
+
+
+// Writes a table to a Parquet file a row at a time.  Rows are held in memory until there
+// are enough for a row group, which is then written out, so a file of any length only
+// ever needs one row group in memory.  Strings are dictionary encoded within each row
+// group and every page is compressed with gzip, which any Parquet reader can load.
+class ParquetWriter
+{
+    public:
+        static const size_t DefaultRowGroupSize = 1 << 20;
+
+        // Throws CannotOpenFileException
+        ParquetWriter(const std::string& filePath,
+                      const std::vector<ParquetColumn>& columns,
+                      size_t rowGroupSize = DefaultRowGroupSize);
+        ParquetWriter(const ParquetWriter&) = delete;
+        ParquetWriter& operator=(const ParquetWriter&) = delete;
+
+        // Each column gets one value per row, in any order, before endRow().  Strings come
+        // with an id that's the same for every copy of the text, like the ids of an
+        // EventTable, so the dictionaries are built without hashing the text again.
+        void addNull(size_t column);
+        void addNumber(size_t column, int64_t number);
+        void addString(size_t column, uint32_t id, std::string_view text);
+        void endRow();
+
+        // Writes the last row group and the footer.  Throws CannotOpenFileException if
+        // any of the writes failed.
+        void close();
+    private:
+        // Values of a column for the row group being built.  Strings are kept as their
+        // index in the row group's dictionary, which is looked up by id.
+        struct ColumnValues
+        {
+            std::vector<uint32_t> present;
+            std::vector<int64_t> numbers;
+            std::vector<uint32_t> indices;
+            std::vector<std::string> dictionary;
+            std::vector<uint32_t> dictionaryIds;
+            std::vector<uint32_t> dictionaryIndices;
+        };
+
+        // Where a column chunk of a written row group is, for the footer
+        struct ColumnChunk
+        {
+            uint64_t dictionaryPageOffset;  // 0 without a dictionary
+            uint64_t dataPageOffset;
+            uint64_t compressedSize;
+            uint64_t uncompressedSize;
+            size_t valueCount;
+        };
+
+        struct RowGroup
+        {
+            std::vector<ColumnChunk> columns;
+            size_t rowCount;
+        };
+
+        void writeRowGroup();
+        ColumnChunk writeColumnChunk(size_t column);
+        void writePage(const std::string& header, const std::string& compressed);
+        void writeFooter();
+
+        std::string m_filePath;
+        BufferedWriter m_writer;
+        std::vector<ParquetColumn> m_columns;
+        std::vector<ColumnValues> m_values;
+        size_t m_rowGroupSize;
+        size_t m_rowCount;
+        size_t m_totalRowCount;
+        uint64_t m_offset;
+        std::vector<RowGroup> m_rowGroups;
+};
@@ -0,0 +1,63 @@
+// Copyright 2014 Steve Robinson
+//
+// This file is part of RLM Log Reader.
+//
+// RLM Log Reader is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// RLM Log Reader is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with RLM Log Reader.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "StringTable.h"
+
+
+StringTable::StringTable()
+{
+}
+
+
+uint32_t StringTable::add(std::string_view item)
+{
+    auto found = m_ids.find(item);
+    if (found != m_ids.end())
+    {
+        return found->second;
+    }
+
+    uint32_t id = static_cast<uint32_t>(m_items.size());
+    m_items.push_back(std::string(item));
+    m_ids.emplace(m_items.back(), id);
+
+    return id;
+}
+
+
+uint32_t StringTable::find(std::string_view item) const
+{
+    auto found = m_ids.find(item);
+    if (found != m_ids.end())
+    {
+        return found->second;
+    }
+
+    return NotFound;
+}
+
+
+const std::string& StringTable::at(uint32_t id) const
+{
+    return m_items.at(id);
+}
+
+
+size_t StringTable::size() const
+{
+    return m_items.size();
+}
@@ -0,0 +1,48 @@
+// Copyright 2014 Steve Robinson
+//
+// This file is part of RLM Log Reader.
+//
+// RLM Log Reader is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// RLM Log Reader is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with RLM Log Reader.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+
+// Hash-based intern table.  Each distinct string gets a dense id in the order it
+// was first added, so the ids double as column numbers in the output files.
+class StringTable
+{
+    public:
+        static constexpr uint32_t NotFound = UINT32_MAX;
+
+        StringTable();
+        StringTable(const StringTable&) = delete;
+        StringTable& operator=(const StringTable&) = delete;
+        StringTable(StringTable&&) = default;
+        StringTable& operator=(StringTable&&) = default;
+
+        uint32_t add(std::string_view item);
+        uint32_t find(std::string_view item) const;
+        const std::string& at(uint32_t id) const;
+        size_t size() const;
+    private:
+        // A deque never moves its elements, so the map keys can view the stored strings
+        std::deque<std::string> m_items;
+        std::unordered_map<std::string_view, uint32_t> m_ids;
+};
@@ -15,19 +15,29 @@
 // You should have received a copy of the GNU General Public License
 // along with RLM Log Reader.  If not, see <http://www.gnu.org/licenses/>.
 
+#include "AnalysisProgress.h"
+#include "BatchAnalysis.h"
+#include "Exceptions.h"
 #include "LogData.h"
+#include "LogWatcher.h"
 #include "gtest/gtest.h"
 #include "TestConfig.h"
 #include "Utilities.h"
+#include "qdir.h"
+#include <filesystem>
+#include <fstream>
+#include <initializer_list>
+#include <sstream>
 
 
 void integrationTest(const std::string& logFileName,
                      std::vector<std::string>& usage,
                      std::vector<std::string>& event,
-                     std::vector<std::string>& summary)
+                     std::vector<std::string>& summary,
+                     size_t threadCount = 0)
 {
     std::string inputFilePath = testInputDirectory + "/" + logFileName;
-    LogData logData(inputFilePath, testOutputDirectory);
+    LogData logData(inputFilePath, testOutputDirectory, threadCount);
     logData.publishResults();
     logData.publishEventDataResults();
     std::string inputFileName = getFilenameFromFilepath(logFileName);
@@ -41,14 +51,43 @@ void parseReportLog(const std::string& logFileName,
                     std::vector<std::string>& event,
                     std::vector<std::string>& summary,
                     std::vector<std::string>& duration,
-                    std::vector<std::string>& totalDuration)
+                    std::vector<std::string>& totalDuration,
+                    size_t threadCount = 0)
 {
-    integrationTest(logFileName, usage, event, summary);
+    integrationTest(logFileName, usage, event, summary, threadCount);
     std::string inputFileName = getFilenameFromFilepath(logFileName);
     loadDataFromFile(testOutputDirectory + "/" + inputFileName + "_UsageDuration.csv", duration);
     loadDataFromFile(testOutputDirectory + "/" + inputFileName + "_TotalDuration.csv", totalDuration);
 }
 
+// The results named name in one directory must have the same lines as in another
+void expectSameResults(const std::string& expectedDirectory,
+                       const std::string& actualDirectory,
+                       const std::string& name,
+                       std::initializer_list<const char*> suffixes)
+{
+    for (const char* suffix : suffixes)
+    {
+        std::vector<std::string> expected, actual;
+        loadDataFromFile(expectedDirectory + "/" + name + suffix, expected);
+        loadDataFromFile(actualDirectory + "/" + name + suffix, actual);
+        EXPECT_EQ(expected, actual) << suffix;
+    }
+}
+
+// Bytes in the results named name
+uint64_t resultsSize(const std::string& directory,
+                     const std::string& name,
+                     std::initializer_list<const char*> suffixes)
+{
+    uint64_t size = 0;
+    for (const char* suffix : suffixes)
+    {
+        size += getFileSize(directory + "/" + name + suffix);
+    }
+    return size;
+}
+
 
 TEST(IntegrationTest, ReportLog)
 {
@@ -263,6 +302,383 @@ TEST(IntegrationTest, Exception)
 }
 
 
+// Splitting the file between threads must not change any of the results
+void splitAcrossThreadsTest(const std::string& logFileName)
+{
+    std::vector<std::string> usage, event, summary, duration, totalDuration;
+    parseReportLog(logFileName, usage, event, summary, duration, totalDuration, 1);
+
+    for (size_t threadCount=2; threadCount <= 8; ++threadCount)
+    {
+        std::vector<std::string> splitUsage, splitEvent, splitSummary, splitDuration, splitTotalDuration;
+        parseReportLog(logFileName, splitUsage, splitEvent, splitSummary, splitDuration, splitTotalDuration, threadCount);
+        EXPECT_EQ(usage, splitUsage) << threadCount << " threads";
+        EXPECT_EQ(event, splitEvent) << threadCount << " threads";
+        EXPECT_EQ(summary, splitSummary) << threadCount << " threads";
+        EXPECT_EQ(duration, splitDuration) << threadCount << " threads";
+        EXPECT_EQ(totalDuration, splitTotalDuration) << threadCount << " threads";
+    }
+}
+TEST(IntegrationTest, ReportLogSplitAcrossThreads)
+{
+    splitAcrossThreadsTest("SampleLog_Report.log");
+}
+TEST(IntegrationTest, NewYearSplitAcrossThreads)
+{
+    splitAcrossThreadsTest("NewYear.log");
+}
+TEST(IntegrationTest, ISVLogSplitAcrossThreads)
+{
+    std::vector<std::string> usage, event, summary;
+    integrationTest("SampleLog_ISV.log", usage, event, summary, 1);
+
+    for (size_t threadCount=2; threadCount <= 8; ++threadCount)
+    {
+        std::vector<std::string> splitUsage, splitEvent, splitSummary;
+        integrationTest("SampleLog_ISV.log", splitUsage, splitEvent, splitSummary, threadCount);
+        EXPECT_EQ(usage, splitUsage) << threadCount << " threads";
+        EXPECT_EQ(event, splitEvent) << threadCount << " threads";
+        EXPECT_EQ(summary, splitSummary) << threadCount << " threads";
+    }
+}
+TEST(IntegrationTest, ExceptionSplitAcrossThreads)
+{
+    for (size_t threadCount=1; threadCount <= 8; ++threadCount)
+    {
+        std::vector<std::string> usage, event, summary;
+        std::string errorMessage;
+        try
+        {
+            integrationTest("EventDataException.log", usage, event, summary, threadCount);
+        }
+        catch (std::exception& e)
+        {
+            errorMessage = e.what();
+        }
+        EXPECT_EQ("Missing data on line 15", errorMessage) << threadCount << " threads";
+    }
+}
+TEST(IntegrationTest, PublishesEveryOutputOnAnyNumberOfThreads)
+{
+    // Each file is written by a task of its own, which mustn't change what's in it
+    std::string directory = testOutputDirectory + "/PublishThreads";
+    std::vector<std::string> suffixes = {"_Summary.txt", "_AllEventData.txt", "_UsageOverTime.csv",
+                                         "_UsageDuration.csv", "_TotalDuration.csv", "_UsageByPeriod.csv",
+                                         "_AllEventData.parquet", "_UsageDuration.parquet"};
+    std::vector<std::string> serial;
+    for (size_t threadCount : {1, 8})
+    {
+        std::filesystem::remove_all(directory);
+        QDir().mkpath(directory.c_str());
+        LogData logData(testInputDirectory + "/SampleLog_Report.log", directory, threadCount);
+        logData.publishResults(AllOutputs | ParquetOutputs);
+
+        std::vector<std::string> files;
+        for (const std::string& suffix : suffixes)
+        {
+            std::ifstream file((directory + "/SampleLog_Report" + suffix).c_str(), std::ios::binary);
+            files.emplace_back(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+            EXPECT_FALSE(files.back().empty()) << suffix;
+        }
+        if (serial.empty())
+        {
+            serial = files;
+        }
+        EXPECT_EQ(serial, files) << threadCount << " threads";
+    }
+}
+
+
+// Analyzing a log each time a few more bytes are written to it must give the same
+// results as analyzing all of it at once, even when a run ends part way through a line
+void incrementalTest(const std::string& logFileName,
+                     size_t bytesPerRun,
+                     const unsigned int outputs = AllOutputs)
+{
+    std::ifstream inputFile((testInputDirectory + "/" + logFileName).c_str(), std::ios::binary);
+    std::stringstream log;
+    log << inputFile.rdbuf();
+    std::string logData = log.str();
+    if (logData.back() != '\n')
+    {
+        logData.push_back('\n');
+    }
+
+    std::string directory = testOutputDirectory + "/Incremental";
+    std::string resultsDirectory = directory + "/Results";
+    std::string fullDirectory = directory + "/Full";
+    std::string growingFilePath = directory + "/" + logFileName;
+    std::string inputFileName = getFilenameFromFilepath(logFileName);
+    QDir().mkpath(resultsDirectory.c_str());
+    QDir().mkpath(fullDirectory.c_str());
+    remove((resultsDirectory + "/" + inputFileName + "_Checkpoint.txt").c_str());
+
+    size_t runs = 0;
+    for (size_t size=bytesPerRun; size < logData.size() + bytesPerRun; size += bytesPerRun)
+    {
+        std::ofstream growingFile(growingFilePath.c_str(), std::ios::binary);
+        growingFile << logData.substr(0, size);
+        growingFile.close();
+
+        LogData logData(growingFilePath, resultsDirectory, 0, IncrementalAnalysis, outputs);
+        EXPECT_EQ(runs > 0, logData.resumed()) << "Run " << runs;
+        logData.publishResults();
+        ++runs;
+    }
+
+    LogData fullLogData(growingFilePath, fullDirectory);
+    fullLogData.publishResults(outputs);
+
+    std::vector<std::string> suffixes = {"_Summary.txt", "_AllEventData.txt", "_UsageOverTime.csv"};
+    if (fullLogData.fileFormat() == ReportLog)
+    {
+        suffixes.push_back("_UsageDuration.csv");
+        suffixes.push_back("_TotalDuration.csv");
+        suffixes.push_back("_UsageByPeriod.csv");
+    }
+    for (const std::string& suffix : suffixes)
+    {
+        std::vector<std::string> incremental, full;
+        loadDataFromFile(resultsDirectory + "/" + inputFileName + suffix, incremental);
+        loadDataFromFile(fullDirectory + "/" + inputFileName + suffix, full);
+        EXPECT_EQ(full, incremental) << suffix;
+    }
+}
+TEST(IncrementalAnalysis, ReportLogMatchesFullAnalysis)
+{
+    incrementalTest("SampleLog_Report.log", 200);
+}
+TEST(IncrementalAnalysis, NewYearMatchesFullAnalysis)
+{
+    incrementalTest("NewYear.log", 150);
+}
+TEST(IncrementalAnalysis, ISVLogMatchesFullAnalysis)
+{
+    incrementalTest("SampleLog_ISV.log", 100);
+}
+TEST(IncrementalAnalysis, UsageChangesMatchFullAnalysis)
+{
+    incrementalTest("SampleLog_Report.log", 200, AllOutputs | SparseUsageOverTime);
+    incrementalTest("UniqueUsers.log", 300, AllOutputs | SparseUsageOverTime);
+}
+// Following a log in memory, and only sometimes writing the results, must also give the
+// same results as analyzing all of it at once
+TEST(IncrementalAnalysis, FollowingMatchesFullAnalysis)
+{
+    std::ifstream inputFile((testInputDirectory + "/SampleLog_Report.log").c_str(), std::ios::binary);
+    std::stringstream log;
+    log << inputFile.rdbuf();
+    std::string logData = log.str();
+
+    std::string directory = testOutputDirectory + "/Following";
+    std::string resultsDirectory = directory + "/Results";
+    std::string fullDirectory = directory + "/Full";
+    std::string growingFilePath = directory + "/Server.log";
+    QDir().mkpath(resultsDirectory.c_str());
+    QDir().mkpath(fullDirectory.c_str());
+    remove((resultsDirectory + "/Server_Checkpoint.txt").c_str());
+
+    const size_t bytesPerUpdate = 150;
+    std::ofstream growingFile(growingFilePath.c_str(), std::ios::binary);
+    growingFile << logData.substr(0, bytesPerUpdate);
+    growingFile.flush();
+
+    LogData followedLogData(growingFilePath, resultsDirectory, 0, IncrementalAnalysis, AllOutputs);
+    followedLogData.publishResults();
+    for (size_t size=bytesPerUpdate; size < logData.size(); size += bytesPerUpdate)
+    {
+        growingFile << logData.substr(size, bytesPerUpdate);
+        growingFile.flush();
+        ASSERT_TRUE(followedLogData.update());
+        if ((size / bytesPerUpdate) % 3 == 0)
+        {
+            followedLogData.publishResults();
+        }
+    }
+    growingFile.close();
+    followedLogData.publishResults();
+
+    LogData fullLogData(growingFilePath, fullDirectory);
+    fullLogData.publishResults(AllOutputs);
+
+    std::vector<ProductUsage> usage;
+    followedLogData.currentUsage(usage);
+    ASSERT_EQ(3, usage.size());
+    EXPECT_EQ("simulator", usage.at(0).product);
+    EXPECT_EQ(1, followedLogData.denialCount());
+
+    for (const char* suffix : {"_Summary.txt", "_AllEventData.txt", "_UsageOverTime.csv",
+                               "_UsageDuration.csv", "_TotalDuration.csv", "_UsageByPeriod.csv"})
+    {
+        std::vector<std::string> followed, full;
+        loadDataFromFile(resultsDirectory + "/Server" + suffix, followed);
+        loadDataFromFile(fullDirectory + "/Server" + suffix, full);
+        EXPECT_EQ(full, followed) << suffix;
+    }
+
+    // A replaced log has to be read again from the start
+    std::ofstream replacedFile(growingFilePath.c_str(), std::ios::binary);
+    replacedFile << logData.substr(0, 100);
+    replacedFile.close();
+    EXPECT_FALSE(followedLogData.update());
+}
+TEST(LogWatcher, WakesUpWhenTheLogIsWritten)
+{
+    std::string directory = testOutputDirectory + "/Watched";
+    std::string filePath = directory + "/Server.log";
+    QDir().mkpath(directory.c_str());
+    std::ofstream(filePath.c_str()).close();
+
+    LogWatcher logWatcher(filePath);
+    EXPECT_FALSE(logWatcher.waitForChange(std::chrono::milliseconds(50)));
+
+    std::ofstream(filePath.c_str(), std::ios::app) << "OUT\n";
+    EXPECT_TRUE(logWatcher.waitForChange(std::chrono::seconds(5)));
+
+    // Nothing else in the directory wakes it up
+    std::ofstream((directory + "/Other.log").c_str(), std::ios::app) << "OUT\n";
+    EXPECT_FALSE(logWatcher.waitForChange(std::chrono::milliseconds(50)));
+}
+void copyTestFile(const std::string& logFileName, const std::string& filePath)
+{
+    std::ifstream inputFile((testInputDirectory + "/" + logFileName).c_str(), std::ios::binary);
+    std::ofstream outputFile(filePath.c_str(), std::ios::binary);
+    outputFile << inputFile.rdbuf();
+}
+// Profiling doesn't change the results, so turning it on carries on from the last run
+TEST(IncrementalAnalysis, ProfilingDoesNotStartOver)
+{
+    std::string directory = testOutputDirectory + "/IncrementalProfiled";
+    std::string logFilePath = directory + "/Server.log";
+    QDir().mkpath(directory.c_str());
+    remove((directory + "/Server_Checkpoint.txt").c_str());
+    copyTestFile("SampleLog_Report.log", logFilePath);
+
+    LogData first(logFilePath, directory, 0, IncrementalAnalysis);
+    first.publishResults();
+
+    LogData second(logFilePath, directory, 0, IncrementalAnalysis, StandardOutputs | ProfileOutput);
+    EXPECT_TRUE(second.resumed());
+    second.publishResults();
+    EXPECT_TRUE(fileExists(directory + "/Server_Profile.json"));
+    EXPECT_EQ(0, second.profile().stage(ExtractStage).lines);
+}
+
+TEST(IncrementalAnalysis, StartsOverWhenLogOrResultsChange)
+{
+    std::string directory = testOutputDirectory + "/IncrementalReplaced";
+    std::string logFilePath = directory + "/Server.log";
+    QDir().mkpath(directory.c_str());
+    remove((directory + "/Server_Checkpoint.txt").c_str());
+    copyTestFile("SampleLog_Report.log", logFilePath);
+
+    LogData first(logFilePath, directory, 0, IncrementalAnalysis);
+    EXPECT_FALSE(first.resumed());
+    first.publishResults();
+
+    // A rotated log starts again with different contents
+    copyTestFile("UniqueUsers.log", logFilePath);
+    LogData second(logFilePath, directory, 0, IncrementalAnalysis);
+    EXPECT_FALSE(second.resumed());
+    second.publishResults();
+
+    LogData third(logFilePath, directory, 0, IncrementalAnalysis);
+    EXPECT_TRUE(third.resumed());
+    third.publishResults();
+
+    // Results that were changed since can't be added to
+    std::ofstream usage((directory + "/Server_UsageOverTime.csv").c_str(), std::ios::app);
+    usage << "Edited\n";
+    usage.close();
+    LogData fourth(logFilePath, directory, 0, IncrementalAnalysis);
+    EXPECT_FALSE(fourth.resumed());
+
+    // Only the results the checkpoint keeps track of can be published
+    EXPECT_THROW(fourth.publishResults(AllOutputs), IncrementalOutputsException);
+}
+
+TEST(IncrementalAnalysis, CannotPublishParquet)
+{
+    std::string logFilePath = testInputDirectory + "/SampleLog_Report.log";
+    EXPECT_THROW(LogData(logFilePath, testOutputDirectory, 0, IncrementalAnalysis, ParquetOutputs),
+                 IncrementalParquetException);
+}
+
+
+// Writes the sample report log with enough AUTH lines, which are ignored, between its
+// lines for it to take a few segments to read
+void writeSegmentedLog(const std::string& logFilePath)
+{
+    std::vector<std::string> lines;
+    loadDataFromFile(testInputDirectory + "/SampleLog_Report.log", lines);
+    std::string padding = "AUTH: " + std::string(1000, '0') + "\n";
+    size_t paddingPerLine = 3 * SegmentSize / lines.size() / padding.size();
+
+    std::ofstream logFile(logFilePath.c_str(), std::ios::binary);
+    for (const std::string& line : lines)
+    {
+        logFile << line << "\n";
+        for (size_t pad=0; pad < paddingPerLine; ++pad)
+        {
+            logFile << padding;
+        }
+    }
+}
+
+
+void compareResults(const std::string& logFileName,
+                    const std::string& directory,
+                    const std::string& fullDirectory)
+{
+    std::vector<std::string> suffixes = {"_Summary.txt", "_AllEventData.txt", "_UsageOverTime.csv",
+                                         "_UsageDuration.csv", "_TotalDuration.csv", "_UsageByPeriod.csv"};
+    for (const std::string& suffix : suffixes)
+    {
+        std::vector<std::string> results, full;
+        loadDataFromFile(directory + "/" + logFileName + suffix, results);
+        loadDataFromFile(fullDirectory + "/" + logFileName + suffix, full);
+        EXPECT_FALSE(full.empty()) << suffix;
+        EXPECT_EQ(full, results) << suffix;
+    }
+}
+
+
+// Reading a log a segment at a time must give the same results as reading it whole
+void segmentedTest(const unsigned int outputs)
+{
+    std::string directory = testOutputDirectory + "/Segmented";
+    std::string resultsDirectory = directory + "/Results";
+    std::string fullDirectory = directory + "/Full";
+    std::string logFilePath = directory + "/Segmented.log";
+    QDir().mkpath(resultsDirectory.c_str());
+    QDir().mkpath(fullDirectory.c_str());
+    writeSegmentedLog(logFilePath);
+
+    LogData segmentedLogData(logFilePath, resultsDirectory, 0, SegmentedAnalysis, outputs);
+    segmentedLogData.publishResults();
+    EXPECT_TRUE(segmentedLogData.resumed());
+
+    LogData fullLogData(logFilePath, fullDirectory);
+    fullLogData.publishResults(outputs);
+    compareResults("Segmented", resultsDirectory, fullDirectory);
+}
+TEST(SegmentedAnalysis, MatchesFullAnalysis)
+{
+    segmentedTest(AllOutputs);
+}
+TEST(SegmentedAnalysis, UsageChangesMatchFullAnalysis)
+{
+    segmentedTest(AllOutputs | SparseUsageOverTime);
+}
+
+TEST(SegmentedAnalysis, CannotPublishParquet)
+{
+    std::string logFilePath = testInputDirectory + "/SampleLog_Report.log";
+    EXPECT_THROW(LogData(logFilePath, testOutputDirectory, 0, SegmentedAnalysis, ParquetOutputs),
+                 IncrementalParquetException);
+}
+
+
 TEST(findFileFormat, DetectsReportLogFormat)
 {
     std::string inputFilePath = testInputDirectory + "/TestFileFormatReport.txt";
@@ -364,6 +780,544 @@ TEST(uniqueUsers, SetToOneIfSeatsAlreadyCheckedOutWhenLogStarts)
 }
 
 
+TEST(IntegrationTest, ReportLogUsageChanges)
+{
+    std::string directory = testOutputDirectory + "/UsageChanges";
+    QDir().mkpath(directory.c_str());
+    LogData logData(testInputDirectory + "/SampleLog_Report.log", directory);
+    logData.publishResults(UsageOverTimeOutput | SparseUsageOverTime);
+    std::vector<std::string> usage;
+    loadDataFromFile(directory + "/SampleLog_Report_UsageOverTime.csv", usage);
+
+    // The same usage as the full rows, but only for the products each event changed
+    ASSERT_EQ(14, usage.size());
+    EXPECT_EQ("Date/Time,Product,Licenses in use,Unique user count,Total licenses", usage.at(0));
+    EXPECT_EQ("05/11/2013 15:17:14,simulator,0,0,1", usage.at(1));
+    EXPECT_EQ("05/11/2013 15:17:14,analytics,1,1,2", usage.at(2));
+    EXPECT_EQ("05/11/2013 15:19:08,simulator,1,1,1", usage.at(3));
+    EXPECT_EQ("05/11/2013 15:22:13,simulator,0,0,1", usage.at(4));
+    EXPECT_EQ("05/11/2013 15:23:15,analytics,0,0,2", usage.at(5));
+    EXPECT_EQ("05/11/2013 15:25:00,simulator,0,0,50", usage.at(6));
+    EXPECT_EQ("05/11/2013 15:25:00,analytics,0,0,3", usage.at(7));
+    EXPECT_EQ("05/11/2013 15:25:00,datavis,1,1,10", usage.at(8));
+    EXPECT_EQ("05/11/2013 15:26:36,analytics,1,1,3", usage.at(9));
+    EXPECT_EQ("05/11/2013 15:28:06,datavis,2,1,10", usage.at(10));
+    EXPECT_EQ("05/11/2013 16:07:39,analytics,0,0,3", usage.at(11));
+    EXPECT_EQ("05/12/2013 01:32:28,datavis,1,1,10", usage.at(12));
+    EXPECT_EQ("", usage.at(13));
+}
+
+
+TEST(IntegrationTest, UsageChangesWrittenAsTheyreWorkedOut)
+{
+    std::string streamedDirectory = testOutputDirectory + "/UsageChangesStreamed";
+    std::string eagerDirectory = testOutputDirectory + "/UsageChangesEager";
+    QDir().mkpath(streamedDirectory.c_str());
+    QDir().mkpath(eagerDirectory.c_str());
+    const unsigned int outputs = UsageOverTimeOutput | SparseUsageOverTime | UsageByPeriodOutput;
+
+    for (const char* name : {"SampleLog_Report", "SampleLog_ISV"})
+    {
+        std::string logFilePath = testInputDirectory + "/" + name + ".log";
+        LogData streamed(logFilePath, streamedDirectory, 0, FullAnalysis, outputs | ProfileOutput);
+        EXPECT_EQ(0, streamed.profile().stage(ConcurrencyStage).runs) << name;
+        streamed.publishResults(outputs);
+        EXPECT_EQ(1, streamed.profile().stage(ConcurrencyStage).runs) << name;
+
+        // A query works out the usage first, so there's none left to work out while writing
+        LogData eager(logFilePath, eagerDirectory, 0, FullAnalysis, 0);
+        std::vector<ProductUsage> usage;
+        eager.currentUsage(usage);
+        eager.publishResults(outputs);
+
+        expectSameResults(eagerDirectory, streamedDirectory, name, {"_UsageOverTime.csv"});
+        if (eager.fileFormat() == ReportLog)
+        {
+            expectSameResults(eagerDirectory, streamedDirectory, name, {"_UsageByPeriod.csv"});
+        }
+    }
+}
+
+
+TEST(IntegrationTest, ReportLogUsageByPeriod)
+{
+    std::string logFileName = "SampleLog_Report.log";
+    LogData logData(testInputDirectory + "/" + logFileName, testOutputDirectory);
+    logData.publishResults(UsageByPeriodOutput);
+    std::vector<std::string> usage;
+    loadDataFromFile(testOutputDirectory + "/SampleLog_Report_UsageByPeriod.csv", usage);
+
+    // Every hour from the first checkout to the last event, with the usage carried through
+    // the hours nothing happened in
+    ASSERT_EQ(35, usage.size());
+    EXPECT_EQ("Period Start,Product,"
+              "Peak licenses in use,Average licenses in use,Minimum licenses in use,"
+              "Peak unique user count,Average unique user count,Minimum unique user count,"
+              "Denials", usage.at(0));
+    EXPECT_EQ("05/11/2013 15:00,simulator,1,0.07,0,1,0.07,0,1", usage.at(1));
+    EXPECT_EQ("05/11/2013 15:00,analytics,1,0.92,0,1,0.92,0,0", usage.at(2));
+    EXPECT_EQ("05/11/2013 15:00,datavis,2,1.56,0,1,0.82,0,0", usage.at(3));
+    EXPECT_EQ("05/11/2013 16:00,simulator,0,0.00,0,0,0.00,0,0", usage.at(4));
+    EXPECT_EQ("05/11/2013 16:00,analytics,1,0.13,0,1,0.13,0,0", usage.at(5));
+    EXPECT_EQ("05/11/2013 16:00,datavis,2,2.00,2,1,1.00,1,0", usage.at(6));
+    EXPECT_EQ("05/11/2013 23:00,datavis,2,2.00,2,1,1.00,1,0", usage.at(27));
+    EXPECT_EQ("05/12/2013 00:00,simulator,0,0.00,0,0,0.00,0,0", usage.at(28));
+    EXPECT_EQ("05/12/2013 01:00,datavis,2,2.00,1,1,1.00,1,0", usage.at(33));
+    EXPECT_EQ("", usage.at(34));
+}
+
+
+std::string parquetFooter(const std::string& filePath)
+{
+    std::ifstream inputFile(filePath.c_str(), std::ios::binary);
+    std::string contents((std::istreambuf_iterator<char>(inputFile)), std::istreambuf_iterator<char>());
+    if (contents.size() < 12 || contents.compare(0, 4, "PAR1") != 0 ||
+        contents.compare(contents.size() - 4, 4, "PAR1") != 0)
+    {
+        return "";
+    }
+
+    // The footer's length is just before the closing magic number
+    const unsigned char* length = reinterpret_cast<const unsigned char*>(contents.data() + contents.size() - 8);
+    size_t footerLength = length[0] | (length[1] << 8) | (length[2] << 16) | (size_t(length[3]) << 24);
+    if (footerLength > contents.size() - 12)
+    {
+        return "";
+    }
+    return contents.substr(contents.size() - 8 - footerLength, footerLength);
+}
+
+TEST(IntegrationTest, ReportLogParquet)
+{
+    std::string logFileName = "SampleLog_Report.log";
+    LogData logData(testInputDirectory + "/" + logFileName, testOutputDirectory);
+    logData.publishResults(ParquetOutputs);
+
+    // The footer holds the schema uncompressed
+    std::string events = parquetFooter(testOutputDirectory + "/SampleLog_Report_AllEventData.parquet");
+    EXPECT_NE(std::string::npos, events.find("timestamp"));
+    EXPECT_NE(std::string::npos, events.find("handle"));
+    std::string durations = parquetFooter(testOutputDirectory + "/SampleLog_Report_UsageDuration.parquet");
+    EXPECT_NE(std::string::npos, durations.find("checkin"));
+    EXPECT_NE(std::string::npos, durations.find("duration_seconds"));
+}
+
+TEST(IntegrationTest, ISVLogParquet)
+{
+    std::string logFileName = "SampleLog_ISV.log";
+    std::string durationPath = testOutputDirectory + "/SampleLog_ISV_UsageDuration.parquet";
+    remove(durationPath.c_str());
+    LogData logData(testInputDirectory + "/" + logFileName, testOutputDirectory);
+    logData.publishResults(ParquetOutputs);
+
+    // Without handles there are no durations
+    EXPECT_NE(std::string::npos, parquetFooter(testOutputDirectory + "/SampleLog_ISV_AllEventData.parquet").find("count"));
+    EXPECT_FALSE(fileExists(durationPath));
+}
+
+
+TEST(AnalysisProfile, MeasuresEachStageOfAReportLog)
+{
+    std::string logFilePath = testInputDirectory + "/SampleLog_Report.log";
+    std::string profilePath = testOutputDirectory + "/SampleLog_Report_Profile.json";
+    remove(profilePath.c_str());
+    LogData logData(logFilePath, testOutputDirectory, 0, FullAnalysis, StandardOutputs | ProfileOutput);
+    logData.publishResults();
+
+    const AnalysisProfile& profile = logData.profile();
+    EXPECT_EQ(getFileSize(logFilePath), profile.stage(LoadStage).bytesRead);
+    EXPECT_EQ(1, profile.stage(FormatStage).runs);
+
+    // Counting the empty line after the last line break
+    EXPECT_EQ(64, profile.stage(TokenizeStage).lines);
+    EXPECT_EQ(0, profile.stage(NormalizeStage).lines);
+    EXPECT_EQ(64, profile.stage(ExtractStage).lines);
+    EXPECT_EQ(getFileSize(logFilePath), profile.stage(ExtractStage).bytesRead);
+    EXPECT_LT(0, profile.stage(ExtractStage).events);
+    EXPECT_EQ(profile.stage(ExtractStage).events, profile.stage(ConcurrencyStage).events);
+    EXPECT_EQ(1, profile.stage(DurationStage).runs);
+    EXPECT_LT(0, profile.stage(ExtractStage).allocations);
+
+    uint64_t outputSize = resultsSize(testOutputDirectory, "SampleLog_Report",
+                                      {"_Summary.txt", "_UsageOverTime.csv", "_UsageDuration.csv", "_TotalDuration.csv"});
+    EXPECT_EQ(outputSize, profile.stage(PublishStage).bytesWritten);
+
+    std::ifstream profileFile(profilePath.c_str());
+    std::string json((std::istreambuf_iterator<char>(profileFile)), std::istreambuf_iterator<char>());
+    EXPECT_NE(std::string::npos, json.find("\"stages\""));
+    EXPECT_NE(std::string::npos, json.find("\"publish\": {\"runs\": 1, "));
+}
+
+TEST(AnalysisProfile, NormalizesISVLogs)
+{
+    LogData logData(testInputDirectory + "/SampleLog_ISV.log", testOutputDirectory, 0, FullAnalysis, ProfileOutput);
+    EXPECT_EQ(44, logData.profile().stage(NormalizeStage).lines);
+    EXPECT_EQ(0, logData.profile().stage(DurationStage).runs);
+}
+
+TEST(AnalysisProfile, OnlyWhenAsked)
+{
+    LogData logData(testInputDirectory + "/SampleLog_Report.log", testOutputDirectory);
+    EXPECT_FALSE(logData.profile().enabled());
+    EXPECT_EQ(0, logData.profile().stage(ExtractStage).runs);
+}
+
+
+TEST(LazyAnalysis, SummaryOnlySkipsUsageAndDurations)
+{
+    LogData logData(testInputDirectory + "/SampleLog_Report.log", testOutputDirectory, 0, FullAnalysis,
+                    SummaryOutput | ProfileOutput);
+    logData.publishResults();
+    EXPECT_EQ(0, logData.profile().stage(ConcurrencyStage).runs);
+    EXPECT_EQ(0, logData.profile().stage(DurationStage).runs);
+    EXPECT_LT(0, logData.denialCount());
+}
+
+TEST(LazyAnalysis, WorksOutEachAnalysisOnceWhenFirstNeeded)
+{
+    std::string logFilePath = testInputDirectory + "/SampleLog_Report.log";
+    std::string lazyDirectory = testOutputDirectory + "/Lazy";
+    std::string fullDirectory = testOutputDirectory + "/Eager";
+    QDir().mkpath(lazyDirectory.c_str());
+    QDir().mkpath(fullDirectory.c_str());
+
+    LogData lazy(logFilePath, lazyDirectory, 0, FullAnalysis, SummaryOutput | ProfileOutput);
+    lazy.publishResults(SummaryOutput | TotalDurationOutput);
+    EXPECT_EQ(0, lazy.profile().stage(ConcurrencyStage).runs);
+    EXPECT_EQ(1, lazy.profile().stage(DurationStage).runs);
+    lazy.publishResults(AllOutputs);
+    lazy.publishResults(AllOutputs);
+    EXPECT_EQ(1, lazy.profile().stage(ConcurrencyStage).runs);
+    EXPECT_EQ(1, lazy.profile().stage(DurationStage).runs);
+
+    LogData full(logFilePath, fullDirectory);
+    full.publishResults(AllOutputs);
+    expectSameResults(fullDirectory, lazyDirectory, "SampleLog_Report",
+                      {"_Summary.txt", "_UsageOverTime.csv", "_UsageDuration.csv",
+                       "_TotalDuration.csv", "_UsageByPeriod.csv"});
+}
+
+TEST(LazyAnalysis, QueriesOnlyWorkOutUsage)
+{
+    LogData logData(testInputDirectory + "/SampleLog_Report.log", testOutputDirectory, 0, FullAnalysis, ProfileOutput);
+    EXPECT_EQ(0, logData.profile().stage(ConcurrencyStage).runs);
+
+    std::vector<ProductUsage> usage;
+    logData.currentUsage(usage);
+    EXPECT_FALSE(usage.empty());
+    logData.usageAt(usage.front().product, 0);
+    EXPECT_EQ(1, logData.profile().stage(ConcurrencyStage).runs);
+    EXPECT_EQ(0, logData.profile().stage(DurationStage).runs);
+}
+
+
+// Keeps the last report of each stage, and cancels the analysis once it reaches cancelAt
+class StageRecorder : public AnalysisProgress
+{
+    public:
+        StageRecorder(analysisStage cancelAt = StageCount)
+            : AnalysisProgress(std::chrono::milliseconds(0)),
+              m_cancelAt(cancelAt)
+        {
+        }
+        std::vector<StageProgress> stages;
+    protected:
+        void progressed(const StageProgress& progress) override
+        {
+            if (stages.empty() || stages.back().stage != progress.stage || stages.back().finished)
+            {
+                stages.push_back(progress);
+            }
+            stages.back() = progress;
+            if (progress.stage == m_cancelAt)
+            {
+                cancel();
+            }
+        }
+    private:
+        analysisStage m_cancelAt;
+};
+
+TEST(AnalysisProgress, ReportsEachStage)
+{
+    std::string logFilePath = testInputDirectory + "/SampleLog_Report.log";
+    StageRecorder progress;
+    LogData logData(logFilePath, testOutputDirectory, 0, FullAnalysis, StandardOutputs, PerHour, &progress);
+    logData.publishResults();
+
+    std::vector<analysisStage> expected = {LoadStage, ExtractStage, ConcurrencyStage, DurationStage, PublishStage};
+    ASSERT_EQ(expected.size(), progress.stages.size());
+    for (size_t stage=0; stage < expected.size(); ++stage)
+    {
+        EXPECT_EQ(expected.at(stage), progress.stages.at(stage).stage);
+        EXPECT_TRUE(progress.stages.at(stage).finished);
+    }
+
+    const StageProgress& extract = progress.stages.at(1);
+    EXPECT_EQ(getFileSize(logFilePath), extract.bytes);
+    EXPECT_EQ(extract.totalBytes, extract.bytes);
+    EXPECT_LT(0, extract.events);
+    EXPECT_EQ(extract.events, progress.stages.at(2).events);
+    EXPECT_EQ(extract.events, progress.stages.at(2).totalEvents);
+
+    uint64_t outputSize = resultsSize(testOutputDirectory, "SampleLog_Report",
+                                      {"_Summary.txt", "_UsageOverTime.csv", "_UsageDuration.csv", "_TotalDuration.csv"});
+    EXPECT_EQ(outputSize, progress.stages.at(4).bytes);
+}
+
+TEST(AnalysisProgress, CancellingStopsParsing)
+{
+    for (size_t threadCount : {1, 4})
+    {
+        StageRecorder progress(ExtractStage);
+        EXPECT_THROW(LogData(testInputDirectory + "/SampleLog_ISV.log", testOutputDirectory,
+                             threadCount, FullAnalysis, StandardOutputs, PerHour, &progress),
+                     AnalysisCancelledException);
+        ASSERT_EQ(2, progress.stages.size());
+        EXPECT_EQ(ExtractStage, progress.stages.back().stage);
+        EXPECT_FALSE(progress.stages.back().finished);
+    }
+}
+
+TEST(AnalysisProgress, CancellingStopsPublishing)
+{
+    std::string directory = testOutputDirectory + "/Cancelled";
+    std::filesystem::remove_all(directory);
+    QDir().mkpath(directory.c_str());
+
+    StageRecorder progress(PublishStage);
+    LogData logData(testInputDirectory + "/SampleLog_Report.log", directory, 0, FullAnalysis,
+                    StandardOutputs, PerHour, &progress);
+    EXPECT_THROW(logData.publishResults(), AnalysisCancelledException);
+    EXPECT_TRUE(std::filesystem::is_empty(directory));
+}
+
+
+// A log analyzed from its cache must give the same results as parsing it
+void cacheTest(const std::string& logFileName)
+{
+    std::string directory = testOutputDirectory + "/Cached";
+    std::string resultsDirectory = directory + "/Results";
+    std::string fullDirectory = directory + "/Full";
+    std::string inputFileName = getFilenameFromFilepath(logFileName);
+    std::string logFilePath = testInputDirectory + "/" + logFileName;
+    QDir().mkpath(resultsDirectory.c_str());
+    QDir().mkpath(fullDirectory.c_str());
+    remove((resultsDirectory + "/" + inputFileName + "_Events.cache").c_str());
+
+    LogData parsed(logFilePath, resultsDirectory, 0, CachedAnalysis);
+    EXPECT_FALSE(parsed.fromCache());
+    LogData cached(logFilePath, resultsDirectory, 0, CachedAnalysis);
+    EXPECT_TRUE(cached.fromCache());
+    cached.publishResults(AllOutputs);
+
+    LogData fullLogData(logFilePath, fullDirectory);
+    fullLogData.publishResults(AllOutputs);
+
+    std::vector<std::string> suffixes = {"_Summary.txt", "_AllEventData.txt", "_UsageOverTime.csv"};
+    if (fullLogData.fileFormat() == ReportLog)
+    {
+        suffixes.push_back("_UsageDuration.csv");
+        suffixes.push_back("_TotalDuration.csv");
+        suffixes.push_back("_UsageByPeriod.csv");
+    }
+    for (const std::string& suffix : suffixes)
+    {
+        std::vector<std::string> fromCache, full;
+        loadDataFromFile(resultsDirectory + "/" + inputFileName + suffix, fromCache);
+        loadDataFromFile(fullDirectory + "/" + inputFileName + suffix, full);
+        EXPECT_EQ(full, fromCache) << suffix;
+    }
+}
+TEST(CachedAnalysis, ReportLogMatchesFullAnalysis)
+{
+    cacheTest("SampleLog_Report.log");
+}
+TEST(CachedAnalysis, NewYearMatchesFullAnalysis)
+{
+    cacheTest("NewYear.log");
+}
+TEST(CachedAnalysis, ISVLogMatchesFullAnalysis)
+{
+    cacheTest("SampleLog_ISV.log");
+}
+
+TEST(CachedAnalysis, ParsesAgainWhenLogOrCacheChange)
+{
+    std::string directory = testOutputDirectory + "/CacheReplaced";
+    std::string logFilePath = directory + "/Server.log";
+    std::string cachePath = directory + "/Server_Events.cache";
+    QDir().mkpath(directory.c_str());
+    remove(cachePath.c_str());
+    copyTestFile("SampleLog_Report.log", logFilePath);
+
+    LogData first(logFilePath, directory, 0, CachedAnalysis);
+    EXPECT_FALSE(first.fromCache());
+
+    // A damaged cache is replaced
+    std::filesystem::resize_file(cachePath, getFileSize(cachePath) / 2);
+    LogData damaged(logFilePath, directory, 0, CachedAnalysis);
+    EXPECT_FALSE(damaged.fromCache());
+    LogData replaced(logFilePath, directory, 0, CachedAnalysis);
+    EXPECT_TRUE(replaced.fromCache());
+
+    copyTestFile("UniqueUsers.log", logFilePath);
+    LogData changed(logFilePath, directory, 0, CachedAnalysis);
+    EXPECT_FALSE(changed.fromCache());
+    EXPECT_EQ(ReportLog, changed.fileFormat());
+}
+
+
+int64_t logTime(const std::string& date, const std::string& time)
+{
+    return std::chrono::duration_cast<std::chrono::seconds>(stringToTime(date, time).time_since_epoch()).count();
+}
+
+TEST(UsageQueries, ReportLog)
+{
+    LogData logData(testInputDirectory + "/SampleLog_Report.log", testOutputDirectory);
+
+    EXPECT_EQ(0, logData.usageAt("analytics", logTime("05/11/2013", "15:17:13")));
+    EXPECT_EQ(1, logData.usageAt("analytics", logTime("05/11/2013", "15:17:14")));
+    EXPECT_EQ(0, logData.usageAt("analytics", logTime("05/11/2013", "15:24:00")));
+    EXPECT_EQ(1, logData.usageAt("datavis", logTime("05/13/2013", "00:00:00")));
+
+    EXPECT_EQ(2, logData.peakUsage("datavis", logTime("05/11/2013", "15:00:00"), logTime("05/11/2013", "23:00:00")));
+    EXPECT_EQ(1, logData.peakUsage("simulator", logTime("05/11/2013", "15:20:00"), logTime("05/11/2013", "15:20:00")));
+
+    // Checked out for 6:01, then back for 2:38 after 3:21 without
+    EXPECT_DOUBLE_EQ((361.0 + 158.0) / 720.0,
+                     logData.averageUsage("analytics", logTime("05/11/2013", "15:17:14"), logTime("05/11/2013", "15:29:14")));
+
+    EXPECT_THROW(logData.usageAt("visualizer", 0), UnknownProductException);
+}
+
+
+TEST(UsageQueries, ISVLog)
+{
+    // Without the year, any time given would pick out the usage at the end of the log
+    LogData logData(testInputDirectory + "/SampleLog_ISV.log", testOutputDirectory);
+    EXPECT_THROW(logData.usageAt("datavis", logTime("05/11/2013", "15:25:00")), QueryFormatException);
+    EXPECT_THROW(logData.peakUsage("datavis", 0, logTime("05/11/2013", "15:25:00")), QueryFormatException);
+    EXPECT_THROW(logData.averageUsage("datavis", 0, logTime("05/11/2013", "15:25:00")), QueryFormatException);
+}
+
+
+// A compressed log must give the same results as the log itself
+void compressedLogTest(const std::string& compressedFileName, const std::string& logFileName)
+{
+    std::string compressedDirectory = testOutputDirectory + "/Compressed";
+    std::string plainDirectory = testOutputDirectory + "/Uncompressed";
+    QDir().mkpath(compressedDirectory.c_str());
+    QDir().mkpath(plainDirectory.c_str());
+
+    LogData compressed(testInputDirectory + "/" + compressedFileName, compressedDirectory);
+    compressed.publishResults(AllOutputs);
+    LogData plain(testInputDirectory + "/" + logFileName, plainDirectory);
+    plain.publishResults(AllOutputs);
+    EXPECT_EQ(plain.fileFormat(), compressed.fileFormat());
+
+    std::string inputFileName = getFilenameFromFilepath(logFileName);
+    std::vector<std::string> suffixes = {"_Summary.txt", "_AllEventData.txt", "_UsageOverTime.csv"};
+    if (plain.fileFormat() == ReportLog)
+    {
+        suffixes.push_back("_UsageDuration.csv");
+        suffixes.push_back("_TotalDuration.csv");
+        suffixes.push_back("_UsageByPeriod.csv");
+    }
+    for (const std::string& suffix : suffixes)
+    {
+        std::vector<std::string> fromCompressed, fromPlain;
+        loadDataFromFile(compressedDirectory + "/" + inputFileName + suffix, fromCompressed);
+        loadDataFromFile(plainDirectory + "/" + inputFileName + suffix, fromPlain);
+
+        // Apart from the path of the log in the summary
+        ASSERT_LT(1, fromCompressed.size()) << suffix;
+        if (suffix == "_Summary.txt")
+        {
+            EXPECT_EQ(testInputDirectory + "/" + compressedFileName, fromCompressed.at(1));
+            fromCompressed.erase(fromCompressed.begin() + 1);
+            fromPlain.erase(fromPlain.begin() + 1);
+        }
+        EXPECT_EQ(fromPlain, fromCompressed) << suffix;
+    }
+}
+TEST(CompressedLog, GzipReportLogMatchesLog)
+{
+    compressedLogTest("SampleLog_Report.log.gz", "SampleLog_Report.log");
+}
+TEST(CompressedLog, ZstdISVLogMatchesLog)
+{
+    compressedLogTest("SampleLog_ISV.log.zst", "SampleLog_ISV.log");
+}
+
+
+// A pool of one server must give the same results as analyzing its log on its own
+TEST(PooledAnalysis, SingleLogMatchesFullAnalysis)
+{
+    std::string poolDirectory = testOutputDirectory + "/Pool/One";
+    std::string fullDirectory = testOutputDirectory + "/Pool/Full";
+    std::string logFilePath = testInputDirectory + "/SampleLog_Report.log";
+    QDir().mkpath(poolDirectory.c_str());
+    QDir().mkpath(fullDirectory.c_str());
+
+    LogData pooled({logFilePath}, "SampleLog_Report", poolDirectory);
+    pooled.publishResults(AllOutputs);
+    LogData full(logFilePath, fullDirectory);
+    full.publishResults(AllOutputs);
+
+    expectSameResults(fullDirectory, poolDirectory, "SampleLog_Report",
+                      {"_Summary.txt", "_AllEventData.txt", "_UsageOverTime.csv",
+                       "_UsageDuration.csv", "_TotalDuration.csv", "_UsageByPeriod.csv"});
+}
+
+TEST(PooledAnalysis, ServersAddUp)
+{
+    // Two servers logging the same events at the same times, with the same handles
+    std::string directory = testOutputDirectory + "/Pool/Two";
+    QDir().mkpath(directory.c_str());
+    copyTestFile("SampleLog_Report.log", directory + "/First.log");
+    copyTestFile("SampleLog_Report.log", directory + "/Second.log");
+
+    LogData pooled({directory + "/First.log", directory + "/Second.log"}, "Site", directory);
+    pooled.publishResults(AllOutputs);
+
+    std::vector<std::string> usage, duration, totalDuration;
+    loadDataFromFile(directory + "/Site_UsageOverTime.csv", usage);
+    loadDataFromFile(directory + "/Site_UsageDuration.csv", duration);
+    loadDataFromFile(directory + "/Site_TotalDuration.csv", totalDuration);
+
+    // Each server's counts and licenses are added to the other's, and a user with a
+    // license on both servers is still one user
+    ASSERT_EQ(20, usage.size());
+    EXPECT_EQ("05/11/2013 15:19:08,2,1,2,2,1,4,0,0,0", usage.at(4));
+    EXPECT_EQ("05/11/2013 15:23:15,0,0,2,1,1,4,0,0,0", usage.at(7));
+    EXPECT_EQ("05/12/2013 01:32:28,0,0,100,0,0,6,2,1,20", usage.at(18));
+
+    // Every checkout is checked in on its own server, and a shutdown only ends its own
+    ASSERT_EQ(12, duration.size());
+    EXPECT_EQ("05/11/2013 15:17:14,05/11/2013 15:23:15,analytics,2.09,cecil,00:06:01", duration.at(1));
+    EXPECT_EQ(duration.at(1), duration.at(2));
+    EXPECT_EQ("05/11/2013 15:28:06,05/12/2013 01:32:28,datavis,3.01,cecil,10:04:22", duration.at(10));
+    EXPECT_EQ("cecil,00:00:00,00:12:02,40:23:40", totalDuration.at(1));
+}
+
+TEST(PooledAnalysis, OnlyPoolsReportLogs)
+{
+    std::string isvLogPath = testInputDirectory + "/SampleLog_ISV.log";
+    std::string errorMessage;
+    try
+    {
+        LogData pooled({testInputDirectory + "/SampleLog_Report.log", isvLogPath}, "Site", testOutputDirectory);
+    }
+    catch (PoolFormatException& e)
+    {
+        errorMessage = e.what();
+    }
+    EXPECT_EQ("Only report logs can be pooled, and this isn't one: " + isvLogPath, errorMessage);
+}
+
+
 TEST(IntegrationTest, ExtraFiles)
 {
     std::string filePath;
@@ -389,3 +1343,139 @@ TEST(IntegrationTest, ExtraFiles)
         }
     }
 }
+
+
+TEST(BatchAnalysis, AnalyzesEachLogAndRecordsFailures)
+{
+    std::vector<std::string> inputPaths = {
+        testInputDirectory + "/SampleLog_Report.log",
+        testInputDirectory + "/SampleLog_ISV.log",
+        testInputDirectory + "/EventDataException.log",
+        testInputDirectory + "/Missing.log",
+        testInputDirectory + "/SampleLog_Report.log"
+    };
+    std::string outputDirectory = testOutputDirectory + "/Batch";
+
+    BatchOptions options;
+    options.threadCount = 3;
+    BatchAnalysis batchAnalysis(inputPaths, outputDirectory, options);
+    batchAnalysis.run();
+
+    const std::vector<BatchResult>& results = batchAnalysis.results();
+    ASSERT_EQ(5, results.size());
+    EXPECT_EQ(2, batchAnalysis.failureCount());
+
+    EXPECT_TRUE(results.at(0).succeeded);
+    EXPECT_EQ(outputDirectory + "/SampleLog_Report", results.at(0).outputDirectory);
+    EXPECT_TRUE(fileExists(outputDirectory + "/SampleLog_Report/SampleLog_Report_Summary.txt"));
+    EXPECT_TRUE(fileExists(outputDirectory + "/SampleLog_Report/SampleLog_Report_UsageDuration.csv"));
+
+    EXPECT_TRUE(results.at(1).succeeded);
+    EXPECT_TRUE(fileExists(outputDirectory + "/SampleLog_ISV/SampleLog_ISV_UsageOverTime.csv"));
+
+    EXPECT_FALSE(results.at(2).succeeded);
+    EXPECT_EQ("Missing data on line 15", results.at(2).errorMessage);
+    EXPECT_FALSE(results.at(3).succeeded);
+
+    // A second log with the same name gets its own directory
+    EXPECT_TRUE(results.at(4).succeeded);
+    EXPECT_EQ(outputDirectory + "/SampleLog_Report_2", results.at(4).outputDirectory);
+
+    batchAnalysis.writeReport(outputDirectory + "/BatchReport.csv");
+    std::vector<std::string> report;
+    loadDataFromFile(outputDirectory + "/BatchReport.csv", report);
+    ASSERT_EQ(7, report.size());
+    EXPECT_EQ("Log File,Output Directory,Result,Seconds,Error", report.at(0));
+}
+
+
+TEST(BatchAnalysis, ExpandsDirectories)
+{
+    BatchOptions options;
+    options.memoryBudget = 1;  // Forces the logs to run one at a time
+    BatchAnalysis batchAnalysis({testInputDirectory}, testOutputDirectory + "/BatchDirectory", options);
+    ASSERT_EQ(18, batchAnalysis.results().size());
+    batchAnalysis.run();
+    EXPECT_TRUE(batchAnalysis.results().at(0).seconds >= 0.0);
+    EXPECT_TRUE(fileExists(testOutputDirectory + "/BatchDirectory/NewYear/NewYear_Summary.txt"));
+}
+
+
+// A log that's over the memory budget by itself is read a segment at a time
+TEST(BatchAnalysis, SegmentsLogsOverTheBudget)
+{
+    std::string directory = testOutputDirectory + "/BatchSegmented";
+    std::string fullDirectory = directory + "/Full";
+    std::string logFilePath = directory + "/Segmented.log";
+    QDir().mkpath(fullDirectory.c_str());
+    writeSegmentedLog(logFilePath);
+
+    BatchOptions options;
+    options.memoryBudget = 1;
+    options.outputs = AllOutputs;
+    options.subdirectoryPerLog = false;
+    BatchAnalysis batchAnalysis({logFilePath}, directory + "/Results", options);
+    batchAnalysis.run();
+    ASSERT_EQ(0, batchAnalysis.failureCount());
+
+    LogData fullLogData(logFilePath, fullDirectory);
+    fullLogData.publishResults(AllOutputs);
+    compareResults("Segmented", directory + "/Results", fullDirectory);
+}
+
+
+TEST(BatchAnalysis, OverwritePolicies)
+{
+    std::string outputDirectory = testOutputDirectory + "/BatchOverwrite";
+    std::vector<std::string> inputPaths = {testInputDirectory + "/SampleLog_Report.log"};
+    BatchOptions options;
+    options.subdirectoryPerLog = false;
+    options.outputs = SummaryOutput;
+    QDir().mkpath(outputDirectory.c_str());
+
+    BatchAnalysis first(inputPaths, outputDirectory, options);
+    first.run();
+    ASSERT_TRUE(first.results().at(0).succeeded);
+    EXPECT_TRUE(fileExists(outputDirectory + "/SampleLog_Report_Summary.txt"));
+    EXPECT_FALSE(fileExists(outputDirectory + "/SampleLog_Report_UsageOverTime.csv"));
+
+    options.overwrite = SkipExisting;
+    BatchAnalysis skip(inputPaths, outputDirectory, options);
+    skip.run();
+    EXPECT_TRUE(skip.results().at(0).skipped);
+    EXPECT_EQ(0, skip.failureCount());
+
+    options.overwrite = FailOnExisting;
+    BatchAnalysis fail(inputPaths, outputDirectory, options);
+    fail.run();
+    EXPECT_EQ(1, fail.failureCount());
+    EXPECT_EQ("Output files already exist: " + outputDirectory + "/SampleLog_Report_Summary.txt",
+              fail.results().at(0).errorMessage);
+
+    // Existing results are found before the log is read, so one that wouldn't parse is skipped all the same
+    std::ofstream((outputDirectory + "/EventDataException_Summary.txt").c_str()).close();
+    options.overwrite = SkipExisting;
+    BatchAnalysis skipUnread({testInputDirectory + "/EventDataException.log"}, outputDirectory, options);
+    skipUnread.run();
+    EXPECT_TRUE(skipUnread.results().at(0).skipped);
+    EXPECT_EQ(0, skipUnread.failureCount());
+}
+
+
+TEST(BatchAnalysis, Pool)
+{
+    std::string outputDirectory = testOutputDirectory + "/BatchPool";
+    BatchOptions options;
+    options.poolName = "Site";
+    options.subdirectoryPerLog = false;
+    QDir().mkpath(outputDirectory.c_str());
+
+    BatchAnalysis batchAnalysis({testInputDirectory + "/SampleLog_Report.log", testInputDirectory + "/NewYear.log"},
+                                outputDirectory, options);
+    batchAnalysis.run();
+    ASSERT_EQ(1, batchAnalysis.results().size());
+    EXPECT_TRUE(batchAnalysis.results().at(0).succeeded);
+    EXPECT_EQ("Site", batchAnalysis.results().at(0).inputFilePath);
+    EXPECT_TRUE(fileExists(outputDirectory + "/Site_UsageDuration.csv"));
+}
+
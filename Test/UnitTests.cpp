@@ -16,10 +16,27 @@
 // along with RLM Log Reader.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "date/date.h"
+#include "AnalysisProfile.h"
+#include "AnalysisProgress.h"
+#include "BufferedWriter.h"
+#include "CommandLine.h"
+#include "ConcurrencyIndex.h"
+#include "DecompressingReader.h"
+#include "EventTable.h"
+#include "Exceptions.h"
 #include "LogData.h"
+#include "ParquetWriter.h"
+#include "StringTable.h"
+#include "TimestampParser.h"
+#include "Tokenizer.h"
+#include "UsageAggregator.h"
 #include "Utilities.h"
 #include "TestConfig.h"
 #include "gtest/gtest.h"
+#include <fstream>
+#include <memory>
+#include <random>
+#include <thread>
 
 
 void lineBreakTests(std::vector<std::string>& rawData)
@@ -68,6 +85,83 @@ TEST(loadDataFromFile, CannotFindFile)
 }
 
 
+TEST(splitIntoLines, StripsCarriageReturns)
+{
+    std::vector<std::string_view> lines;
+    splitIntoLines("First line\r\nSecond line\r\nThird line", lines);
+    ASSERT_EQ(3, lines.size());
+    EXPECT_EQ("First line", lines.at(0));
+    EXPECT_EQ("Second line", lines.at(1));
+    EXPECT_EQ("Third line", lines.at(2));
+}
+
+TEST(splitIntoLines, TrailingLineBreak)
+{
+    std::vector<std::string_view> lines;
+    splitIntoLines("First line\n", lines);
+    ASSERT_EQ(2, lines.size());
+    EXPECT_EQ("First line", lines.at(0));
+    EXPECT_EQ("", lines.at(1));
+}
+
+
+TEST(splitIntoChunks, EndsChunksAtLineBreaks)
+{
+    std::string data = "first line\nsecond\nthird line\nlast";
+    std::vector<std::string_view> chunks;
+    splitIntoChunks(data, 8, chunks);
+    ASSERT_EQ(3, chunks.size());
+    EXPECT_EQ("first line\n", chunks.at(0));
+    EXPECT_EQ("second\nthird line\n", chunks.at(1));
+    EXPECT_EQ("last", chunks.at(2));
+
+    splitIntoChunks("", 8, chunks);
+    ASSERT_EQ(1, chunks.size());
+    EXPECT_EQ("", chunks.at(0));
+}
+
+
+TEST(runInParallel, RunsEveryTaskAndRethrowsTheFirstError)
+{
+    std::vector<int> results(100, 0);
+    runInParallel(results.size(), 4, [&results](size_t task) { results.at(task) = static_cast<int>(task); });
+    for (size_t task=0; task < results.size(); ++task)
+    {
+        EXPECT_EQ(task, results.at(task));
+    }
+
+    std::string errorMessage;
+    try
+    {
+        runInParallel(10, 4, [](size_t task)
+        {
+            if (task == 3 || task == 7)
+            {
+                throw std::runtime_error("task " + std::to_string(task));
+            }
+        });
+    }
+    catch (std::exception& e)
+    {
+        errorMessage = e.what();
+    }
+    EXPECT_EQ("task 3", errorMessage);
+}
+
+
+TEST(getNextLine, StreamsEachLine)
+{
+    std::string_view data = "First line\r\nSecond line";
+    size_t position = 0;
+    std::string_view line;
+    ASSERT_TRUE(getNextLine(data, position, line));
+    EXPECT_EQ("First line", line);
+    ASSERT_TRUE(getNextLine(data, position, line));
+    EXPECT_EQ("Second line", line);
+    EXPECT_FALSE(getNextLine(data, position, line));
+}
+
+
 TEST(tokenizeString, Empty)
 {
     std::vector<std::string> tokenVector;
@@ -110,6 +204,48 @@ TEST(tokenizeString, IgnoreDelimitersBetweenQuotes)
 }
 
 
+void tokenizerMatchesTokenizeString(const std::string& line, char delimiter)
+{
+    std::vector<std::string> expected;
+    tokenizeString(std::string(1, delimiter), line, expected);
+
+    std::vector<std::string_view> tokens;
+    tokenizeLine(line, delimiter, tokens);
+    EXPECT_EQ(std::vector<std::string_view>(expected.begin(), expected.end()), tokens) << line;
+
+    tokenizeLineScalar(line, delimiter, tokens);
+    EXPECT_EQ(std::vector<std::string_view>(expected.begin(), expected.end()), tokens) << line;
+}
+TEST(tokenizeLine, MatchesTokenizeString)
+{
+    tokenizerMatchesTokenizeString("", ' ');
+    tokenizerMatchesTokenizeString(" I  am   Sam    ", ' ');
+    tokenizerMatchesTokenizeString("I@am@Sam", '@');
+    tokenizerMatchesTokenizeString("\"I am Sam\" \"Sam I am\"", ' ');
+    tokenizerMatchesTokenizeString("\"\"\"\" \"\"", ' ');
+    tokenizerMatchesTokenizeString("a\"b c\"d \"e\"f", ' ');
+
+    // Lines longer than one 64-byte block, with a quoted field straddling the boundary
+    tokenizerMatchesTokenizeString(std::string(61, ' ') + "\"quoted field\" " + std::string(70, 'x') + " end", ' ');
+}
+TEST(tokenizeLine, MatchesTokenizeStringOnReportLog)
+{
+    std::vector<std::string> rawData;
+    loadDataFromFile(testInputDirectory + "/SampleLog_Report.log", rawData);
+    for (const std::string& line : rawData)
+    {
+        tokenizerMatchesTokenizeString(line, ' ');
+    }
+}
+TEST(tokenizeLine, UnterminatedQuoteTakesRestOfLine)
+{
+    std::vector<std::string_view> tokens;
+    tokenizeLine("OUT \"no closing quote", ' ', tokens);
+    ASSERT_EQ(2, tokens.size());
+    EXPECT_EQ("no closing quote", tokens.at(1));
+}
+
+
 TEST(parseDataVector, Simple)
 {
     std::vector<std::string> rawData;
@@ -160,6 +296,296 @@ TEST(getUniqueItems, NewItemIsUnique)
 }
 
 
+TEST(StringTable, KeepsFirstSeenOrder)
+{
+    StringTable stringTable;
+    EXPECT_EQ(0, stringTable.add("spoon"));
+    EXPECT_EQ(1, stringTable.add("fork"));
+    EXPECT_EQ(0, stringTable.add("spoon"));
+    ASSERT_EQ(2, stringTable.size());
+    EXPECT_EQ("spoon", stringTable.at(0));
+    EXPECT_EQ("fork", stringTable.at(1));
+}
+
+TEST(StringTable, FindDoesNotAdd)
+{
+    StringTable stringTable;
+    stringTable.add("spoon");
+    EXPECT_EQ(0, stringTable.find("spoon"));
+    EXPECT_EQ(StringTable::NotFound, stringTable.find("knife"));
+    EXPECT_EQ(1, stringTable.size());
+}
+
+
+TEST(EventTable, TextIsStoredOnce)
+{
+    EventTable eventTable;
+    uint32_t first = eventTable.addText("simulator");
+    uint32_t second = eventTable.addText("analytics");
+    EXPECT_NE(first, second);
+    EXPECT_EQ(first, eventTable.addText("simulator"));
+    EXPECT_EQ("analytics", eventTable.text(second));
+}
+
+TEST(EventTable, AppendTranslatesTextIds)
+{
+    EventTable eventTable;
+    size_t row = eventTable.addEvent(OutEvent);
+    eventTable.product.at(row) = eventTable.addText("analytics");
+
+    EventTable other;
+    row = other.addEvent(InEvent);
+    other.user.at(row) = other.addText("cecil");
+    other.product.at(row) = other.addText("analytics");
+
+    eventTable.append(other);
+    ASSERT_EQ(2, eventTable.size());
+    EXPECT_EQ(InEvent, eventTable.type.at(1));
+    EXPECT_EQ("analytics", eventTable.text(eventTable.product.at(1)));
+    EXPECT_EQ(eventTable.product.at(0), eventTable.product.at(1));
+    EXPECT_EQ("cecil", eventTable.text(eventTable.user.at(1)));
+    EXPECT_EQ(EventTable::NoText, eventTable.handle.at(1));
+}
+
+TEST(EventTable, AddEventFillsEveryColumn)
+{
+    EventTable eventTable;
+    size_t row = eventTable.addEvent(OutEvent);
+    ASSERT_EQ(1, eventTable.size());
+    EXPECT_EQ(OutEvent, eventTable.type.at(row));
+    EXPECT_EQ(0, eventTable.count.at(row));
+    EXPECT_EQ(EventTable::NoText, eventTable.handle.at(row));
+    EXPECT_STREQ("OUT", eventTypeName(eventTable.type.at(row)));
+}
+
+
+
+TEST(BufferedWriter, WritesTextAndNumbers)
+{
+    std::string filePath = testOutputDirectory + "/BufferedWriter.txt";
+    BufferedWriter writer(filePath);
+    writer.write("Licenses in use,");
+    writer.writeNumber(size_t{18446744073709551615u});
+    writer.write(',');
+    writer.writeNumber(-42);
+    writer.write('\n');
+    EXPECT_EQ(41, writer.position());
+
+    // Bigger than the buffer, so it goes straight to the file
+    writer.write(std::string(3 << 20, 'x'));
+    writer.close();
+
+    BufferedWriter appender(filePath, true);
+    appender.write("\nlast");
+    appender.close();
+
+    std::vector<std::string> lines;
+    loadDataFromFile(filePath, lines);
+    ASSERT_EQ(3, lines.size());
+    EXPECT_EQ("Licenses in use,18446744073709551615,-42", lines.at(0));
+    EXPECT_EQ(3 << 20, lines.at(1).size());
+    EXPECT_EQ("last", lines.at(2));
+}
+
+TEST(BufferedWriter, CannotOpenFile)
+{
+    std::string filePath = testOutputDirectory + "/DirectoryThatDoesNotExist/BufferedWriter.txt";
+    std::string errorMessage;
+    try
+    {
+        BufferedWriter writer(filePath);
+    }
+    catch (std::exception& e)
+    {
+        errorMessage = e.what();
+    }
+    EXPECT_EQ("Unable to open file: " + filePath, errorMessage);
+}
+
+
+TEST(ParquetWriter, WritesRowGroupsBetweenMagicNumbers)
+{
+    std::string filePath = testOutputDirectory + "/ParquetWriter.parquet";
+    ParquetWriter writer(filePath, {{"product", ParquetString, false}, {"count", ParquetInt32, true}}, 2);
+    for (int row = 0; row < 5; ++row)
+    {
+        writer.addString(0, row < 3 ? 0 : 1, row < 3 ? "simulator" : "datavis");
+        if (row == 1)
+        {
+            writer.addNull(1);
+        }
+        else
+        {
+            writer.addNumber(1, row);
+        }
+        writer.endRow();
+    }
+    writer.close();
+
+    std::ifstream inputFile(filePath.c_str(), std::ios::binary);
+    std::string contents((std::istreambuf_iterator<char>(inputFile)), std::istreambuf_iterator<char>());
+    ASSERT_LT(12, contents.size());
+    EXPECT_EQ("PAR1", contents.substr(0, 4));
+    EXPECT_EQ("PAR1", contents.substr(contents.size() - 4));
+
+    // Three row groups, with the footer after the last one naming the columns
+    const unsigned char* length = reinterpret_cast<const unsigned char*>(contents.data() + contents.size() - 8);
+    size_t footerLength = length[0] | (length[1] << 8) | (length[2] << 16) | (size_t(length[3]) << 24);
+    ASSERT_LT(footerLength, contents.size() - 12);
+    std::string footer = contents.substr(contents.size() - 8 - footerLength, footerLength);
+    EXPECT_NE(std::string::npos, footer.find("product"));
+    EXPECT_NE(std::string::npos, footer.find("count"));
+}
+
+
+std::string readTestFile(const std::string& fileName)
+{
+    std::ifstream inputFile((testInputDirectory + "/" + fileName).c_str(), std::ios::binary);
+    return std::string((std::istreambuf_iterator<char>(inputFile)), std::istreambuf_iterator<char>());
+}
+
+TEST(DecompressingReader, DetectsCompressionFromMagicBytes)
+{
+    EXPECT_EQ(GzipCompressed, detectCompression(readTestFile("SampleLog_Report.log.gz")));
+    EXPECT_EQ(ZstdCompressed, detectCompression(readTestFile("SampleLog_ISV.log.zst")));
+    EXPECT_EQ(Uncompressed, detectCompression(readTestFile("SampleLog_Report.log")));
+    EXPECT_EQ(Uncompressed, detectCompression(std::string("\x1f")));
+}
+
+TEST(DecompressingReader, ReadsConcatenatedMembersAsOneStream)
+{
+    std::string member = readTestFile("SampleLog_Report.log.gz");
+    std::string members = member + member;
+    std::string log = readTestFile("SampleLog_Report.log");
+
+    // A one-byte buffer makes the decompressing thread wait for each block to be read
+    DecompressingReader reader(members, GzipCompressed, 1);
+    std::string decompressed;
+    std::string block;
+    while (reader.read(block))
+    {
+        decompressed.append(block);
+    }
+    EXPECT_EQ(log + log, decompressed);
+}
+
+TEST(DecompressingReader, ReportsDamagedData)
+{
+    std::string compressed = readTestFile("SampleLog_ISV.log.zst");
+    DecompressingReader reader(std::string_view(compressed).substr(0, compressed.size() - 10), ZstdCompressed);
+    std::string errorMessage;
+    try
+    {
+        std::string block;
+        while (reader.read(block))
+        {
+        }
+    }
+    catch (DecompressionException& e)
+    {
+        errorMessage = e.what();
+    }
+    EXPECT_EQ("Unable to decompress the log: the zstd data ends part way through", errorMessage);
+}
+
+
+TEST(ConcurrencyIndex, AnswersPointAndRangeQueries)
+{
+    // 2 in use from 100, 5 for an instant at 200, then 1 until 300, and 3 after a step
+    // logged out of order
+    ConcurrencyIndex index(0, {{100, 2}, {200, 5}, {200, 1}, {300, 0}, {250, 3}});
+
+    EXPECT_EQ(0, index.usageAt(99));
+    EXPECT_EQ(2, index.usageAt(100));
+    EXPECT_EQ(1, index.usageAt(200));
+    EXPECT_EQ(3, index.usageAt(1000));
+
+    EXPECT_EQ(2, index.peak(0, 199));
+    EXPECT_EQ(5, index.peak(150, 200));
+    EXPECT_EQ(1, index.peak(201, 299));
+    EXPECT_EQ(3, index.peak(201, 300));
+
+    EXPECT_DOUBLE_EQ(2.0, index.average(100, 200));
+    EXPECT_DOUBLE_EQ(1.5, index.average(150, 250));
+    EXPECT_DOUBLE_EQ(1.0, index.average(0, 200));
+    EXPECT_DOUBLE_EQ(3.0, index.average(300, 400));
+    EXPECT_DOUBLE_EQ(1.0, index.average(250, 250));
+}
+
+TEST(ConcurrencyIndex, MatchesScanningTheSteps)
+{
+    std::mt19937 random(20);
+    std::vector<UsageStep> steps;
+    int64_t time = 1000;
+    for (size_t step=0; step < 1000; ++step)
+    {
+        time += random() % 4;
+        steps.push_back({time, static_cast<int64_t>(random() % 50)});
+    }
+    ConcurrencyIndex index(7, steps);
+
+    for (size_t query=0; query < 200; ++query)
+    {
+        int64_t from = 900 + random() % 1700;
+        int64_t to = from + random() % 300;
+
+        // The peak starts from the usage after every step up to and including from
+        int64_t peak = 7;
+        int64_t usage = 7;
+        int64_t area = 0;
+        for (size_t step=0; step <= steps.size(); ++step)
+        {
+            // Usage holds from each step until the next, or the end of the query
+            int64_t start = (step == 0) ? from : steps.at(step - 1).time;
+            int64_t end = (step == steps.size()) ? to : steps.at(step).time;
+            area += usage * std::max<int64_t>(0, std::min(end, to) - std::max(start, from));
+            if (step == steps.size() || steps.at(step).time > to)
+            {
+                break;
+            }
+            usage = steps.at(step).inUse;
+            peak = (steps.at(step).time <= from) ? usage : std::max(peak, usage);
+        }
+        for (const UsageStep& step : steps)
+        {
+            if (step.time >= from && step.time <= to)
+            {
+                peak = std::max(peak, step.inUse);
+            }
+        }
+
+        EXPECT_EQ(peak, index.peak(from, to)) << from << " " << to;
+        if (to > from)
+        {
+            EXPECT_NEAR(static_cast<double>(area) / (to - from), index.average(from, to), 1e-9) << from << " " << to;
+        }
+    }
+}
+
+
+TEST(UsageAggregator, WeeksStartOnMondayAndTimeNeverRunsBackwards)
+{
+    std::string filePath = testOutputDirectory + "/UsageAggregator.csv";
+    BufferedWriter writer(filePath);
+    UsageAggregator aggregator(PerWeek);
+
+    aggregator.advance(1368619200, writer);     // Wednesday 05/15/2013 12:00
+    aggregator.setUsage("simulator", 2, 1);
+    aggregator.advance(1369029600, writer);     // Monday 05/20/2013 06:00
+    aggregator.setUsage("simulator", 0, 0);
+    aggregator.advance(1369004400, writer);     // Sunday 05/19/2013 23:00, counted as Monday 06:00
+    aggregator.addDenial("simulator");
+    aggregator.writeCurrentPeriod(1369051200, writer);     // Monday 05/20/2013 12:00
+    writer.close();
+
+    std::vector<std::string> lines;
+    loadDataFromFile(filePath, lines);
+    ASSERT_EQ(3, lines.size());
+    EXPECT_EQ("05/13/2013 00:00,simulator,2,2.00,0,1,1.00,0,0", lines.at(0));
+    EXPECT_EQ("05/20/2013 00:00,simulator,2,1.00,0,1,0.50,0,1", lines.at(1));
+    EXPECT_EQ("", lines.at(2));
+}
+
 TEST(durationToHHMMSS, OneSecond)
 {
     auto duration = std::chrono::seconds{1};
@@ -212,11 +638,45 @@ TEST(stringToTime, HoursMinutes)
 }
 
 
+TEST(TimestampParser, MatchesStringToTime)
+{
+    TimestampParser timestampParser;
+    const std::vector<std::pair<std::string, std::string>> timestamps = {
+        {"05/11/2012", "17:34:48"},
+        {"05/11/2012", "17:34"},
+        {"05/11/2012", "5:07:09"},
+        {"12/31/2013", "23:59:59"},
+        {"01/01/2014", "00:00:00"},
+        {"02/29/2016", "12:00:00"}
+    };
+
+    for (const auto& timestamp : timestamps)
+    {
+        auto expected = date::floor<std::chrono::seconds>(stringToTime(timestamp.first, timestamp.second));
+        EXPECT_EQ(expected, timestampParser.parse(timestamp.first, timestamp.second))
+            << timestamp.first << " " << timestamp.second;
+    }
+}
+
+TEST(TimestampParser, FallsBackOnUnexpectedLayout)
+{
+    TimestampParser timestampParser;
+    std::string dateString = "5/11/2012";
+    std::string timeString = "17:34:48.5";
+    auto expected = date::floor<std::chrono::seconds>(stringToTime(dateString, timeString));
+    EXPECT_EQ(expected, timestampParser.parse(dateString, timeString));
+}
+
+
 TEST(getFileNamesInDirectory, works)
 {
     std::vector<std::string> fileList;
     getFileListInDirectory(testInputDirectory, fileList);
-    ASSERT_EQ(16, fileList.size());
+    ASSERT_EQ(18, fileList.size());
+    for (const std::string& filePath : fileList)
+    {
+        EXPECT_TRUE(fileExists(filePath)) << filePath;
+    }
 }
 
 
@@ -267,3 +727,239 @@ TEST(fileExists, False)
     std::string filePath = testInputDirectory + "/TestFileThatDoesNotExist.txt";
     EXPECT_FALSE(fileExists(filePath));
 }
+
+TEST(peakMemoryUsage, CoversMemoryInUse)
+{
+    const size_t size = 64 << 20;
+    std::vector<char> memory(size, 1);
+    EXPECT_GE(peakMemoryUsage(), size);
+    EXPECT_EQ(1, memory.back());
+}
+
+
+TEST(AnalysisProfile, MeasuresNothingUntilEnabled)
+{
+    AnalysisProfile profile;
+    {
+        StageTimer stageTimer(profile, ExtractStage);
+        profile.addCounts(ExtractStage, 10, 5, 100);
+        profile.addTime(TokenizeStage, std::chrono::milliseconds(1));
+    }
+    EXPECT_EQ(0, profile.stage(ExtractStage).runs);
+    EXPECT_EQ(0, profile.stage(ExtractStage).lines);
+    EXPECT_EQ(0, profile.stage(TokenizeStage).wallTime.count());
+}
+
+TEST(AnalysisProfile, MeasuresStagesWhileEnabled)
+{
+    AnalysisProfile profile;
+    profile.enable();
+    for (int run=0; run < 2; ++run)
+    {
+        StageTimer stageTimer(profile, ConcurrencyStage);
+        std::vector<std::unique_ptr<int>> allocated;
+        for (int allocation=0; allocation < 100; ++allocation)
+        {
+            allocated.push_back(std::make_unique<int>(allocation));
+        }
+        profile.addCounts(ConcurrencyStage, 0, 100);
+    }
+    const StageProfile& concurrency = profile.stage(ConcurrencyStage);
+    EXPECT_EQ(2, concurrency.runs);
+    EXPECT_EQ(200, concurrency.events);
+    EXPECT_GE(concurrency.allocations, 200);
+    EXPECT_GT(concurrency.wallTime.count(), 0);
+    EXPECT_GT(concurrency.peakMemory, 0);
+    EXPECT_EQ(0, profile.stage(PublishStage).runs);
+    EXPECT_STREQ("concurrency", AnalysisProfile::stageName(ConcurrencyStage));
+}
+
+
+// Keeps every report it's given
+class RecordedProgress : public AnalysisProgress
+{
+    public:
+        RecordedProgress() : AnalysisProgress(std::chrono::milliseconds(0)) {}
+        std::vector<StageProgress> reports;
+    protected:
+        void progressed(const StageProgress& progress) override
+        {
+            reports.push_back(progress);
+        }
+};
+
+TEST(AnalysisProgress, AddsUpAdvancesFromEveryThread)
+{
+    RecordedProgress progress;
+    progress.startStage(ExtractStage, 4000, 0);
+    std::vector<std::thread> threads;
+    for (int thread=0; thread < 4; ++thread)
+    {
+        threads.emplace_back([&progress]()
+        {
+            for (int advance=0; advance < 100; ++advance)
+            {
+                progress.advance(10, 1);
+            }
+        });
+    }
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+    progress.finishStage();
+
+    ASSERT_EQ(402, progress.reports.size());
+    EXPECT_EQ(0, progress.reports.front().bytes);
+    const StageProgress& finished = progress.reports.back();
+    EXPECT_EQ(ExtractStage, finished.stage);
+    EXPECT_TRUE(finished.finished);
+    EXPECT_EQ(4000, finished.bytes);
+    EXPECT_EQ(4000, finished.totalBytes);
+    EXPECT_EQ(400, finished.events);
+}
+
+TEST(AnalysisProgress, ThrowsOnceCancelled)
+{
+    RecordedProgress progress;
+    progress.startStage(ConcurrencyStage, 0, 10);
+    progress.advance(0, 5);
+    EXPECT_FALSE(progress.cancelled());
+    progress.cancel();
+    EXPECT_TRUE(progress.cancelled());
+    EXPECT_THROW(progress.advance(0, 5), AnalysisCancelledException);
+    EXPECT_THROW(progress.startStage(DurationStage, 0, 10), AnalysisCancelledException);
+    EXPECT_EQ(5, progress.reports.back().events);
+}
+
+
+TEST(parseCommandLine, ReadsEveryOption)
+{
+    CommandLineOptions options;
+    parseCommandLine({"-o", "results", "--overwrite", "skip", "--outputs", "summary,events,period",
+                      "--period", "day", "-j", "4", "--report", "report.csv", "--incremental", "a.log", "logs"}, options);
+    EXPECT_EQ("results", options.outputDirectory);
+    EXPECT_EQ(SkipExisting, options.overwrite);
+    EXPECT_EQ(SummaryOutput | EventDataOutput | UsageByPeriodOutput, options.outputs);
+    EXPECT_EQ(PerDay, options.period);
+    EXPECT_EQ(4, options.threadCount);
+    EXPECT_EQ("report.csv", options.reportPath);
+    EXPECT_TRUE(options.incremental);
+    ASSERT_EQ(2, options.inputPaths.size());
+    EXPECT_EQ("a.log", options.inputPaths.at(0));
+    EXPECT_EQ("logs", options.inputPaths.at(1));
+    EXPECT_FALSE(options.help);
+}
+
+TEST(parseCommandLine, Defaults)
+{
+    CommandLineOptions options;
+    parseCommandLine({"--output", "results", "a.log"}, options);
+    EXPECT_EQ(FailOnExisting, options.overwrite);
+    EXPECT_EQ(StandardOutputs, options.outputs);
+    EXPECT_EQ(PerHour, options.period);
+    EXPECT_EQ(0, options.threadCount);
+    EXPECT_FALSE(options.incremental);
+    EXPECT_FALSE(options.cache);
+}
+
+TEST(parseCommandLine, UsageChanges)
+{
+    CommandLineOptions options;
+    parseCommandLine({"-o", "results", "--outputs", "summary,usage-changes", "a.log"}, options);
+    EXPECT_EQ(SummaryOutput | UsageOverTimeOutput | SparseUsageOverTime, options.outputs);
+}
+
+void commandLineErrorTest(const std::vector<std::string>& arguments, const std::string& expectedError)
+{
+    CommandLineOptions options;
+    std::string errorMessage;
+    try
+    {
+        parseCommandLine(arguments, options);
+    }
+    catch (std::exception& e)
+    {
+        errorMessage = e.what();
+    }
+    EXPECT_EQ("Invalid command line: " + expectedError, errorMessage);
+}
+TEST(parseCommandLine, RejectsBadArguments)
+{
+    commandLineErrorTest({"a.log"}, "no output directory given");
+    commandLineErrorTest({"-o", "results"}, "no log files given");
+    commandLineErrorTest({"a.log", "-o"}, "-o needs a value");
+    commandLineErrorTest({"-o", "results", "--outputs", "graphs", "a.log"}, "unknown output 'graphs'");
+    commandLineErrorTest({"-o", "results", "--period", "fortnight", "a.log"}, "unknown period 'fortnight'");
+    commandLineErrorTest({"-o", "results", "--overwrite", "maybe", "a.log"}, "unknown overwrite policy 'maybe'");
+    commandLineErrorTest({"-o", "results", "-j", "many", "a.log"}, "thread count 'many' isn't a number");
+    commandLineErrorTest({"-o", "results", "--verbose", "a.log"}, "unknown option '--verbose'");
+    commandLineErrorTest({"-o", "results", "--flush-interval", "-1", "a.log"}, "flush interval '-1' isn't a number");
+    commandLineErrorTest({"-o", "results", "--follow", "a.log", "b.log"}, "--follow takes a single log file");
+    commandLineErrorTest({"-o", "results", "--cache", "--follow", "a.log"},
+                         "--cache can't be used with --incremental or --follow");
+    commandLineErrorTest({"-o", "results", "--outputs", "parquet", "--incremental", "a.log"},
+                         "parquet can't be used with --incremental or --follow");
+    commandLineErrorTest({"--at", "03/31/2013", "a.log"}, "'03/31/2013' isn't a time like 03/31/2013 14:05");
+    commandLineErrorTest({"--between", "03/31/2013 14:05", "a.log"}, "--between takes two times separated by a comma");
+    commandLineErrorTest({"--between", "03/31/2013 14:05,03/30/2013 14:05", "a.log"},
+                         "'03/31/2013 14:05,03/30/2013 14:05' ends before it starts");
+    commandLineErrorTest({"--at", "03/31/2013 14:05", "--cache", "a.log"}, "no output directory given");
+    commandLineErrorTest({"-o", "results", "--product", "simulator", "a.log"}, "--product needs --at or --between");
+    commandLineErrorTest({"-o", "results", "--pool", "site", "--cache", "a.log", "b.log"},
+                         "--pool can't be used with --incremental, --cache or --follow");
+}
+
+TEST(parseCommandLine, Follow)
+{
+    CommandLineOptions options;
+    parseCommandLine({"--follow", "--flush-interval", "5", "-o", "results", "a.log"}, options);
+    EXPECT_TRUE(options.follow);
+    EXPECT_EQ(5, options.flushInterval);
+}
+
+TEST(parseCommandLine, Cache)
+{
+    CommandLineOptions options;
+    parseCommandLine({"--cache", "-o", "results", "a.log"}, options);
+    EXPECT_TRUE(options.cache);
+}
+
+TEST(parseCommandLine, Parquet)
+{
+    CommandLineOptions options;
+    parseCommandLine({"--outputs", "summary,parquet", "-o", "results", "a.log"}, options);
+    EXPECT_EQ(SummaryOutput | EventParquetOutput | DurationParquetOutput, options.outputs);
+}
+
+TEST(parseCommandLine, Pool)
+{
+    CommandLineOptions options;
+    parseCommandLine({"--pool", "site", "-o", "results", "a.log", "b.log"}, options);
+    EXPECT_EQ("site", options.poolName);
+    EXPECT_EQ(2, options.inputPaths.size());
+}
+
+TEST(parseCommandLine, Queries)
+{
+    CommandLineOptions at;
+    parseCommandLine({"--at", "03/31/2013 14:05", "a.log"}, at);
+    EXPECT_TRUE(at.query);
+    EXPECT_FALSE(at.queryRange);
+    EXPECT_EQ(1364738700, at.queryFrom);
+
+    CommandLineOptions between;
+    parseCommandLine({"--between", "03/31/2013 14:05,03/31/2013 14:05:30", "--product", "simulator", "a.log"}, between);
+    EXPECT_TRUE(between.queryRange);
+    EXPECT_EQ(1364738700, between.queryFrom);
+    EXPECT_EQ(1364738730, between.queryTo);
+    EXPECT_EQ("simulator", between.queryProduct);
+}
+
+TEST(parseCommandLine, Help)
+{
+    CommandLineOptions options;
+    parseCommandLine({"--help"}, options);
+    EXPECT_TRUE(options.help);
+}
+
@@ -0,0 +1,126 @@
+// Copyright 2014 Steve Robinson
+//
+// This file is part of RLM Log Reader.
+//
+// RLM Log Reader is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// RLM Log Reader is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with RLM Log Reader.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "TimestampParser.h"
+#include "Utilities.h"
+
+
+namespace
+{
+    // Reads between minDigits and maxDigits decimal digits starting at position
+    bool readNumber(std::string_view text, size_t& position, size_t minDigits, size_t maxDigits, int& value)
+    {
+        size_t digits = 0;
+        value = 0;
+        while (position < text.size() && digits < maxDigits &&
+               text[position] >= '0' && text[position] <= '9')
+        {
+            value = value*10 + (text[position] - '0');
+            ++position;
+            ++digits;
+        }
+        return digits >= minDigits;
+    }
+
+
+    bool readSeparator(std::string_view text, size_t& position, char separator)
+    {
+        if (position < text.size() && text[position] == separator)
+        {
+            ++position;
+            return true;
+        }
+        return false;
+    }
+}
+
+
+TimestampParser::TimestampParser()
+    : m_cachedDayStart()
+{
+}
+
+
+date::sys_seconds TimestampParser::parse(std::string_view dateString, std::string_view timeString)
+{
+    date::sys_seconds dayStart;
+    int hours = 0;
+    int minutes = 0;
+    int seconds = 0;
+    size_t position = 0;
+
+    bool valid = parseDate(dateString, dayStart) &&
+                 readNumber(timeString, position, 1, 2, hours) && hours < 24 &&
+                 readSeparator(timeString, position, ':') &&
+                 readNumber(timeString, position, 1, 2, minutes) && minutes < 60;
+
+    // Seconds are optional, DENY events only log hours and minutes
+    if (valid && position < timeString.size())
+    {
+        valid = readSeparator(timeString, position, ':') &&
+                readNumber(timeString, position, 1, 2, seconds) && seconds < 60 &&
+                position == timeString.size();
+    }
+
+    if (!valid)
+    {
+        return std::chrono::time_point_cast<std::chrono::seconds>(
+            stringToTime(std::string(dateString), std::string(timeString)));
+    }
+
+    return dayStart + std::chrono::hours{hours} + std::chrono::minutes{minutes} + std::chrono::seconds{seconds};
+}
+
+
+bool TimestampParser::parseDate(std::string_view dateString, date::sys_seconds& dayStart)
+{
+    if (!m_cachedDate.empty() && dateString == m_cachedDate)
+    {
+        dayStart = m_cachedDayStart;
+        return true;
+    }
+
+    int month = 0;
+    int day = 0;
+    int year = 0;
+    size_t position = 0;
+
+    if (!readNumber(dateString, position, 1, 2, month) ||
+        !readSeparator(dateString, position, '/') ||
+        !readNumber(dateString, position, 1, 2, day) ||
+        !readSeparator(dateString, position, '/') ||
+        !readNumber(dateString, position, 4, 4, year) ||
+        position != dateString.size())
+    {
+        return false;
+    }
+
+    date::year_month_day yearMonthDay{date::year{year},
+                                      date::month{static_cast<unsigned>(month)},
+                                      date::day{static_cast<unsigned>(day)}};
+    if (!yearMonthDay.ok())
+    {
+        return false;
+    }
+
+    dayStart = date::sys_days{yearMonthDay};
+
+    // assign() reuses the string's buffer, so the cache doesn't allocate once it's warm
+    m_cachedDate.assign(dateString);
+    m_cachedDayStart = dayStart;
+    return true;
+}
@@ -0,0 +1,39 @@
+// Copyright 2014 Steve Robinson
+//
+// This file is part of RLM Log Reader.
+//
+// RLM Log Reader is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// RLM Log Reader is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with RLM Log Reader.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include "date/date.h"
+
+
+// Allocation-free parser for the fixed "MM/DD/YYYY" and "HH:MM[:SS]" timestamps in
+// report logs.  Events arrive in date order, so the start of the last day parsed is
+// cached and a run of events on the same date skips the calendar math.  Anything the
+// fast path doesn't recognize is handed to stringToTime, so results always match it.
+class TimestampParser
+{
+    public:
+        TimestampParser();
+        date::sys_seconds parse(std::string_view dateString, std::string_view timeString);
+    private:
+        bool parseDate(std::string_view dateString, date::sys_seconds& dayStart);
+
+        std::string m_cachedDate;
+        date::sys_seconds m_cachedDayStart;
+};
@@ -0,0 +1,296 @@
+// Copyright 2014 Steve Robinson
+//
+// This file is part of RLM Log Reader.
+//
+// RLM Log Reader is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// RLM Log Reader is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with RLM Log Reader.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "Tokenizer.h"
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RLM_TOKENIZER_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define RLM_TARGET_AVX2 __attribute__((target("avx2")))
+#define RLM_TARGET_SSE2 __attribute__((target("sse2")))
+#else
+#define RLM_TARGET_AVX2
+#define RLM_TARGET_SSE2
+#endif
+
+
+namespace
+{
+    const size_t BlockSize = 64;
+
+    // One bit per byte of a 64-byte block
+    struct BlockMasks
+    {
+        uint64_t delimiters;
+        uint64_t quotes;
+    };
+
+    typedef BlockMasks (*ClassifyFunction)(const char* block, char delimiter);
+
+
+    BlockMasks classifyScalar(const char* block, char delimiter)
+    {
+        BlockMasks masks = {0, 0};
+        for (size_t i=0; i < BlockSize; ++i)
+        {
+            masks.delimiters |= static_cast<uint64_t>(block[i] == delimiter) << i;
+            masks.quotes |= static_cast<uint64_t>(block[i] == '"') << i;
+        }
+        return masks;
+    }
+
+
+#ifdef RLM_TOKENIZER_X86
+    RLM_TARGET_SSE2 BlockMasks classifySSE2(const char* block, char delimiter)
+    {
+        const __m128i delimiterVector = _mm_set1_epi8(delimiter);
+        const __m128i quoteVector = _mm_set1_epi8('"');
+        BlockMasks masks = {0, 0};
+        for (size_t offset=0; offset < BlockSize; offset += 16)
+        {
+            __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + offset));
+            uint64_t delimiterBits = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, delimiterVector)));
+            uint64_t quoteBits = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, quoteVector)));
+            masks.delimiters |= delimiterBits << offset;
+            masks.quotes |= quoteBits << offset;
+        }
+        return masks;
+    }
+
+
+    RLM_TARGET_AVX2 BlockMasks classifyAVX2(const char* block, char delimiter)
+    {
+        const __m256i delimiterVector = _mm256_set1_epi8(delimiter);
+        const __m256i quoteVector = _mm256_set1_epi8('"');
+        BlockMasks masks = {0, 0};
+        for (size_t offset=0; offset < BlockSize; offset += 32)
+        {
+            __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + offset));
+            uint64_t delimiterBits = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, delimiterVector)));
+            uint64_t quoteBits = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, quoteVector)));
+            masks.delimiters |= delimiterBits << offset;
+            masks.quotes |= quoteBits << offset;
+        }
+        return masks;
+    }
+
+
+    bool cpuSupportsAVX2()
+    {
+#ifdef _MSC_VER
+        // AVX2 needs both the instructions and an OS that saves the YMM registers
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7)
+        {
+            return false;
+        }
+        __cpuid(info, 1);
+        const bool osSavesYMM = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 &&
+                                (_xgetbv(0) & 0x6) == 0x6;
+        __cpuidex(info, 7, 0);
+        return osSavesYMM && (info[1] & (1 << 5)) != 0;
+#else
+        return __builtin_cpu_supports("avx2");
+#endif
+    }
+#endif
+
+
+    struct Kernel
+    {
+        ClassifyFunction classify;
+        const char* name;
+    };
+
+
+    // Picked once, the first time a line is tokenized
+    const Kernel& selectedKernel()
+    {
+        static const Kernel kernel = []()
+        {
+#ifdef RLM_TOKENIZER_X86
+            if (cpuSupportsAVX2())
+            {
+                return Kernel{classifyAVX2, "AVX2"};
+            }
+            return Kernel{classifySSE2, "SSE2"};
+#else
+            return Kernel{classifyScalar, "Scalar"};
+#endif
+        }();
+        return kernel;
+    }
+
+
+    unsigned countTrailingZeros(uint64_t bits)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        return static_cast<unsigned>(__builtin_ctzll(bits));
+#elif defined(_MSC_VER) && defined(_M_X64)
+        unsigned long index;
+        _BitScanForward64(&index, bits);
+        return index;
+#else
+        unsigned long index;
+        if (_BitScanForward(&index, static_cast<unsigned long>(bits)))
+        {
+            return index;
+        }
+        _BitScanForward(&index, static_cast<unsigned long>(bits >> 32));
+        return index + 32;
+#endif
+    }
+
+
+    // Walks a line block by block, keeping the masks of the current block around so
+    // consecutive searches within it don't classify the bytes again
+    class BlockScanner
+    {
+        public:
+            BlockScanner(std::string_view line, char delimiter, ClassifyFunction classify)
+                : m_line(line),
+                  m_delimiter(delimiter),
+                  m_classify(classify),
+                  m_blockStart(SIZE_MAX),
+                  m_masks{0, 0}
+            {
+            }
+
+            // Position of the first delimiter at or after position, or the line size
+            size_t findDelimiter(size_t position) { return find(position, false, true); }
+
+            // Position of the first byte that isn't a delimiter, or the line size
+            size_t findNonDelimiter(size_t position) { return find(position, false, false); }
+
+            // Position of the first double quote at or after position, or the line size
+            size_t findQuote(size_t position) { return find(position, true, true); }
+        private:
+            size_t find(size_t position, bool quotes, bool wantSet)
+            {
+                while (position < m_line.size())
+                {
+                    size_t blockStart = position - position % BlockSize;
+                    if (blockStart != m_blockStart)
+                    {
+                        loadBlock(blockStart);
+                    }
+
+                    uint64_t bits = quotes ? m_masks.quotes : m_masks.delimiters;
+                    if (!wantSet)
+                    {
+                        bits = ~bits;
+                    }
+                    bits &= ~uint64_t(0) << (position - blockStart);
+
+                    if (bits != 0)
+                    {
+                        size_t found = blockStart + countTrailingZeros(bits);
+                        return found < m_line.size() ? found : m_line.size();
+                    }
+                    position = blockStart + BlockSize;
+                }
+                return m_line.size();
+            }
+
+            void loadBlock(size_t blockStart)
+            {
+                m_blockStart = blockStart;
+                if (blockStart + BlockSize <= m_line.size())
+                {
+                    m_masks = m_classify(m_line.data() + blockStart, m_delimiter);
+                }
+                else
+                {
+                    // Copy the tail of the line so the vector loads don't read past its end.
+                    // Bits past the end are clamped away by find().
+                    char tail[BlockSize] = {};
+                    std::memcpy(tail, m_line.data() + blockStart, m_line.size() - blockStart);
+                    m_masks = m_classify(tail, m_delimiter);
+                }
+            }
+
+            std::string_view m_line;
+            char m_delimiter;
+            ClassifyFunction m_classify;
+            size_t m_blockStart;
+            BlockMasks m_masks;
+    };
+
+
+    void tokenize(std::string_view line, char delimiter, std::vector<std::string_view>& tokens,
+                  ClassifyFunction classify)
+    {
+        tokens.clear();
+        BlockScanner scanner(line, delimiter, classify);
+        size_t position = 0;
+
+        while (true)
+        {
+            size_t startPos = scanner.findNonDelimiter(position);
+            if (startPos == line.size())
+            {
+                break;
+            }
+
+            if (line[startPos] == '"')
+            {
+                // Quoted fields run to the closing quote regardless of delimiters,
+                // and an unterminated quote takes the rest of the line
+                size_t endPos = scanner.findQuote(startPos + 1);
+                tokens.push_back(line.substr(startPos + 1, endPos - startPos - 1));
+                if (endPos == line.size())
+                {
+                    break;
+                }
+                position = endPos + 1;
+            }
+            else
+            {
+                size_t endPos = scanner.findDelimiter(startPos);
+                tokens.push_back(line.substr(startPos, endPos - startPos));
+                position = endPos;
+            }
+        }
+    }
+}
+
+
+void tokenizeLine(std::string_view line, char delimiter, std::vector<std::string_view>& tokens)
+{
+    tokenize(line, delimiter, tokens, selectedKernel().classify);
+}
+
+
+void tokenizeLineScalar(std::string_view line, char delimiter, std::vector<std::string_view>& tokens)
+{
+    tokenize(line, delimiter, tokens, classifyScalar);
+}
+
+
+const char* tokenizerKernelName()
+{
+    return selectedKernel().name;
+}
@@ -0,0 +1,39 @@
+// Copyright 2014 Steve Robinson
+//
+// This file is part of RLM Log Reader.
+//
+// RLM Log Reader is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// RLM Log Reader is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with RLM Log Reader.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <string_view>
+#include <vector>
+
+
+// Splits line on a single-character delimiter with the same rules as tokenizeString:
+// runs of delimiters are collapsed, and a token that starts with a double quote runs
+// to the next double quote, so quoted fields keep their spaces and "" is an empty
+// token.  The tokens are views into line, so no strings are built and the tokens
+// vector can be reused from line to line without allocating.
+//
+// Delimiters and quotes are found 64 bytes at a time with SSE2 or AVX2 compares,
+// whichever the CPU supports, falling back to plain C++ on other architectures.
+void tokenizeLine(std::string_view line, char delimiter, std::vector<std::string_view>& tokens);
+
+// Same as tokenizeLine but always uses the portable byte-at-a-time classifier.
+// It's the reference the vector code is checked and benchmarked against.
+void tokenizeLineScalar(std::string_view line, char delimiter, std::vector<std::string_view>& tokens);
+
+// Name of the instruction set tokenizeLine picked for this CPU
+const char* tokenizerKernelName();
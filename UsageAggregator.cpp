@@ -0,0 +1,289 @@
+// Copyright 2014 Steve Robinson
+//
+// This file is part of RLM Log Reader.
+//
+// RLM Log Reader is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// RLM Log Reader is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with RLM Log Reader.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "UsageAggregator.h"
+#include "BufferedWriter.h"
+
+#include <algorithm>
+
+
+namespace
+{
+    const int64_t SecondsPerDay = 86400;
+
+    // The epoch was a Thursday, so weeks start four days after it
+    const int64_t FirstMonday = 4 * SecondsPerDay;
+
+
+    int64_t floorDivide(int64_t number, int64_t divisor)
+    {
+        int64_t quotient = number / divisor;
+        return (number % divisor < 0) ? quotient - 1 : quotient;
+    }
+
+
+    void writeTwoDigits(BufferedWriter& writer, int64_t number)
+    {
+        writer.write(static_cast<char>('0' + number / 10));
+        writer.write(static_cast<char>('0' + number % 10));
+    }
+
+
+    // Writes the time as "MM/DD/YYYY HH:MM", like the dates in report logs.  Days are
+    // converted to the civil calendar with Howard Hinnant's civil_from_days.
+    void writeTime(BufferedWriter& writer, int64_t time)
+    {
+        int64_t days = floorDivide(time, SecondsPerDay);
+        int64_t seconds = time - days * SecondsPerDay;
+
+        days += 719468;
+        int64_t era = floorDivide(days, 146097);
+        int64_t dayOfEra = days - era * 146097;
+        int64_t yearOfEra = (dayOfEra - dayOfEra/1460 + dayOfEra/36524 - dayOfEra/146096) / 365;
+        int64_t dayOfYear = dayOfEra - (365*yearOfEra + yearOfEra/4 - yearOfEra/100);
+        int64_t shiftedMonth = (5*dayOfYear + 2) / 153;
+        int64_t day = dayOfYear - (153*shiftedMonth + 2)/5 + 1;
+        int64_t month = shiftedMonth < 10 ? shiftedMonth + 3 : shiftedMonth - 9;
+        int64_t year = yearOfEra + era * 400 + (month <= 2);
+
+        writeTwoDigits(writer, month);
+        writer.write('/');
+        writeTwoDigits(writer, day);
+        writer.write('/');
+        writer.writeNumber(year);
+        writer.write(' ');
+        writeTwoDigits(writer, seconds / 3600);
+        writer.write(':');
+        writeTwoDigits(writer, (seconds / 60) % 60);
+    }
+}
+
+
+UsageAggregator::UsageAggregator(usagePeriod period)
+    : m_period(period),
+      m_started(false),
+      m_periodStart(0),
+      m_coveredFrom(0),
+      m_time(0)
+{
+}
+
+
+void UsageAggregator::advance(int64_t time, BufferedWriter& writer)
+{
+    if (!m_started)
+    {
+        m_started = true;
+        m_time = time;
+        startPeriod(periodStart(time));
+        m_coveredFrom = time;
+        return;
+    }
+
+    time = std::max(time, m_time);
+    while (time >= m_periodStart + periodLength())
+    {
+        int64_t periodEnd = m_periodStart + periodLength();
+        accumulate(periodEnd);
+        writePeriod(writer);
+        startPeriod(periodEnd);
+    }
+    accumulate(time);
+}
+
+
+void UsageAggregator::setUsage(const std::string& product, size_t inUse, size_t uniqueUsers)
+{
+    PeriodUsage& usage = m_usage.at(productIndex(product));
+    usage.inUse = static_cast<int64_t>(inUse);
+    usage.uniqueUsers = static_cast<int64_t>(uniqueUsers);
+    usage.peakInUse = std::max(usage.peakInUse, usage.inUse);
+    usage.minimumInUse = std::min(usage.minimumInUse, usage.inUse);
+    usage.peakUniqueUsers = std::max(usage.peakUniqueUsers, usage.uniqueUsers);
+    usage.minimumUniqueUsers = std::min(usage.minimumUniqueUsers, usage.uniqueUsers);
+}
+
+
+void UsageAggregator::addDenial(const std::string& product)
+{
+    ++m_usage.at(productIndex(product)).denials;
+}
+
+
+void UsageAggregator::writeCurrentPeriod(int64_t endTime, BufferedWriter& writer) const
+{
+    if (m_started)
+    {
+        UsageAggregator finished = *this;
+        finished.advance(endTime, writer);
+        finished.writePeriod(writer);
+    }
+}
+
+
+void UsageAggregator::writeHeader(BufferedWriter& writer)
+{
+    writer.write("Period Start,Product,"
+                 "Peak licenses in use,Average licenses in use,Minimum licenses in use,"
+                 "Peak unique user count,Average unique user count,Minimum unique user count,"
+                 "Denials\n");
+}
+
+
+void UsageAggregator::save(Checkpoint& checkpoint) const
+{
+    checkpoint.periodClock = {m_started, m_periodStart, m_coveredFrom, m_time};
+    for (size_t product=0; product < m_usage.size(); ++product)
+    {
+        const PeriodUsage& usage = m_usage.at(product);
+        checkpoint.periodProducts.push_back(m_products.at(product));
+        checkpoint.periodUsage.push_back({usage.inUse, usage.uniqueUsers,
+                                          usage.peakInUse, usage.minimumInUse, usage.inUseSeconds,
+                                          usage.peakUniqueUsers, usage.minimumUniqueUsers, usage.uniqueUserSeconds,
+                                          usage.denials});
+    }
+}
+
+
+void UsageAggregator::restore(const Checkpoint& checkpoint)
+{
+    m_started = checkpoint.periodClock.at(0);
+    m_periodStart = checkpoint.periodClock.at(1);
+    m_coveredFrom = checkpoint.periodClock.at(2);
+    m_time = checkpoint.periodClock.at(3);
+    m_products.clear();
+    m_productIndices.clear();
+    m_usage.clear();
+    for (size_t product=0; product < checkpoint.periodProducts.size(); ++product)
+    {
+        const std::vector<int64_t>& usage = checkpoint.periodUsage.at(product);
+        productIndex(checkpoint.periodProducts.at(product));
+        m_usage.back() = {usage.at(0), usage.at(1),
+                          usage.at(2), usage.at(3), usage.at(4),
+                          usage.at(5), usage.at(6), usage.at(7),
+                          usage.at(8)};
+    }
+}
+
+
+size_t UsageAggregator::productIndex(const std::string& product)
+{
+    // A product first seen part way through a period had no usage before then
+    auto found = m_productIndices.find(product);
+    if (found != m_productIndices.end())
+    {
+        return found->second;
+    }
+    m_productIndices.emplace(product, m_products.size());
+    m_products.push_back(product);
+    m_usage.push_back({0, 0, 0, 0, 0, 0, 0, 0, 0});
+    return m_products.size() - 1;
+}
+
+
+int64_t UsageAggregator::periodStart(int64_t time) const
+{
+    if (m_period == PerWeek)
+    {
+        return floorDivide(time - FirstMonday, periodLength()) * periodLength() + FirstMonday;
+    }
+    return floorDivide(time, periodLength()) * periodLength();
+}
+
+
+int64_t UsageAggregator::periodLength() const
+{
+    switch (m_period)
+    {
+        case PerMinute:
+            return 60;
+        case PerHour:
+            return 3600;
+        case PerDay:
+            return SecondsPerDay;
+        case PerWeek:
+            return 7 * SecondsPerDay;
+    }
+    return 3600;
+}
+
+
+void UsageAggregator::startPeriod(int64_t start)
+{
+    // Usage carries over from the end of the last period
+    m_periodStart = start;
+    m_coveredFrom = start;
+    for (PeriodUsage& usage : m_usage)
+    {
+        usage.peakInUse = usage.inUse;
+        usage.minimumInUse = usage.inUse;
+        usage.inUseSeconds = 0;
+        usage.peakUniqueUsers = usage.uniqueUsers;
+        usage.minimumUniqueUsers = usage.uniqueUsers;
+        usage.uniqueUserSeconds = 0;
+        usage.denials = 0;
+    }
+}
+
+
+void UsageAggregator::accumulate(int64_t time)
+{
+    int64_t seconds = time - m_time;
+    for (PeriodUsage& usage : m_usage)
+    {
+        usage.inUseSeconds += usage.inUse * seconds;
+        usage.uniqueUserSeconds += usage.uniqueUsers * seconds;
+    }
+    m_time = time;
+}
+
+
+void UsageAggregator::writePeriod(BufferedWriter& writer) const
+{
+    // A period that ends the moment it's first counted averages to the usage at that moment
+    int64_t coveredSeconds = m_time - m_coveredFrom;
+    for (size_t product=0; product < m_usage.size(); ++product)
+    {
+        const PeriodUsage& usage = m_usage.at(product);
+        double averageInUse = usage.inUse;
+        double averageUniqueUsers = usage.uniqueUsers;
+        if (coveredSeconds > 0)
+        {
+            averageInUse = static_cast<double>(usage.inUseSeconds) / coveredSeconds;
+            averageUniqueUsers = static_cast<double>(usage.uniqueUserSeconds) / coveredSeconds;
+        }
+
+        writeTime(writer, m_periodStart);
+        writer.write(',');
+        writer.write(m_products.at(product));
+        writer.write(',');
+        writer.writeNumber(usage.peakInUse);
+        writer.write(',');
+        writer.writeFixed(averageInUse, 2);
+        writer.write(',');
+        writer.writeNumber(usage.minimumInUse);
+        writer.write(',');
+        writer.writeNumber(usage.peakUniqueUsers);
+        writer.write(',');
+        writer.writeFixed(averageUniqueUsers, 2);
+        writer.write(',');
+        writer.writeNumber(usage.minimumUniqueUsers);
+        writer.write(',');
+        writer.writeNumber(usage.denials);
+        writer.write('\n');
+    }
+}
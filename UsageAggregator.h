@@ -0,0 +1,95 @@
+// Copyright 2014 Steve Robinson
+//
+// This file is part of RLM Log Reader.
+//
+// RLM Log Reader is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// RLM Log Reader is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with RLM Log Reader.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Checkpoint.h"
+
+
+class BufferedWriter;
+
+
+enum usagePeriod
+{
+    PerMinute,
+    PerHour,
+    PerDay,
+    PerWeek         // Starting on Mondays
+};
+
+
+// Numbers a checkpoint holds for each product, and for the clock
+const size_t PeriodUsageFields = 9;
+const size_t PeriodClockFields = 4;
+
+
+// Sums up concurrent usage over fixed periods of time: the peak, time-weighted average and
+// minimum licenses in use and unique users of each product, and its denials.  Changes are
+// fed in the order they were logged, and each period is written out as soon as it's over,
+// as a line for each product seen so far.
+class UsageAggregator
+{
+    public:
+        explicit UsageAggregator(usagePeriod period = PerHour);
+
+        // Moves the clock forward to time, in seconds since the epoch, writing out the
+        // periods that end on the way.  A time before the last one counts as the last one.
+        void advance(int64_t time, BufferedWriter& writer);
+        void setUsage(const std::string& product, size_t inUse, size_t uniqueUsers);
+        void addDenial(const std::string& product);
+
+        // Writes the period in progress, counting the usage up to endTime, but leaves this
+        // aggregator as it was so more changes can be fed to it later
+        void writeCurrentPeriod(int64_t endTime, BufferedWriter& writer) const;
+        static void writeHeader(BufferedWriter& writer);
+
+        void save(Checkpoint& checkpoint) const;
+        void restore(const Checkpoint& checkpoint);
+    private:
+        struct PeriodUsage
+        {
+            int64_t inUse;
+            int64_t uniqueUsers;
+            int64_t peakInUse;
+            int64_t minimumInUse;
+            int64_t inUseSeconds;       // Licenses in use integrated over the period
+            int64_t peakUniqueUsers;
+            int64_t minimumUniqueUsers;
+            int64_t uniqueUserSeconds;
+            int64_t denials;
+        };
+
+        size_t productIndex(const std::string& product);
+        int64_t periodStart(int64_t time) const;
+        int64_t periodLength() const;
+        void startPeriod(int64_t start);
+        void accumulate(int64_t time);
+        void writePeriod(BufferedWriter& writer) const;
+
+        usagePeriod m_period;
+        bool m_started;
+        int64_t m_periodStart;
+        int64_t m_coveredFrom;      // When the first period started being counted, later the period start
+        int64_t m_time;
+        std::vector<std::string> m_products;
+        std::unordered_map<std::string, size_t> m_productIndices;
+        std::vector<PeriodUsage> m_usage;
+};
@@ -17,39 +17,136 @@
 
 #include "date/date.h"
 #include "Utilities.h"
+#include "BufferedWriter.h"
 #include "Exceptions.h"
+#include "MappedFile.h"
 #include "qdir.h"
+#include <algorithm>
+#include <atomic>
+#include <exception>
 #include <fstream>
 #include <string>
+#include <thread>
 #include <vector>
 
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
 
 void loadDataFromFile(const std::string& filePath, std::vector<std::string>& fileData)
 {
-    std::string line;
-    std::ifstream myfile (filePath.c_str());
-    if (myfile.is_open())
+    MappedFile mappedFile(filePath);
+
+    std::vector<std::string_view> lines;
+    splitIntoLines(mappedFile.data(), lines);
+
+    fileData.reserve(fileData.size() + lines.size());
+    for (size_t line=0; line<lines.size(); ++line)
     {
-        while ( myfile.good() )
+        fileData.push_back(std::string(lines.at(line)));
+    }
+}
+
+bool getNextLine(std::string_view data, size_t& position, std::string_view& line)
+{
+    if (position > data.size())
+    {
+        return false;
+    }
+
+    size_t endPos = data.find('\n', position);
+    line = data.substr(position, endPos - position);
+
+    // Remove extra line break, if present
+    if (!line.empty() && line.back() == '\r')
+    {
+        line.remove_suffix(1);
+    }
+
+    // Step past the end of the data after the last line so the next call returns false
+    position = (endPos == std::string_view::npos) ? data.size() + 1 : endPos + 1;
+
+    return true;
+}
+
+void splitIntoLines(std::string_view data, std::vector<std::string_view>& lines)
+{
+    size_t position = 0;
+    std::string_view line;
+
+    while (getNextLine(data, position, line))
+    {
+        lines.push_back(line);
+    }
+}
+
+void splitIntoChunks(std::string_view data, size_t chunkSize, std::vector<std::string_view>& chunks)
+{
+    chunks.clear();
+    size_t startPos = 0;
+
+    do
+    {
+        size_t endPos = data.size();
+        if (data.size() - startPos > chunkSize)
         {
-            getline (myfile,line);
+            endPos = data.find('\n', startPos + chunkSize - 1);
+            endPos = (endPos == std::string_view::npos) ? data.size() : endPos + 1;
+        }
+        chunks.push_back(data.substr(startPos, endPos - startPos));
+        startPos = endPos;
+    }
+    while (startPos < data.size());
+}
 
-            // Remove extra line break, if present
-            findReplaceAll("\r","", line);
+void runInParallel(size_t taskCount, size_t threadCount, const std::function<void(size_t)>& task)
+{
+    std::vector<std::exception_ptr> errors(taskCount);
+    std::atomic<size_t> nextTask(0);
 
-            fileData.push_back(line);
+    auto worker = [&]()
+    {
+        for (size_t index = nextTask++; index < taskCount; index = nextTask++)
+        {
+            try
+            {
+                task(index);
+            }
+            catch (...)
+            {
+                errors.at(index) = std::current_exception();
+            }
         }
-        myfile.close();
+    };
+
+    // The calling thread does its share of the work too
+    std::vector<std::thread> threads;
+    for (size_t thread=1; thread < std::min(threadCount, taskCount); ++thread)
+    {
+        threads.push_back(std::thread(worker));
     }
-    else
+    worker();
+    for (size_t thread=0; thread < threads.size(); ++thread)
     {
-        CannotOpenFileException cannotOpenFileException(filePath);
-        throw cannotOpenFileException;
+        threads.at(thread).join();
+    }
+
+    for (size_t index=0; index < errors.size(); ++index)
+    {
+        if (errors.at(index))
+        {
+            std::rethrow_exception(errors.at(index));
+        }
     }
 }
 
 void tokenizeString(const std::string& delimiter,
-                    const std::string& str,
+                    std::string_view str,
                     std::vector<std::string>& tokens)
 {
     size_t startPos = 0;
@@ -63,7 +160,7 @@ void tokenizeString(const std::string& delimiter,
         startPos = str.find_first_not_of(localDelimiter, startPos);
         endPos = str.find_first_of(localDelimiter, startPos);
 
-        if (startPos != std::string::npos)
+        if (startPos != std::string_view::npos)
         {
             if (str.at(startPos) == '"')
             {
@@ -71,11 +168,11 @@ void tokenizeString(const std::string& delimiter,
                 startPos = startPos + 1;
                 localDelimiter = "\"";
                 endPos = str.find_first_of(localDelimiter, startPos);
-                if (endPos != std::string::npos)
+                if (endPos != std::string_view::npos)
                     localDelimiter = delimiter;
             }
 
-            tokens.push_back(str.substr(startPos, endPos - startPos));
+            tokens.push_back(std::string(str.substr(startPos, endPos - startPos)));
 
             if (withinQuotes)
                 endPos = endPos + 1;
@@ -85,7 +182,7 @@ void tokenizeString(const std::string& delimiter,
 
         startPos = endPos;
     }
-    while (endPos != std::string::npos);
+    while (endPos != std::string_view::npos);
 }
 
 void untokenizeString(const std::string& delimiter,
@@ -103,7 +200,7 @@ void untokenizeString(const std::string& delimiter,
     }
 }
 
-void getUniqueItems(std::string& itemName, std::vector<std::string>& uniqueItems)
+void getUniqueItems(const std::string& itemName, std::vector<std::string>& uniqueItems)
 {
     bool duplicate = false;
     for (size_t item=0; item < uniqueItems.size(); ++item)
@@ -125,30 +222,21 @@ void write2DVectorToFile(const std::string filePath,
                          const std::vector<std::vector<std::string>>& data,
                          const std::string delimiter)
 {
-    std::ofstream myfile;
-    myfile.open (filePath.c_str());
-    if (myfile.is_open())
+    BufferedWriter writer(filePath);
+    for (size_t row = 0; row<data.size(); ++row)
     {
-        for (size_t row = 0; row<data.size(); ++row)
+        size_t columnSize = data.at(row).size();
+        for (size_t col = 0; col<columnSize; ++col)
         {
-            size_t columnSize = data.at(row).size();
-            for (size_t col = 0; col<columnSize; ++col)
+            writer.write(data.at(row).at(col));
+            if (col != columnSize-1)
             {
-                myfile << data.at(row).at(col);
-                if (col != columnSize-1)
-                {
-                    myfile << delimiter;
-                }
+                writer.write(delimiter);
             }
-            myfile << "\n";
         }
-        myfile.close();
-    }
-    else
-    {
-        CannotOpenFileException cannotOpenFileException(filePath);
-        throw cannotOpenFileException;
+        writer.write('\n');
     }
+    writer.close();
 }
 
 
@@ -260,18 +348,17 @@ void parseDataInto2DVector(const std::vector<std::string>& rowData,
 
 void getFileListInDirectory(const std::string& directory, std::vector<std::string>& fileList)
 {
-    if (QDir(directory.c_str()).exists())
+    QDir dir(directory.c_str());
+    if (dir.exists())
     {
         std::string filePath;
 
-        QStringList entries = QDir(directory.c_str()).entryList();
+        // Resolve each entry against the directory being listed, not the working directory
+        QStringList entries = dir.entryList(QDir::Files, QDir::Name);
         for(QStringList::ConstIterator entry=entries.begin(); entry!=entries.end(); ++entry)
         {
-            if (!QDir(*entry).exists())
-            {
-                filePath = QDir((*entry)).absolutePath().toLocal8Bit().constData();
-                fileList.push_back(filePath);
-            }
+            filePath = dir.absoluteFilePath(*entry).toLocal8Bit().constData();
+            fileList.push_back(filePath);
         }
     }
 }
@@ -282,3 +369,38 @@ bool fileExists(const std::string& filePath)
     std::ifstream ifile(filePath.c_str());
     return (ifile.is_open());
 }
+
+
+uint64_t getFileSize(const std::string& filePath)
+{
+    std::ifstream ifile(filePath.c_str(), std::ios::binary | std::ios::ate);
+    if (!ifile.is_open())
+    {
+        return 0;
+    }
+    return static_cast<uint64_t>(ifile.tellg());
+}
+
+
+uint64_t peakMemoryUsage()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+    {
+        return counters.PeakWorkingSetSize;
+    }
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0)
+    {
+#ifdef __APPLE__
+        return static_cast<uint64_t>(usage.ru_maxrss);
+#else
+        // Linux counts in kilobytes
+        return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+    }
+#endif
+    return 0;
+}
@@ -18,21 +18,41 @@
 #pragma once
 
 #include <chrono>
+#include <cstdint>
+#include <functional>
+#include <sstream>
 #include <vector>
 #include <string>
+#include <string_view>
 
 
 void loadDataFromFile(const std::string& filePath, std::vector<std::string>& fileData);
 
+// Splits a memory-mapped file into lines without copying.  The views point into
+// data, so they are only valid while the underlying MappedFile stays open.
+void splitIntoLines(std::string_view data, std::vector<std::string_view>& lines);
+
+// Returns the line starting at position and advances position past it, so the
+// file can be streamed one line at a time.  Returns false after the last line.
+bool getNextLine(std::string_view data, size_t& position, std::string_view& line);
+
+// Cuts data into consecutive chunks of roughly chunkSize bytes.  Each chunk is extended
+// to the end of the line it stops in, so no line is split between two chunks.
+void splitIntoChunks(std::string_view data, size_t chunkSize, std::vector<std::string_view>& chunks);
+
+// Calls task(0) ... task(taskCount-1) on up to threadCount threads and waits for all of
+// them.  If any task throws, the exception from the lowest-numbered one is rethrown.
+void runInParallel(size_t taskCount, size_t threadCount, const std::function<void(size_t)>& task);
+
 void tokenizeString(const std::string& delimiter,
-                    const std::string& rawEventData,
+                    std::string_view rawEventData,
                     std::vector<std::string>& tokens);
 
 void untokenizeString(const std::string& delimiter,
                     std::string& rawEventData,
                     const std::vector<std::string>& tokens);
 
-void getUniqueItems(std::string& item, std::vector<std::string>& uniqueItems);
+void getUniqueItems(const std::string& item, std::vector<std::string>& uniqueItems);
 
 void write2DVectorToFile(const std::string filePath,
                          const std::vector<std::vector<std::string>>& data,
@@ -67,3 +87,9 @@ void parseDataInto2DVector(const std::vector<std::string>& rawData,
 void getFileListInDirectory(const std::string& directory, std::vector<std::string>& fileList);
 
 bool fileExists(const std::string& filePath);
+
+// Size in bytes, or 0 if the file can't be opened
+uint64_t getFileSize(const std::string& filePath);
+
+// Most memory the process has had resident at once so far, in bytes, or 0 if the OS won't say
+uint64_t peakMemoryUsage();
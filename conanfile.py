@@ -7,8 +7,11 @@ class Conan(ConanFile):
     generators = "cmake", "cmake_find_package", "cmake_paths"
 
     def requirements(self):
+        self.requires("benchmark/1.6.1")
         self.requires("date/3.0.1")
         self.requires("gtest/1.11.0")
         self.requires("qt/5.15.3")
         self.requires("expat/2.4.2")
         self.requires("openssl/1.1.1n")
+        self.requires("zlib/1.2.12")
+        self.requires("zstd/1.5.2")
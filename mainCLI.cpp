@@ -0,0 +1,331 @@
+// Copyright 2014 Steve Robinson
+//
+// This file is part of RLM Log Reader.
+//
+// RLM Log Reader is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// RLM Log Reader is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with RLM Log Reader.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "BatchAnalysis.h"
+#include "CommandLine.h"
+#include "Exceptions.h"
+#include "LogWatcher.h"
+#include "Utilities.h"
+#include "qdir.h"
+#include <atomic>
+#include <csignal>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+
+namespace
+{
+    std::atomic<bool> stopFollowing(false);
+
+    void requestStop(int)
+    {
+        stopFollowing = true;
+    }
+
+
+    std::string describeUsage(LogData& logData)
+    {
+        std::vector<ProductUsage> usage;
+        logData.currentUsage(usage);
+
+        std::ostringstream description;
+        description << logData.lastEventTime();
+        for (const ProductUsage& productUsage : usage)
+        {
+            description << "\t" << productUsage.product << " " << productUsage.licensesInUse;
+            if (logData.fileFormat() == ReportLog)
+            {
+                description << "/" << productUsage.totalLicenses;
+            }
+            description << " (" << productUsage.uniqueUsers << " users)";
+        }
+        description << "\t" << logData.denialCount() << " denials";
+        return description.str();
+    }
+
+
+    // Keeps the log's analysis in memory and reads each addition to it as it's written.
+    // The results are written out every flush interval and when stopped.  A replaced or
+    // unreadable log is read again from the start once it's usable.
+    int followLog(const CommandLineOptions& options)
+    {
+        std::signal(SIGINT, requestStop);
+        std::signal(SIGTERM, requestStop);
+
+        const std::string& inputFilePath = options.inputPaths.at(0);
+        const std::chrono::seconds flushInterval(options.flushInterval);
+        const std::chrono::seconds retryInterval(1);
+        LogWatcher logWatcher(inputFilePath);
+        std::unique_ptr<LogData> logData;
+        std::string lastDescription;
+        std::string lastError;
+        auto lastFlush = std::chrono::steady_clock::now();
+
+        while (!stopFollowing)
+        {
+            try
+            {
+                if (!logData)
+                {
+                    std::string conflictedFileList;
+                    if (options.overwrite != OverwriteExisting)
+                    {
+                        LogData::findExistingFiles(inputFilePath, options.outputDirectory, conflictedFileList,
+                                                   IncrementalAnalysis, options.outputs, options.period);
+                    }
+                    if (!conflictedFileList.empty())
+                    {
+                        findReplaceAll("\n", " ", conflictedFileList);
+                        std::cerr << "Output files already exist: " << conflictedFileList << "\n";
+                        return ExitLogFailed;
+                    }
+
+                    logData.reset(new LogData(inputFilePath, options.outputDirectory, options.threadCount,
+                                              IncrementalAnalysis, options.outputs, options.period));
+                    logData->publishResults();
+                    lastFlush = std::chrono::steady_clock::now();
+                }
+                else if (logWatcher.waitForChange(retryInterval) && !logData->update())
+                {
+                    logData.reset();
+                    continue;
+                }
+
+                lastError.clear();
+                std::string description = describeUsage(*logData);
+                if (description != lastDescription)
+                {
+                    std::cout << description << std::endl;
+                    lastDescription = description;
+                }
+
+                if (std::chrono::steady_clock::now() - lastFlush >= flushInterval)
+                {
+                    logData->publishResults();
+                    lastFlush = std::chrono::steady_clock::now();
+                }
+            }
+            catch (std::exception& e)
+            {
+                // A log being rotated can be missing or empty for a while, so only
+                // report each problem once
+                if (lastError != e.what())
+                {
+                    std::cerr << e.what() << "\n";
+                    lastError = e.what();
+                }
+                logData.reset();
+                logWatcher.waitForChange(retryInterval);
+            }
+        }
+
+        if (logData)
+        {
+            try
+            {
+                logData->publishResults();
+            }
+            catch (std::exception& e)
+            {
+                std::cerr << e.what() << "\n";
+                return ExitLogFailed;
+            }
+        }
+        return ExitSuccess;
+    }
+
+
+    // Prints nothing until every product has been looked up, so a log that can't be
+    // queried only gets its failure line
+    void printQuery(const CommandLineOptions& options, LogData& logData, const std::string& logName)
+    {
+        std::vector<std::string> products;
+        if (options.queryProduct.empty())
+        {
+            std::vector<ProductUsage> usage;
+            logData.currentUsage(usage);
+            for (const ProductUsage& productUsage : usage)
+            {
+                products.push_back(productUsage.product);
+            }
+        }
+        else
+        {
+            products.push_back(options.queryProduct);
+        }
+
+        std::ostringstream lines;
+        for (const std::string& product : products)
+        {
+            lines << logName << "\t" << product << "\t";
+            if (options.queryRange)
+            {
+                lines << logData.peakUsage(product, options.queryFrom, options.queryTo) << "\t"
+                      << std::fixed << std::setprecision(2)
+                      << logData.averageUsage(product, options.queryFrom, options.queryTo) << "\n";
+            }
+            else
+            {
+                lines << logData.usageAt(product, options.queryFrom) << "\n";
+            }
+        }
+        std::cout << lines.str();
+    }
+
+
+    // Answers --at or --between for each log, or for the pool as a whole, without
+    // publishing any results
+    int queryUsage(const CommandLineOptions& options)
+    {
+        std::vector<std::string> inputFilePaths;
+        for (const std::string& inputPath : options.inputPaths)
+        {
+            if (QDir(inputPath.c_str()).exists())
+            {
+                getFileListInDirectory(inputPath, inputFilePaths);
+            }
+            else
+            {
+                inputFilePaths.push_back(inputPath);
+            }
+        }
+
+        int result = ExitSuccess;
+        auto query = [&options, &result](const std::string& logName, const std::function<LogData*()>& analyze)
+        {
+            try
+            {
+                std::unique_ptr<LogData> logData(analyze());
+                printQuery(options, *logData, logName);
+            }
+            catch (std::exception& e)
+            {
+                std::cout << logName << "\tFAILED\t" << e.what() << "\n";
+                result = ExitLogFailed;
+            }
+        };
+
+        if (!options.poolName.empty())
+        {
+            query(options.poolName, [&options, &inputFilePaths]()
+            {
+                return new LogData(inputFilePaths, options.poolName, options.outputDirectory,
+                                   options.threadCount, 0, options.period);
+            });
+            return result;
+        }
+
+        for (const std::string& inputFilePath : inputFilePaths)
+        {
+            query(inputFilePath, [&options, &inputFilePath]()
+            {
+                return new LogData(inputFilePath, options.outputDirectory, options.threadCount,
+                                   options.cache ? CachedAnalysis : FullAnalysis, 0, options.period);
+            });
+        }
+        return result;
+    }
+}
+
+
+// Command-line front end for hosts without a display.  It only depends on the Data
+// library, so no Qt GUI libraries or platform plugins are needed.
+int main(int argc, char *argv[])
+{
+    CommandLineOptions options;
+    try
+    {
+        parseCommandLine(std::vector<std::string>(argv + 1, argv + argc), options);
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << e.what() << "\n\n" << commandLineUsage(argv[0]);
+        return ExitBadArguments;
+    }
+
+    if (options.help)
+    {
+        std::cout << commandLineUsage(argv[0]);
+        return ExitSuccess;
+    }
+
+    if (options.query && options.outputDirectory.empty())
+    {
+        return queryUsage(options);
+    }
+
+    if (!QDir(options.outputDirectory.c_str()).exists())
+    {
+        CannotFindDirException cannotFindDirException(options.outputDirectory);
+        std::cerr << cannotFindDirException.what() << "\n";
+        return ExitBadArguments;
+    }
+
+    if (options.follow)
+    {
+        return followLog(options);
+    }
+
+    if (options.query)
+    {
+        return queryUsage(options);
+    }
+
+    BatchOptions batchOptions;
+    batchOptions.threadCount = options.threadCount;
+    batchOptions.outputs = options.outputs;
+    batchOptions.overwrite = options.overwrite;
+    batchOptions.incremental = options.incremental;
+    batchOptions.cache = options.cache;
+    batchOptions.period = options.period;
+    batchOptions.poolName = options.poolName;
+    batchOptions.subdirectoryPerLog = options.poolName.empty() &&
+                                      (options.inputPaths.size() > 1 ||
+                                       QDir(options.inputPaths.at(0).c_str()).exists());
+
+    BatchAnalysis batchAnalysis(options.inputPaths, options.outputDirectory, batchOptions);
+    batchAnalysis.run();
+
+    for (const BatchResult& result : batchAnalysis.results())
+    {
+        std::cout << (result.skipped ? "SKIPPED" : (result.succeeded ? "OK" : "FAILED")) << "\t"
+                  << result.seconds << "\t"
+                  << result.inputFilePath << "\t"
+                  << result.outputDirectory << "\t"
+                  << result.errorMessage << "\n";
+    }
+
+    if (!options.reportPath.empty())
+    {
+        try
+        {
+            batchAnalysis.writeReport(options.reportPath);
+        }
+        catch (std::exception& e)
+        {
+            std::cerr << e.what() << "\n";
+            return ExitLogFailed;
+        }
+    }
+
+    return batchAnalysis.failureCount() > 0 ? ExitLogFailed : ExitSuccess;
+}